@@ -0,0 +1,103 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file event_queue.c
+*
+* @brief Lock-free single-producer, single-consumer event queue. See event_queue.h.
+*
+The producer is interrupt context and the consumer is the main loop. The MSP430 doesn't nest 
+interrupts unless an ISR re-enables them, which none of ours do, so all the ISRs together are a single 
+producer. 
+*
+head and tail are free-running 8-bit counters, so reading or writing one is a single instruction and 
+needs no lock; head - tail is the number of events waiting. Only the producer writes head, after it 
+has filled the entry, and only the consumer writes tail, after it has copied the entry out. Neither 
+side ever disables interrupts. When the queue is full the new event is dropped and counted, rather 
+than overwriting one the consumer may be reading.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../HAL/hal_clock.h"
+#include "event_queue.h"
+#include <stdint.h>
+
+#define EVENT_QUEUE_MASK                (EVENT_QUEUE_SIZE - 1)
+
+static struct event queue[EVENT_QUEUE_SIZE];
+static volatile uint8_t head = 0;           // Next entry to write; written by the producer only
+static volatile uint8_t tail = 0;           // Next entry to read; written by the consumer only
+static volatile uint16_t overflows = 0;     // Written by the producer only
+
+/**
+Adds an event to the queue, timestamped now. Call from interrupt context only.
+@param type what happened, an EVENT_TYPE
+@param source which button, which byte, etc.
+@return 0 if success, -1 if the queue was full and the event was dropped
+*/
+int16_t eventQueuePush(uint8_t type, uint8_t source)
+{
+    uint8_t h = head;
+    if ((uint8_t) (h - tail) >= EVENT_QUEUE_SIZE)
+    {
+        overflows++;
+        return -1;
+    }
+    struct event* e = &queue[h & EVENT_QUEUE_MASK];
+    e->type = type;
+    e->source = source;
+    e->timestamp = halMillis();
+    head = h + 1;                           // Publish
+    return 0;
+}
+
+/**
+Takes the oldest event off the queue. Call from the main loop only.
+@param e where to copy the event
+@return 1 if an event was copied to e, 0 if the queue is empty
+*/
+uint8_t eventQueuePop(struct event* e)
+{
+    uint8_t t = tail;
+    if (t == head)
+        return 0;
+    *e = queue[t & EVENT_QUEUE_MASK];
+    tail = t + 1;                           // Release the entry to the producer
+    return 1;
+}
+
+/** @return number of events waiting */
+uint8_t eventQueueCount()
+{
+    return (uint8_t) (head - tail);
+}
+
+/** @return number of events dropped because the queue was full */
+uint16_t eventQueueOverflows()
+{
+    return overflows;
+}
+
+/* @} */
@@ -0,0 +1,71 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file event_queue.h
+*
+* @brief Lock-free single-producer, single-consumer queue of events from the interrupt handlers to the
+* application, each with its source and when it happened.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+
+/** 
+Number of events that can be waiting. Must be a power of 2, at most 128. eventTask() empties the queue 
+each time it runs, so this only has to cover a button press and a console command, which are single 
+characters, arriving during one task; overflows are counted. 
+*/
+#define EVENT_QUEUE_SIZE                2
+
+/** Types of event */
+enum EVENT_TYPE
+{
+    /** A button was pressed; source is the button */
+    EVENT_BUTTON,
+    /** A byte was received on the debug console; source is the byte */
+    EVENT_CONSOLE,
+    EVENT_NUM_TYPES
+};
+
+struct event
+{
+    uint8_t type;
+    uint8_t source;
+    /** halMillis() when the event happened */
+    uint32_t timestamp;
+};
+
+int16_t eventQueuePush(uint8_t type, uint8_t source);
+uint8_t eventQueuePop(struct event* e);
+uint8_t eventQueueCount();
+uint16_t eventQueueOverflows();
+
+#endif
+
+/* @} */
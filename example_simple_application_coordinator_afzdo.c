@@ -40,6 +40,14 @@
 */
 
 #include "../HAL/hal.h"
+#include "../HAL/hal_clock.h"
+#include "../HAL/hal_vlo.h"
+#include "../HAL/hal_adc.h"
+#include "../HAL/hal_energy.h"
+#include "../HAL/hal_rgb.h"
+#include "../HAL/hal_stack.h"
+#include "../HAL/hal_profiler.h"
+#include "../HAL/hal_output.h"
 #include "../ZM/module.h"
 #include "../ZM/application_configuration.h"
 #include "../ZM/af.h"
@@ -52,6 +60,14 @@
 #include "Messages/kvp.h"
 #include "Messages/oids.h"
 #include "module_example_utils.h"
+#include "scheduler.h"
+#include "latency.h"
+#include "tracking.h"
+#include "mgmt_lqi.h"
+#include "report.h"
+#include "journal.h"
+#include "event_queue.h"
+#include "module_async.h"
 #include <stdint.h>
 
 static void parseMessages();
@@ -59,9 +75,23 @@ static void parseMessages();
 /** Function pointer (in hal file) for the function that gets called when a button is pressed*/
 extern void (*buttonIsr)(int8_t);
 
+/** Function pointer (in hal file) for the function that gets called when a debug console byte is received */
+extern void (*debugConsoleIsr)(int8_t);
+
+/** Function pointer (in hal file) for the function that gets called when SRDY goes low */
+extern void (*srdyIsr)(void);
+
+/** Function pointer (in hal file) for the function that gets called on every sysTick */
+extern void (*sysTickIsr)(void);
+
 /** Our button interrupt handler */
 static void handleButtonPress(int8_t button);
 
+/** Our interrupt handlers for the other events that drive the task scheduler */
+static void handleConsoleByte(int8_t c);
+static void handleSrdy(void);
+static void handleSysTick(void);
+
 /** STATES for state machine */
 enum STATE
 {
@@ -70,59 +100,205 @@ enum STATE
     STATE_DISPLAY_NETWORK_INFORMATION,
 };
 
-/** STATES for tracking algorithm */
-enum TRACK_STATE
-{
-   ALL_ITEMS_CONNECTED,
-   SUSPECTED_ITEM_LOSS,
-   ITEM_LOST_ALARM,
-   ITEM_LOST_SILENCED,
-};
-
 /** This is the current state of the application. 
 * Gets changed by other states, or based on messages that arrive. */
 enum STATE state = STATE_MODULE_STARTUP;
 
-/** The main application state machine */
-static void stateMachine();
+/** 
+Tasks run by the scheduler. Listed in order of priority, highest first, so that the alarm path 
+(message reception, tracking evaluation, alarm output) always preempts everything else at the next 
+task boundary.
+*/
+enum TASK
+{
+    TASK_ALARM_OUTPUT,
+    TASK_TRACKING,
+    TASK_MESSAGE_RECEPTION,
+    TASK_BUTTON,
+    TASK_EVENT,
+    TASK_MAINTENANCE,
+    TASK_MODULE_COMMAND,
+    TASK_JOURNAL,
+    NUM_TASKS
+};
+
+static void alarmOutputTask();
+static void trackingTask();
+static void messageReceptionTask();
+static void buttonTask();
+static void eventTask();
+static void maintenanceTask();
+static void moduleCommandTask();
+static void journalTask();
+static void idleTask();
+
+SCHEDULER_ASSERT_TASKS_FIT(NUM_TASKS);
+
+/** The task table. Must be in the same order as enum TASK. */
+static const struct schedulerTask tasks[NUM_TASKS] =
+{
+    {alarmOutputTask,       "ALARM"},
+    {trackingTask,          "TRACKING"},
+    {messageReceptionTask,  "MESSAGE"},
+    {buttonTask,            "BUTTON"},
+    {eventTask,             "EVENT"},
+    {maintenanceTask,       "MAINTENANCE"},
+    {moduleCommandTask,     "MODULE CMD"},
+    {journalTask,           "JOURNAL"},
+};
+
+/** How often the maintenance task runs */
+#define MAINTENANCE_PERIOD_MS           1000
+
+/** 
+Clock policy: run MCLK at HAL_CLOCK_BURST while messages are arriving, and drop to HAL_CLOCK_IDLE 
+once none has arrived for CLOCK_IDLE_TIMEOUT_MS. The sysTick period does not change with the clock.
+*/
+#define HAL_CLOCK_BURST                 HAL_CLOCK_16MHZ
+#define HAL_CLOCK_IDLE                  HAL_CLOCK_1MHZ
+#define CLOCK_IDLE_TIMEOUT_MS           2000
+
+/** How often the VLO is recalibrated in the background, so that timers sourced from ACLK stay accurate */
+#define VLO_RECALIBRATION_INTERVAL_S    60
+
+/** Supply voltage below which the maintenance task warns, in mV */
+#define VCC_LOW_THRESHOLD_MV            2800
+static uint8_t vccLow = 0;
+
+/** halMillis() when the last message was received */
+static uint32_t lastMessageTime = 0;
+
+/** 
+Value of halMillis() when SRDY last went low to signal a message (in hal file). Used to timestamp 
+received messages with the time the module signalled them rather than the time we got around to 
+reading them. */
+extern uint32_t halSrdyTimestamp();
+
+/** Timestamp of the message being processed: halMillis() at its SRDY edge */
+static uint32_t messageTimestamp = 0;
 
 /* Tracking state machine */
-static void trackingStateMachine(int router_index);
+static void trackingStateMachine();
+static void trackingSample(int router_index, uint8_t lqi);
+static void trackingMark(int router_index);
+static void handleZdoLeaveIndication();
+static void handleZdoStatusError();
+
+/** 
+ZDO indications that a device has gone, which put it straight into ITEM_LOST_ALARM without waiting for 
+its average LQI to fall. See handleZdoLeaveIndication() and handleZdoStatusError().
+*/
+#define ZDO_LEAVE_IND                   0x45C9
+#define ZDO_STATUS_ERROR_RSP            0x45C3
+#define IS_ZDO_LEAVE_IND()          ((zmBuf[SRSP_CMD_MSB_FIELD] == MSB(ZDO_LEAVE_IND)) && \
+                                     (zmBuf[SRSP_CMD_LSB_FIELD] == LSB(ZDO_LEAVE_IND)))
+#define IS_ZDO_STATUS_ERROR_RSP()   ((zmBuf[SRSP_CMD_MSB_FIELD] == MSB(ZDO_STATUS_ERROR_RSP)) && \
+                                     (zmBuf[SRSP_CMD_LSB_FIELD] == LSB(ZDO_STATUS_ERROR_RSP)))
+/** ZDO_LEAVE_IND: SrcAddr(2), ExtAddr(8), Request, Remove, Rejoin */
+#define ZDO_LEAVE_IND_SHORT_ADDRESS_FIELD       (SRSP_HEADER_SIZE)
+#define ZDO_LEAVE_IND_EXTENDED_ADDRESS_FIELD    (SRSP_HEADER_SIZE + 2)
+#define ZDO_LEAVE_IND_REJOIN_FIELD              (SRSP_HEADER_SIZE + 12)
+/** ZDO_STATUS_ERROR_RSP: SrcAddr(2), Status */
+#define ZDO_STATUS_ERROR_RSP_SHORT_ADDRESS_FIELD    (SRSP_HEADER_SIZE)
+#define ZDO_STATUS_ERROR_RSP_STATUS_FIELD           (SRSP_HEADER_SIZE + 2)
+static int findRouterByShortAddress(uint16_t shortAddress);
+static int findRouterByMac(const uint8_t* mac);
 
 /** Various utility functions */
 static char* getRgbLedDisplayModeName(uint8_t mode);
 static uint8_t setModuleLeds(uint8_t mode);
+static void moduleGpioDone(moduleResult_t result);
 
-#define STATE_FLAG_MESSAGE_WAITING      0x01
-#define STATE_FLAG_BUTTON_PRESSED      0x02
-/** Various flags between states */
-volatile uint16_t stateFlags = 0;
-
-#define LQI_THRESHOLD                   0x50
-#define LQI_NUM_SAMPLES                 6
-#define NUM_DEVICES                     10
 int DEVICES_REGISTERED = 0;
 
-int current_router_index = 0;
 int coordinator_on = 1;
 
-#define BUZZER                          BIT0
+/** How often the whole tracking table is printed; in between, only changes are. See report.h. */
+#define REPORT_SNAPSHOT_PERIOD_MS       30000
+static uint32_t lastSnapshotTime = 0;
 
-struct router_device {
-  /** State of the tracking algorithm state machine */
-  enum TRACK_STATE track_state;
-  uint8_t MAC_address[8];
-  uint8_t LQI_running_average[LQI_NUM_SAMPLES];
-  uint8_t LQI;
-  uint8_t LQI_iter;
-  uint16_t LQI_total;
-  uint8_t LQI_average;
-  uint8_t LQI_initialized;
-};
+/** Set by trackingSample() when any device has a new LQI sample to evaluate */
+uint8_t tracking_pending = 0;
+/** One bit per device, set by trackingSample() when the device has a new LQI sample to evaluate */
+static uint8_t tracking_updated[(NUM_DEVICES + 7) / 8];
+
+/** 
+Most messages processed per run of the message reception task. Pending messages are drained in one 
+batch, with only the filters updated per message, before tracking is evaluated once. This bounds how 
+long the rest of the application waits behind a flood.
+*/
+#define MESSAGE_BATCH_MAX               16
+
+/** 
+Incoming message filter, applied before a message is deserialized:
+- Duplicates (retransmissions) are recognized by their AF transaction sequence number, per sender. 
+  Sequence numbers within SEQ_WINDOW_SIZE of the highest one received are remembered.
+- Each device may send RATE_LIMIT_BURST messages in a burst, then RATE_LIMIT_PER_PERIOD per 
+  MAINTENANCE_PERIOD_MS. Anything more is dropped, so that one misbehaving device can't starve 
+  processing of the others.
+Senders are recognized by short address, which is learned from the MAC in their first message. Messages 
+from senders not learned yet are always accepted.
+*/
+#define AF_INCOMING_MESSAGE_SHORT_ADDRESS() \
+    ((((uint16_t) zmBuf[SRSP_HEADER_SIZE+5]) << 8) | zmBuf[SRSP_HEADER_SIZE+4])
+#define AF_INCOMING_MESSAGE_SEQ()       (zmBuf[SRSP_HEADER_SIZE+15])
+#define SHORT_ADDRESS_UNKNOWN           0xFFFE
+#define SEQ_WINDOW_SIZE                 8
+#define RATE_LIMIT_BURST                4
+#define RATE_LIMIT_PER_PERIOD           2
+
+static uint16_t duplicatesDropped = 0;
+static uint16_t rateLimitDropped = 0;
+
+static uint8_t acceptIncomingMessage();
+
+/** 
+Neighbor table polling: every MGMT_LQI_PERIOD_MS the coordinator's own neighbor table is read with 
+Mgmt_Lqi_req, page by page, and the LQI of tracked devices in it is fed to the tracking filter. This 
+gives samples for devices that are in range but quiet. The table's LQI is cached by the stack, so it is 
+not used for a device that was heard from directly within the last MGMT_LQI_PERIOD_MS (its own 
+messages are better samples), nor for one that is already lost (a stale entry must not bring it back). 
+Pages are requested from the maintenance task, one per run. A poll that gets no response for 
+MGMT_LQI_TIMEOUT_MS is abandoned, and responses that weren't asked for are ignored.
+*/
+#define MGMT_LQI_PERIOD_MS              10000
+#define MGMT_LQI_TIMEOUT_MS             2000
+#define COORDINATOR_SHORT_ADDRESS       0x0000
+/** Values of mgmtLqiPolling */
+#define MGMT_LQI_IDLE                   0
+#define MGMT_LQI_PAGE_DUE               1
+#define MGMT_LQI_WAITING                2
+static uint8_t mgmtLqiPolling = MGMT_LQI_IDLE;
+/** Start index of the page due to be requested, or awaited */
+static uint8_t mgmtLqiIndex = 0;
+/** halMillis() when the last poll was started, or the last page was requested while polling */
+static uint32_t mgmtLqiTime = 0;
+static void mgmtLqiPoll();
+static void mgmtLqiRequestDone(moduleResult_t result);
+static void handleMgmtLqiResponse();
+static void learnShortAddress(int router_index);
+static void refillRateLimiters();
+
+#define BUZZER                          BIT0
 
 struct router_device routers[NUM_DEVICES];
+struct trackingContext tracking = {routers, NUM_DEVICES};
 uint8_t alarm_sounding = 0;
 uint8_t alarm_silenced = 0;
+
+/** What the RGB LED is showing, set by alarmOutputTask() */
+#define RGB_STATUS_NONE                 0
+#define RGB_STATUS_CONNECTED            1
+#define RGB_STATUS_LOST                 2
+#define RGB_STATUS_SILENCED             3
+static uint8_t rgb_status = RGB_STATUS_NONE;
+
+/** Records printed per run of journalTask() while dumping the journal, so the dump doesn't hold up messages */
+#define JOURNAL_DUMP_BATCH              2
+static uint8_t journalDumping = 0;
+static void logEvent(uint8_t event, uint8_t arg);
+/** SRDY timestamp of the frame that caused the alarm to sound, for latency measurement */
+uint32_t alarm_timestamp = 0;
 uint8_t program_mode = 0;
 
 void structInit();
@@ -147,14 +323,28 @@ void addMacAddress(int index, uint8_t* mac_address);
 //uncomment below to see more information about the messages received.
 //#define VERBOSE_MESSAGE_DISPLAY
 
+static void displayRamUsage();
+
 int main( void )
 {
+    halStackPaint();                    // Before anything else uses the stack
     structInit();
     halInit();
+    journalInit();
+    journalLog(JOURNAL_BOOT, 0);
     moduleInit();
+    if (schedulerInit(tasks, NUM_TASKS, idleTask) != 0)
+    {
+        outStr("ERROR: too many tasks\r\n");
+        while (1);                      // Dropping tasks would silently break the application
+    }
     buttonIsr = &handleButtonPress;    
-    printf("\r\n****************************************************\r\n");
-    printf("Simple Application Example - COORDINATOR\r\n");
+    debugConsoleIsr = &handleConsoleByte;
+    srdyIsr = &handleSrdy;
+    sysTickIsr = &handleSysTick;
+    outStr("\r\n****************************************************\r\n");
+    outStr("Simple Application Example - COORDINATOR\r\n");
+    displayRamUsage();
     
     routers[0].MAC_address[0] = 0x5E;
     routers[0].MAC_address[1] = 0xD2;
@@ -174,17 +364,17 @@ int main( void )
     routers[1].MAC_address[6] = 0x12;
     routers[1].MAC_address[7] = 0x00;
     
+    initSysTick();
+    halVloCalibrationStart(VLO_RECALIBRATION_INTERVAL_S);
+    halAdcSamplerStart();
     HAL_ENABLE_INTERRUPTS();
     clearLeds();
     
     halRgbLedPwmInit();
     
+    schedulerPost(TASK_MAINTENANCE);    // Starts the module
     while (1) {
-        stateMachine();    //run the state machine
-        if (alarm_sounding == 1 && !alarm_silenced) {
-          delayMs(2);
-          toggleLed(0);
-        }
+        schedulerRun();    //run the highest priority ready task
     }
 }
 
@@ -192,24 +382,13 @@ void structInit() {
   
   int i;
   for (i = 0; i < NUM_DEVICES; i++) {
-    routers[i].LQI = 0;
-    routers[i].LQI_average = 0;
-    routers[i].LQI_initialized = 0;
-    routers[i].LQI_iter = 0;
-    routers[i].LQI_total = 0;
-
-    int j = 0;
-    for (j = 0; j < 8; j++) {
-      routers[i].MAC_address[i] = 0;
-    }
-
-    int k = 0;
-    for (k = 0; k < LQI_NUM_SAMPLES; k++) {
-      routers[i].LQI_running_average[k] = 0;
-    }
-      
-    routers[i].track_state = ALL_ITEMS_CONNECTED;
+    trackingInitDevice(&routers[i]);
+    routers[i].short_address = SHORT_ADDRESS_UNKNOWN;
+    routers[i].last_seq = 0;
+    routers[i].seq_window = 0;
+    routers[i].tokens = RATE_LIMIT_BURST;
   }
+  reportInit();
 }
 
 /*
@@ -230,288 +409,541 @@ Selects which KVP value is displayed on the RGB LED.
 */
 void processButtonPress()
 {
-  if (alarm_sounding == 1) {
-      halRgbSetLeds(0, 0xFF, 0);
+  if ((alarm_sounding == 1) && !alarm_silenced) {
       alarm_silenced = 1;
+      logEvent(JOURNAL_ALARM_SILENCED, 0);
+      schedulerPost(TASK_ALARM_OUTPUT);
   }
 }
 
 void processButtonHold()
 {
+  halRgbAnimationStop();
+  rgb_status = RGB_STATUS_NONE;
   if (coordinator_on == 0) {
     coordinator_on = 1;
     halRgbSetLeds(0, 0, 0);
+    logEvent(JOURNAL_COORDINATOR_ON, 0);
+    /* SRDY is edge triggered, so a frame left pending while off won't post reception by itself */
+    schedulerPost(TASK_MESSAGE_RECEPTION);
   }
   else {
     coordinator_on = 0;
     halRgbSetLeds(0xFF, 0xFF, 0xFF);
+    logEvent(JOURNAL_COORDINATOR_OFF, 0);
   }
 }
 
+#define BUTTON_DEBOUNCE_TIME_MS  150    // How long to poll the button, total
+#define BUTTON_DEBOUNCE_HOLD_TIME_MS  5000    // How long to poll the button for a hold, total
+
+/** Phases of the button debouncer */
+#define BUTTON_IDLE                     0
+#define BUTTON_DEBOUNCE_PRESS           1
+#define BUTTON_DEBOUNCE_HOLD            2
+
+/** Which phase the debouncer is in. Read by handleSysTick() to know whether to post the button task. */
+static volatile uint8_t buttonPhase = BUTTON_IDLE;
+static uint32_t buttonPhaseStart = 0;           // halMillis() when the current phase started
+static uint32_t buttonLastSample = 0;           // halMillis() when the button was last polled
+static int16_t buttonOnCount = 0;               // Number of times button was polled and ON
+static int16_t buttonOffCount = 0;              // Number of times button was polled and OFF 
+
 /** 
-Simple button debouncing routine. Polls the button every few milliseconds and adds up the number of 
-times that button is ON vs. OFF. At the end of the time period if the number of times that the 
-button is ON is greater than the number of times that it is OFF then the button is determined to be 
-pressed.
-@return 1 if button is pressed, else 0
-@note If you have more sophisticated processor (e.g. more timers available) then there are better 
-ways of implementing this.
+Non-blocking button debouncing routine. Polls the button once per sysTick and adds up the number of 
+times that button is ON vs. OFF. At the end of BUTTON_DEBOUNCE_TIME_MS, if the number of times that 
+the button is ON is greater than the number of times that it is OFF then the button is determined 
+to be pressed. The same is then done for BUTTON_DEBOUNCE_HOLD_TIME_MS to detect a hold.
+Started by buttonDebounceStart(), and then posted by handleSysTick() while debouncing.
 */
-static uint8_t debounceButton(uint8_t button)
+static void buttonTask()
 {
-#define BUTTON_DEBOUNCE_TIME_MS  150    // How long to poll the button, total
-#define BUTTON_POLL_INTERVAL_MS 5       // How long to wait between polling button
-    int16_t time = 0;                   // The amount of time that has elapsed in the debounce routine
-    int16_t buttonOnCount = 0;          // Number of times button was polled and ON
-    int16_t buttonOffCount = 0;         // Number of times button was polled and OFF 
+    uint32_t now = halMillis();
     
-    while (time < BUTTON_DEBOUNCE_TIME_MS)
+    if (buttonPhase == BUTTON_IDLE)
     {
-        if (buttonIsPressed(button))
-            buttonOnCount++;
-        else
-            buttonOffCount++;
-        time += BUTTON_POLL_INTERVAL_MS;
-        delayMs(BUTTON_POLL_INTERVAL_MS);
+        return;
+    } 
+    else if (now == buttonLastSample)           // Already polled this sysTick
+    {
+        return;
+    }
+    
+    buttonLastSample = now;
+    if (buttonIsPressed(ANY_BUTTON))
+        buttonOnCount++;
+    else
+        buttonOffCount++;
+    
+    if (buttonPhase == BUTTON_DEBOUNCE_PRESS)
+    {
+        if ((now - buttonPhaseStart) >= BUTTON_DEBOUNCE_TIME_MS)
+        {
+            if (buttonOnCount > buttonOffCount)
+                processButtonPress();
+            buttonPhase = BUTTON_DEBOUNCE_HOLD;
+            buttonPhaseStart = now;
+            buttonOnCount = 0;
+            buttonOffCount = 0;
+        }
+    } 
+    else if ((now - buttonPhaseStart) >= BUTTON_DEBOUNCE_HOLD_TIME_MS)
+    {
+        if (buttonOnCount > buttonOffCount)
+            processButtonHold();
+        buttonPhase = BUTTON_IDLE;
     }
+}
+
+/** 
+Reads and processes the received frames, if any. Posted by the SRDY ISR, and by the maintenance task 
+whenever a frame is waiting, in case an edge was missed or arrived while the coordinator was off.
+*/
+static void messageReceptionTask()
+{
+    if ((zigbeeNetworkStatus != NWK_ONLINE) || (coordinator_on == 0))
+        return;
+    if (moduleAsyncIsBusy())                    // Posted again when the command completes
+        return;
+    if (!moduleHasMessageWaiting())             // SRDY also toggles during synchronous commands
+        return;
     
-    return (buttonOnCount > buttonOffCount);
+    halClockSet(HAL_CLOCK_BURST);               // Process bursts at full speed, from the next sysTick
+    uint8_t batch = 0;
+    do {
+        messageTimestamp = halSrdyTimestamp();  // Before anything else can move SRDY
+        lastMessageTime = halMillis();
+        parseMessages();                        // ... then display it
+    } while ((++batch < MESSAGE_BATCH_MAX) && moduleHasMessageWaiting());
+    if (tracking_pending)
+        schedulerPost(TASK_TRACKING);
+    if (moduleHasMessageWaiting())              // Come back for the rest once tracking has run
+        schedulerPost(TASK_MESSAGE_RECEPTION);
+}
+
+/** Evaluates the tracking algorithm for the routers heard from in the last batch of messages. */
+static void trackingTask()
+{
+    trackingStateMachine();
 }
 
-static uint8_t debounceButtonHold(uint8_t button)
+/** 
+Drives the RGB LED to match the alarm state decided by trackingStateMachine(). The LED is animated 
+from the sysTick (see hal_rgb.h), so this only starts the animation when the state changes.
+*/
+static void alarmOutputTask()
 {
-#define BUTTON_DEBOUNCE_HOLD_TIME_MS  5000    // How long to poll the button, total
-#define BUTTON_POLL_INTERVAL_MS 5       // How long to wait between polling button
-    int16_t time = 0;                   // The amount of time that has elapsed in the debounce routine
-    int16_t buttonOnCount = 0;          // Number of times button was polled and ON
-    int16_t buttonOffCount = 0;         // Number of times button was polled and OFF 
+    uint8_t status;
+    if (alarm_sounding == 1)
+        status = alarm_silenced ? RGB_STATUS_SILENCED : RGB_STATUS_LOST;
+    else
+        status = RGB_STATUS_CONNECTED;
+    if (status == rgb_status)
+        return;
+    rgb_status = status;
     
-    while (time < BUTTON_DEBOUNCE_HOLD_TIME_MS)
+    switch (status)
     {
-        if (buttonIsPressed(button))
-            buttonOnCount++;
-        else
-            buttonOffCount++;
-        time += BUTTON_POLL_INTERVAL_MS;
-        delayMs(BUTTON_POLL_INTERVAL_MS);
+    case RGB_STATUS_LOST:
+        halRgbAnimationStart(HAL_RGB_WAVE_BLINK, 0xFF, 0, 0, 125);             // Red, 4 blinks/sec
+        LATENCY_RECORD(LATENCY_STAGE_OUTPUT, alarm_timestamp);
+        break;
+    case RGB_STATUS_SILENCED:
+        halRgbAnimationStart(HAL_RGB_WAVE_BREATHE, 0, 0xFF, 0, 30);            // Blue, 2 sec
+        break;
+    default:
+        halRgbAnimationStart(HAL_RGB_WAVE_BREATHE, 0, 0, 0xFF, 60);            // Green, 4 sec
+        break;
     }
-    
-    return (buttonOnCount > buttonOffCount);
 }
 
 /** 
-The main state machine for the application.
-Never exits.
+Starts debouncing a button press, from when the button ISR saw it. Further presses while debouncing 
+are bounces, and are ignored.
 */
-void stateMachine()
+static void buttonDebounceStart(uint32_t pressedAt)
+{
+    if (buttonPhase != BUTTON_IDLE)
+        return;
+    buttonPhase = BUTTON_DEBOUNCE_PRESS;
+    buttonPhaseStart = pressedAt;
+    buttonOnCount = 0;
+    buttonOffCount = 0;
+    schedulerPost(TASK_BUTTON);
+}
+
+/** Handles a single-character command received on the debug console. */
+static void consoleCommand(int8_t c)
 {
- //   while (1)
-  //  {
-        if (zigbeeNetworkStatus == NWK_ONLINE)
+    switch (c)
+    {
+    case 's':
+#ifdef LATENCY_INSTRUMENTATION
+        schedulerDisplayStats();
+        moduleAsyncDisplayStats();
+#endif
+        outPrintf("EVENTS: %u OVERFLOWED\r\n", eventQueueOverflows());
+        break;
+    case 'v':
+        outPrintf("VCC=%umV, CURRENT=%u.%umA\r\n", getVcc3(), getCurrentSensor() / 10, getCurrentSensor() % 10);
+        break;
+#ifdef LATENCY_INSTRUMENTATION
+    case 'S':
+        schedulerClearStats();
+        moduleAsyncClearStats();
+        break;
+#endif
+    case 't':
+        lastSnapshotTime = halMillis();
+        reportSnapshot(&tracking, lastSnapshotTime);
+        break;
+    case 'f':
+        outPrintf("DROPPED: %u DUPLICATES, %u RATE LIMITED\r\n", duplicatesDropped, rateLimitDropped);
+        break;
+    case 'F':
+        duplicatesDropped = 0;
+        rateLimitDropped = 0;
+        break;
+    case 'm':
+        displayRamUsage();
+        break;
+    case 'j':
+        outPrintf("JOURNAL: %u PENDING, %u DROPPED\r\n", journalPendingCount(), journalDroppedCount());
+        journalDumpStart();
+        journalDumping = 1;
+        schedulerPost(TASK_JOURNAL);
+        break;
+#ifdef LATENCY_HISTOGRAMS
+    case 'l':
+        latencyDisplay();
+        break;
+    case 'L':
+        latencyClear();
+        break;
+#endif
+#ifdef ENERGY_PROFILING
+    case 'e':
+        halEnergyDisplay();
+        break;
+    case 'E':
+        if (halEnergyProfilingStart() != 0)
+            outStr("ERROR: ADC sampler not running\r\n");
+        else
+            outStr("Energy profiling started\r\n");
+        break;
+#endif
+#ifdef PC_PROFILING
+    case 'p':
+        if (halProfilerIsRunning())
         {
-            if(moduleHasMessageWaiting())      //wait until SRDY goes low indicating a message has been received. 
-                stateFlags |= STATE_FLAG_MESSAGE_WAITING;
+            halProfilerStop();
+            outStr("Profiler stopped\r\n");
         }
-        
-        switch (state)
+        else if (halProfilerStart(HAL_PROFILER_CODE_START, HAL_PROFILER_CODE_END, HAL_PROFILER_DIVIDER) != 0)
+            outStr("ERROR: RGB LED PWM not running\r\n");
+        else
+            outStr("Profiler started\r\n");
+        break;
+    case 'P':
+        halProfilerDisplay();
+        break;
+    case 'z':
+        if (halProfilerZoom() != 0)
+            outStr("ERROR: nothing to zoom into\r\n");
+        else
+            outStr("Profiler zoomed\r\n");
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+/** 
+Handles the next event queued by the ISRs, one per run so that the alarm path can run in between. 
+*/
+static void eventTask()
+{
+    struct event e;
+    if (!eventQueuePop(&e))
+        return;
+    switch (e.type)
+    {
+    case EVENT_BUTTON:
+        buttonDebounceStart(e.timestamp);
+        break;
+    case EVENT_CONSOLE:
+        consoleCommand((int8_t) e.source);
+        break;
+    default:
+        break;
+    }
+    if (eventQueueCount() > 0)
+        schedulerPost(TASK_EVENT);
+}
+
+/** halMillis() when startModule() last failed, valid if moduleStartFailed */
+static uint32_t moduleStartFailedTime = 0;
+static uint8_t moduleStartFailed = 0;
+
+/** 
+Module startup and other periodic housekeeping. Runs every MAINTENANCE_PERIOD_MS, and is also posted 
+directly to move through the startup states.
+*/
+static void maintenanceTask()
+{
+    refillRateLimiters();
+    if (journalPendingCount() > 0)
+        schedulerPost(TASK_JOURNAL);            // Retries writes deferred while VCC was low
+    switch (state)
+    {
+    case STATE_IDLE:
         {
-        case STATE_IDLE:
+            if ((halClockGet() != HAL_CLOCK_IDLE) && 
+                ((halMillis() - lastMessageTime) >= CLOCK_IDLE_TIMEOUT_MS))
             {
-                if (stateFlags & STATE_FLAG_MESSAGE_WAITING & coordinator_on)    // If there is a message waiting...
-                {
-                    parseMessages();                            // ... then display it
-                    trackingStateMachine(current_router_index);
-                    stateFlags &= ~STATE_FLAG_MESSAGE_WAITING;
-                }
-                
-                if (stateFlags & STATE_FLAG_BUTTON_PRESSED)     // If ISR set this flag...
-                {
-                    if (debounceButton(ANY_BUTTON))             // ...then debounce it
-                    {
-                        processButtonPress();                   // ...and process it
-                    }
-                    if (debounceButtonHold(ANY_BUTTON))
-                    {
-                        processButtonHold();
-                    }
-                    stateFlags &= ~STATE_FLAG_BUTTON_PRESSED;
-                }
-                
-                /* Other flags (for different messages or events) can be added here */
-                break;
+                halClockSet(HAL_CLOCK_IDLE);        // Idle cheaper
             }
-            
-        case STATE_MODULE_STARTUP:              // Start the Zigbee Module on the network
+            mgmtLqiPoll();
+            if (moduleHasMessageWaiting())      // Level triggered backstop, in case an SRDY edge was missed
+                schedulerPost(TASK_MESSAGE_RECEPTION);
+            if ((halMillis() - lastSnapshotTime) >= REPORT_SNAPSHOT_PERIOD_MS)
             {
-#define MODULE_START_DELAY_IF_FAIL_MS 5000
-                moduleResult_t result;
-                struct moduleConfiguration defaultConfiguration = DEFAULT_MODULE_CONFIGURATION_COORDINATOR;
-                
-                /* Uncomment below to restrict the device to a specific PANID
-                defaultConfiguration.panId = 0x1234;
-                */
-                
-                /* Below is an example of how to restrict the device to only one channel:
-                defaultConfiguration.channelMask = CHANNEL_MASK_17;
-                printf("DEMO - USING CUSTOM CHANNEL 17\r\n");
-                */
-                
-                while ((result = startModule(&defaultConfiguration, GENERIC_APPLICATION_CONFIGURATION)) != MODULE_SUCCESS)
-                {
-                    printf("FAILED. Error Code 0x%02X. Retrying...\r\n", result);
-                    delayMs(MODULE_START_DELAY_IF_FAIL_MS);
-                }
-                //printf("Success\r\n");
-                zigbeeNetworkStatus = NWK_ONLINE;
-                
-                state = STATE_DISPLAY_NETWORK_INFORMATION;
-                break;
+                lastSnapshotTime = halMillis();
+                reportSnapshot(&tracking, lastSnapshotTime);
             }
-        case STATE_DISPLAY_NETWORK_INFORMATION:
+            uint16_t vcc = getVcc3();           // Latest filtered value, does not block
+            if ((vcc != 0) && ((vcc < VCC_LOW_THRESHOLD_MV) != vccLow))
             {
-                printf("~ni~");
-                /* On network, display info about this network */
-                displayNetworkConfigurationParameters();
-                displayDeviceInformation();
-                if (sysGpio(GPIO_SET_DIRECTION, ALL_GPIO_PINS) != MODULE_SUCCESS)   //Set module GPIOs as output
-                {
-                    printf("ERROR\r\n");
-                }
-                /*
-                printf("Press button to change which received value is displayed on RGB LED. D6 & D5 will indicate mode:\r\n");
-                printf("    None = None\r\n");
-                printf("    Yellow (D9) = IR Temp Sensor\r\n");
-                printf("    Red (D8) = Color Sensor\r\n");
-                */
-                printf("Displaying Messages Received\r\n");
-                setModuleLeds(RGB_LED_DISPLAY_MODE_NONE);
-                
-                /* Now the network is running - wait for any received messages from the ZM */
-#ifdef VERBOSE_MESSAGE_DISPLAY    
-                printAfIncomingMsgHeaderNames();
-#endif                
-                state = STATE_IDLE;
-                break;
+                vccLow = !vccLow;
+                outPrintf("VCC %s: %umV\r\n", vccLow ? "LOW" : "OK", vcc);
             }
+            /* Other periodic housekeeping can be added here */
+            break;
+        }
+        
+    case STATE_MODULE_STARTUP:              // Start the Zigbee Module on the network
+        {
+#define MODULE_START_DELAY_IF_FAIL_MS 5000
+            moduleResult_t result;
+            struct moduleConfiguration defaultConfiguration = DEFAULT_MODULE_CONFIGURATION_COORDINATOR;
+            
+            /* Uncomment below to restrict the device to a specific PANID
+            defaultConfiguration.panId = 0x1234;
+            */
+            
+            /* Below is an example of how to restrict the device to only one channel:
+            defaultConfiguration.channelMask = CHANNEL_MASK_17;
+            outStr("DEMO - USING CUSTOM CHANNEL 17\r\n");
+            */
+            
+            if (moduleStartFailed && ((halMillis() - moduleStartFailedTime) < MODULE_START_DELAY_IF_FAIL_MS))
+                break;                          // Still waiting to retry
             
-        default:     //should never happen
+            moduleAsyncInit();                  // Commands for the module as it was are meaningless now
+            if ((result = startModule(&defaultConfiguration, GENERIC_APPLICATION_CONFIGURATION)) != MODULE_SUCCESS)
             {
-                printf("UNKNOWN STATE\r\n");
-                state = STATE_MODULE_STARTUP;
+                outPrintf("FAILED. Error Code 0x%02X. Retrying...\r\n", result);
+                logEvent(JOURNAL_MODULE_START_FAILED, (uint8_t) result);
+                moduleStartFailed = 1;
+                moduleStartFailedTime = halMillis();
+                break;
             }
+            //printf("Success\r\n");
+            zigbeeNetworkStatus = NWK_ONLINE;
+            
+            state = STATE_DISPLAY_NETWORK_INFORMATION;
+            schedulerPost(TASK_MAINTENANCE);
             break;
         }
- //   } 
-}    
+    case STATE_DISPLAY_NETWORK_INFORMATION:
+        {
+            outStr("~ni~");
+            /* On network, display info about this network */
+            displayNetworkConfigurationParameters();
+            displayDeviceInformation();
+            moduleAsyncSysGpio(GPIO_SET_DIRECTION, ALL_GPIO_PINS, moduleGpioDone);  //Set module GPIOs as output
+            /*
+            outStr("Press button to change which received value is displayed on RGB LED. D6 & D5 will indicate mode:\r\n");
+            outStr("    None = None\r\n");
+            outStr("    Yellow (D9) = IR Temp Sensor\r\n");
+            outStr("    Red (D8) = Color Sensor\r\n");
+            */
+            outStr("Displaying Messages Received\r\n");
+            setModuleLeds(RGB_LED_DISPLAY_MODE_NONE);
+            
+            /* Now the network is running - wait for any received messages from the ZM */
+#ifdef VERBOSE_MESSAGE_DISPLAY    
+            printAfIncomingMsgHeaderNames();
+#endif                
+            state = STATE_IDLE;
+            schedulerPost(TASK_MESSAGE_RECEPTION);  // Anything that arrived while starting up
+            break;
+        }
+        
+    default:     //should never happen
+        {
+            outStr("UNKNOWN STATE\r\n");
+            state = STATE_MODULE_STARTUP;
+        }
+        break;
+    }
+}
 
-void trackingStateMachine(int router_index) {
-  if (routers[router_index].LQI != 0) {
-    
-    if (routers[router_index].LQI_iter == LQI_NUM_SAMPLES) {
-      routers[router_index].LQI_iter = 0;
-      routers[router_index].LQI_initialized = 1;
+/** 
+Sends the queued module commands, see module_async.h. Re-posts itself while a command is waiting for 
+SRDY, so that higher priority tasks run in between the steps of the handshake.
+*/
+static void moduleCommandTask()
+{
+    if (moduleAsyncRun())
+        schedulerPost(TASK_MODULE_COMMAND);
+    else if (moduleHasMessageWaiting())
+        schedulerPost(TASK_MESSAGE_RECEPTION);  // Held off while the module was busy
+}
+
+/** 
+Writes the event journal to flash one operation at a time, and streams it to the console when asked. 
+Lowest priority, since a segment erase stalls the CPU for ~11ms.
+*/
+static void journalTask()
+{
+    if (journalDumping)                         // Don't move the journal while it's being read
+    {
+        uint8_t i;
+        for (i = 0; i < JOURNAL_DUMP_BATCH; i++)
+        {
+            if (!journalDumpNext())
+            {
+                journalDumping = 0;
+                break;
+            }
+        }
+        schedulerPost(TASK_JOURNAL);
+        return;
     }
-    
-    uint8_t oldest_LQI = routers[router_index].LQI_running_average[(routers[router_index].LQI_iter)];
-    routers[router_index].LQI_running_average[routers[router_index].LQI_iter] = routers[router_index].LQI;
-    
-    if (routers[router_index].LQI_initialized == 1)
-      routers[router_index].LQI_total -= oldest_LQI;
-    routers[router_index].LQI_total += routers[router_index].LQI;
+    if (journalFlush())
+        schedulerPost(TASK_JOURNAL);
+}
 
-    routers[router_index].LQI_average = routers[router_index].LQI_total / LQI_NUM_SAMPLES;
-    routers[router_index].LQI_iter++;
+/** 
+Prints RAM used by each segment and by the stack so far, and by the tables that scale with 
+NUM_DEVICES, so that they can be sized to fit.
+*/
+static void displayRamUsage()
+{
+    halRamDisplay();
+    outPrintf("TABLES: routers=%u (%u x %u), tracking_updated=%u, zmBuf=%u; infoMessage=%u on the stack\r\n", 
+              (uint16_t) sizeof(routers), NUM_DEVICES, (uint16_t) sizeof(struct router_device),
+              (uint16_t) sizeof(tracking_updated), ZIGBEE_MODULE_BUFFER_SIZE, 
+              (uint16_t) sizeof(struct infoMessage));
+}
+
+/** Records an event in the journal; it is written to flash later by journalTask() */
+static void logEvent(uint8_t event, uint8_t arg)
+{
+    journalLog(event, arg);
+    schedulerPost(TASK_JOURNAL);
+}
+
+/** 
+Runs whenever no task is ready. Sounds the buzzer while the alarm is active. Each pass blocks for at 
+most 2mSec, which bounds how long a newly posted task can wait behind it.
+*/
+static void idleTask()
+{
+    if (alarm_sounding == 1 && !alarm_silenced) {
+      delayMs(2);
+      toggleLed(0);
+    }
+}
+
+/** 
+Feeds a new LQI sample for routers[router_index] into its filter and marks the device for the next 
+trackingStateMachine() pass. Decisions are deferred so that a burst of messages is evaluated, printed 
+and acted on once.
+*/
+static void trackingSample(int router_index, uint8_t lqi)
+{
+  routers[router_index].LQI = lqi;
+  routers[router_index].rx_timestamp = messageTimestamp;
+  if (trackingUpdate(&tracking, router_index))
+    trackingMark(router_index);
+}
+
+/** Marks a device for evaluation by the next trackingStateMachine() pass */
+static void trackingMark(int router_index)
+{
+  tracking_updated[router_index >> 3] |= (1 << (router_index & 0x07));
+  tracking_pending = 1;
+}
+
+/** 
+Evaluates every device sampled since the last pass, then prints the table and updates the alarm once. 
+*/
+void trackingStateMachine() {
+  if (tracking_pending) {
+    tracking_pending = 0;
     
-    int i, j, k;
+    int i;
+    uint8_t events = 0;
+    int lost_index = -1;
     for (i = 0; i < NUM_DEVICES; i++) {
-      printf("Most recent LQI value: %02X\r\n", routers[i].LQI);      
-      
-      printf("LQI ARRAY for device at MAC address: ");
-      for (k = 7; k >= 0; k--) {
-        printf("%02X", routers[i].MAC_address[k]);
-      }
-      printf("\r\n");
-      for (j = 0; j < LQI_NUM_SAMPLES; j++) {
-        printf("%d:", j);
-        printf("%02X ", routers[i].LQI_running_average[j]);
-      }
-      printf("\r\n");
-      printf("AVERAGE: %02X\r\n", routers[i].LQI_average);
+      uint8_t mask = (1 << (i & 0x07));
+      if (!(tracking_updated[i >> 3] & mask))
+        continue;
+      tracking_updated[i >> 3] &= ~mask;
+      uint8_t e = trackingEvaluate(&tracking, i);
+      LATENCY_RECORD(LATENCY_STAGE_DECISION, routers[i].rx_timestamp);
+      if ((e & TRACKING_EVENT_DEVICE_LOST) && (lost_index < 0))
+        lost_index = i;
+      events = e;                 // Last one evaluated has seen every state change in this pass
     }
-   
-    switch(routers[router_index].track_state) {
-      
-    case ALL_ITEMS_CONNECTED:
-      alarm_silenced = 0;
-      if (alarm_sounding == 0) {
-        int items_connected = 0;
-        int j;
-        for (j = 0; j < NUM_DEVICES; j++) {
-          if (routers[router_index].track_state == ALL_ITEMS_CONNECTED)
-            items_connected++;
-        }
-        if (items_connected == NUM_DEVICES)
-          printf("ALL DEVICES CONNECTED\r\n");
-
-        halRgbSetLeds(0, 0, 0xFF);
-      }
-      if (routers[router_index].LQI_average < LQI_THRESHOLD && routers[router_index].LQI_initialized == 1) {
-          routers[router_index].track_state = ITEM_LOST_ALARM;
-      }
-      break;
-    /*
-    case SUSPECTED_ITEM_LOSS:
-      halRgbSetLeds(0, 0xFF, 0);
-      if (LQI_average < LQI_THRESHOLD && LQI_initialized == 1) {
-          track_state = ITEM_LOST_ALARM;
-      }
-      else {
-        track_state = ALL_ITEMS_CONNECTED;
-      }
-      break;
-    */
-    case ITEM_LOST_ALARM:
-      printf("LOST ITEM AT ROUTER INDEX: %d\r\n", router_index);
+    
+    reportChanges(&tracking);
+    
+    /* The alarm sounds while any device is lost; alarmOutputTask() drives the outputs. Only changes 
+    are printed; which devices are lost is in the records printed by reportChanges(). */
+    if (lost_index >= 0) {
       if (alarm_sounding == 0) {
-        halRgbSetLeds(0xFF, 0, 0);
+        outStr("LOST ITEM AT ROUTER INDEX: ");
+        outUnsigned(lost_index);
+        outNewline();
         alarm_sounding = 1;
+        alarm_timestamp = routers[lost_index].rx_timestamp;
+        logEvent(JOURNAL_ALARM_ON, (uint8_t) lost_index);
+        schedulerPost(TASK_ALARM_OUTPUT);
       }
-      if (routers[router_index].LQI_average > LQI_THRESHOLD) {
-        routers[router_index].track_state = ALL_ITEMS_CONNECTED;
-      }
-      int i;
-      int devices_connected = 0;
-      for (i = 0; i < NUM_DEVICES; i++) {
-        if (routers[router_index].track_state == ALL_ITEMS_CONNECTED)
-          devices_connected++;
-      }
-      if (devices_connected == NUM_DEVICES)
+    }
+    if (events & TRACKING_EVENT_ALL_CONNECTED) {
+      if (alarm_sounding == 1) {
+        outStr("ALL DEVICES CONNECTED\r\n");
         alarm_sounding = 0;
-      break;
-    
-      /*
-    case ITEM_LOST_SILENCED:
-      halRgbSetLeds(0, 0xFF, 0);
-      if (routers[router_index].LQI_average > LQI_THRESHOLD) {
-        routers[router_index].track_state = ALL_ITEMS_CONNECTED;
+        alarm_silenced = 0;
+        logEvent(JOURNAL_ALARM_OFF, 0);
       }
-      break;  
-      */
+      schedulerPost(TASK_ALARM_OUTPUT);
     }
   }
 }
 
-
 /** Parse any received messages. If it's one of our OIDs then display the value on the RGB LED too. */
 void parseMessages()
 {
     getMessage();
+    LATENCY_RECORD(LATENCY_STAGE_GET_MESSAGE, messageTimestamp);
+    if ((zmBuf[SRSP_LENGTH_FIELD] > 0) && (IS_AF_INCOMING_MESSAGE()) && !acceptIncomingMessage())
+    {
+        zmBuf[SRSP_LENGTH_FIELD] = 0;               // Duplicate, or sender is over its rate limit
+        return;
+    }
     if ((zmBuf[SRSP_LENGTH_FIELD] > 0) && (IS_AF_INCOMING_MESSAGE()))
     {
+        ENERGY_COUNT_MESSAGE();
         setLed(4);                                  //LED will blink to indicate a message was received
 #ifdef VERBOSE_MESSAGE_DISPLAY
         printAfIncomingMsgHeader(zmBuf);
-        printf("\r\n");
+        outNewline();
 #endif
         if ((AF_INCOMING_MESSAGE_CLUSTER()) == INFO_MESSAGE_CLUSTER)
         {
@@ -522,11 +954,8 @@ void parseMessages()
             printInfoMessage(&im);
             displayZmBuf();
 #else
-            printf("From:");                        // Display the sender's MAC address
-            for (j = 7; j>(-1); j--)
-            {
-                printf("%02X", im.header.mac[j]);
-            }
+            outStr("From:");                        // Display the sender's MAC address
+            outHexBytesReversed(im.header.mac, 8);
             int k;
             for (k = 0; k < NUM_DEVICES; k++) {
               int match = 1;
@@ -536,25 +965,36 @@ void parseMessages()
                 }
               }
               if (match == 1) {
-                current_router_index = k;
-                routers[current_router_index].LQI = zmBuf[AF_INCOMING_MESSAGE_LQI_FIELD];
+                trackingSample(k, zmBuf[AF_INCOMING_MESSAGE_LQI_FIELD]);
+                learnShortAddress(k);
               }
             }
             
-            printf(", LQI=%02X, ", zmBuf[AF_INCOMING_MESSAGE_LQI_FIELD]);   // Display the received signal quality (Link Quality Indicator)
+            outStr(", LQI=");                                               // Display the received signal quality (Link Quality Indicator)
+            outHex8(zmBuf[AF_INCOMING_MESSAGE_LQI_FIELD]);
+            outStr(", T=");                                                 // ...and when it was received, in mSec
+            outUnsigned(messageTimestamp);
+            outStr(", ");
             //LQI = zmBuf[AF_INCOMING_MESSAGE_LQI_FIELD];
 
 #endif
-            printf("%u KVPs received:\r\n", im.numParameters);
+            outUnsigned(im.numParameters);
+            outStr(" KVPs received:\r\n");
 #define NO_VALUE_RECEIVED   0xFF
             uint8_t redIndex = NO_VALUE_RECEIVED; 
             uint8_t blueIndex = NO_VALUE_RECEIVED;
             uint8_t greenIndex = NO_VALUE_RECEIVED;
             for (j=0; j<im.numParameters; j++)                              // Iterate through all the received KVPs
             {
-                printf("    %s (0x%02X) = %d  ", getOidName(im.kvps[j].oid), im.kvps[j].oid, im.kvps[j].value);    // Display the Key & Value
+                outStr("    ");                                             // Display the Key & Value
+                outStr(getOidName(im.kvps[j].oid));
+                outStr(" (0x");
+                outHex8(im.kvps[j].oid);
+                outStr(") = ");
+                outSigned(im.kvps[j].value);
+                outStr("  ");
                 displayFormattedOidValue(im.kvps[j].oid, im.kvps[j].value);
-                printf("\r\n");
+                outNewline();
                 // If the received OID was an IR temperature OID then we can just display it on the LED
                 if ((rgbLedDisplayMode == RGB_LED_DISPLAY_MODE_TEMP_IR) && (im.kvps[j].oid == OID_TEMPERATURE_IR)) 
                     displayTemperatureOnRgbLed(im.kvps[j].value);
@@ -576,23 +1016,250 @@ void parseMessages()
             {
                 displayColorOnRgbLed(RED_VALUE, BLUE_VALUE, GREEN_VALUE);
             }
-            printf("\r\n");
+            outNewline();
             
         } else {
-            printf("Rx: ");
+            outStr("Rx: ");
             printHexBytes(zmBuf+SRSP_HEADER_SIZE+17, zmBuf[SRSP_HEADER_SIZE+16]);   //print out message payload
         }
         clearLeds(0);    
+        LATENCY_RECORD(LATENCY_STAGE_PARSE, messageTimestamp);
+    } else if (IS_ZDO_MGMT_LQI_RSP()) {
+        handleMgmtLqiResponse();
+    } else if (IS_ZDO_LEAVE_IND()) {
+        handleZdoLeaveIndication();
+    } else if (IS_ZDO_STATUS_ERROR_RSP()) {
+        handleZdoStatusError();
     } else if (IS_ZDO_END_DEVICE_ANNCE_IND()) {
         displayZdoEndDeviceAnnounce(zmBuf);
     } else { //unknown message, just print out the whole thing
-        printf("MSG: ");
+        outStr("MSG: ");
         printHexBytes(zmBuf, (zmBuf[SRSP_LENGTH_FIELD] + SRSP_HEADER_SIZE));
     }
     zmBuf[SRSP_LENGTH_FIELD] = 0;
 }
 
 
+/** 
+Decides whether the AF incoming message in zmBuf should be processed, see SEQ_WINDOW_SIZE. Updates 
+the sender's sequence window and rate limiter, and the drop counters.
+@return 1 to process the message, 0 to drop it
+*/
+static uint8_t acceptIncomingMessage()
+{
+    uint16_t shortAddress = AF_INCOMING_MESSAGE_SHORT_ADDRESS();
+    uint8_t seq = AF_INCOMING_MESSAGE_SEQ();
+    int i = findRouterByShortAddress(shortAddress);
+    if (i < 0)
+        return 1;                                   // Not learned yet
+    struct router_device* r = &routers[i];
+    
+    uint8_t ahead = seq - r->last_seq;              // Modulo 256
+    if (ahead == 0)
+    {
+        duplicatesDropped++;
+        return 0;
+    }
+    if (ahead < 0x80)                               // Newer: slide the window up
+    {
+        r->seq_window = (ahead > SEQ_WINDOW_SIZE) ? 0 : 
+            (uint8_t) ((r->seq_window << ahead) | (1 << (ahead - 1)));
+        r->last_seq = seq;
+    } else {
+        uint8_t behind = (uint8_t) (0 - ahead);
+        if (behind > SEQ_WINDOW_SIZE)               // Far behind: the sender probably restarted
+        {
+            r->last_seq = seq;
+            r->seq_window = 0;
+        } else if (r->seq_window & (1 << (behind - 1))) {
+            duplicatesDropped++;
+            return 0;
+        } else {
+            r->seq_window |= (1 << (behind - 1));   // Late, but not seen before
+        }
+    }
+    
+    if (r->tokens == 0)
+    {
+        rateLimitDropped++;
+        return 0;
+    }
+    r->tokens--;
+    return 1;
+}
+
+/** 
+Associates the sender of the AF incoming message in zmBuf with routers[router_index], so that its 
+later messages can be filtered before being deserialized. Called once the sender has been matched by MAC.
+*/
+static void learnShortAddress(int router_index)
+{
+    uint16_t shortAddress = AF_INCOMING_MESSAGE_SHORT_ADDRESS();
+    if (routers[router_index].short_address == shortAddress)
+        return;
+    int i;
+    for (i = 0; i < NUM_DEVICES; i++)               // Short addresses can be reassigned on rejoin
+        if (routers[i].short_address == shortAddress)
+            routers[i].short_address = SHORT_ADDRESS_UNKNOWN;
+    routers[router_index].short_address = shortAddress;
+    routers[router_index].last_seq = AF_INCOMING_MESSAGE_SEQ();
+    routers[router_index].seq_window = 0;
+}
+
+/** 
+Starts a neighbor table poll if one is due, requests the next page of one in progress, and abandons 
+one that has timed out. Called from the maintenance task.
+*/
+static void mgmtLqiPoll()
+{
+    uint32_t elapsed = halMillis() - mgmtLqiTime;
+    if ((mgmtLqiPolling == MGMT_LQI_WAITING) && (elapsed >= MGMT_LQI_TIMEOUT_MS))
+        mgmtLqiPolling = MGMT_LQI_IDLE;
+    if ((mgmtLqiPolling == MGMT_LQI_IDLE) && (elapsed >= MGMT_LQI_PERIOD_MS))
+    {
+        mgmtLqiIndex = 0;
+        mgmtLqiPolling = MGMT_LQI_PAGE_DUE;
+    }
+    if (mgmtLqiPolling == MGMT_LQI_PAGE_DUE)
+    {
+        mgmtLqiTime = halMillis();
+        if (mgmtLqiRequest(COORDINATOR_SHORT_ADDRESS, mgmtLqiIndex, mgmtLqiRequestDone) == 0)
+        {
+            mgmtLqiPolling = MGMT_LQI_WAITING;
+            schedulerPost(TASK_MODULE_COMMAND);
+        }                                       // else the queue is full: try again next time
+    }
+}
+
+/** Called when a queued Mgmt_Lqi request completes. Abandons the poll if the module refused it. */
+static void mgmtLqiRequestDone(moduleResult_t result)
+{
+    if (mgmtLqiPolling != MGMT_LQI_WAITING)
+        return;
+    if ((result != MODULE_SUCCESS) || (zmBuf[SRSP_PAYLOAD_START] != MODULE_SUCCESS))
+        mgmtLqiPolling = MGMT_LQI_IDLE;
+}
+
+/** 
+Feeds the LQI of tracked devices in a page of the neighbor table to the tracking filter, and leaves 
+the next page, if any, for mgmtLqiPoll() to request. Ignores the response unless it is the page of the 
+coordinator's table that was asked for.
+*/
+static void handleMgmtLqiResponse()
+{
+    struct mgmtLqiResponse rsp;
+    if (mgmtLqiPolling != MGMT_LQI_WAITING)
+        return;
+    if (mgmtLqiParseResponse(&rsp) != 0)
+    {
+        if (IS_ZDO_MGMT_LQI_RSP() && (rsp.sourceAddress == COORDINATOR_SHORT_ADDRESS))
+            mgmtLqiPolling = MGMT_LQI_IDLE;     // Our request failed
+        return;
+    }
+    if ((rsp.sourceAddress != COORDINATOR_SHORT_ADDRESS) || (rsp.startIndex != mgmtLqiIndex))
+        return;
+    
+    uint8_t e;
+    for (e = 0; e < rsp.count; e++)
+    {
+        int k = findRouterByMac(mgmtLqiEntryExtendedAddress(&rsp, e));
+        uint8_t lqi = mgmtLqiEntryLqi(&rsp, e);
+        if ((k < 0) || (lqi == 0))
+            continue;
+        if ((routers[k].track_state == ITEM_LOST_ALARM) || (routers[k].track_state == ITEM_LOST_SILENCED))
+            continue;
+        if ((routers[k].rx_timestamp != 0) && ((messageTimestamp - routers[k].rx_timestamp) < MGMT_LQI_PERIOD_MS))
+            continue;
+        routers[k].LQI = lqi;                   // Not trackingSample(): rx_timestamp is when last heard directly
+        if (trackingUpdate(&tracking, k))
+            trackingMark(k);
+    }
+    
+    mgmtLqiIndex = rsp.startIndex + rsp.count;
+    if ((rsp.count > 0) && (mgmtLqiIndex < rsp.totalEntries))
+        mgmtLqiPolling = MGMT_LQI_PAGE_DUE;
+    else
+        mgmtLqiPolling = MGMT_LQI_IDLE;
+}
+
+/** @return index in routers[] of the device with this MAC address (LSB first), or -1 if none */
+static int findRouterByMac(const uint8_t* mac)
+{
+    int k;
+    for (k = 0; k < NUM_DEVICES; k++)
+    {
+        int j;
+        for (j = 7; j >= 0; j--)
+            if (routers[k].MAC_address[j] != mac[j])
+                break;
+        if (j < 0)
+            return k;
+    }
+    return -1;
+}
+
+/** @return index in routers[] of the device last heard from at this short address, or -1 if none */
+static int findRouterByShortAddress(uint16_t shortAddress)
+{
+    int k;
+    for (k = 0; k < NUM_DEVICES; k++)
+        if (routers[k].short_address == shortAddress)
+            return k;
+    return -1;
+}
+
+/** Puts a device straight into ITEM_LOST_ALARM; the next tracking pass raises the alarm */
+static void forceLost(int router_index, const char* reason)
+{
+    trackingForceLost(&tracking, router_index);
+    routers[router_index].rx_timestamp = messageTimestamp;      // For latency measurement
+    trackingMark(router_index);
+    outStr(reason);
+    outStr(": ROUTER INDEX ");
+    outUnsigned(router_index);
+    outNewline();
+}
+
+/** 
+Handles ZDO_LEAVE_IND: a device has left the network. A device that is leaving in order to rejoin 
+will be back shortly, so is not alarmed on.
+*/
+static void handleZdoLeaveIndication()
+{
+    int k = findRouterByMac(zmBuf + ZDO_LEAVE_IND_EXTENDED_ADDRESS_FIELD);
+    if (k < 0)
+        k = findRouterByShortAddress(CONVERT_TO_INT(zmBuf[ZDO_LEAVE_IND_SHORT_ADDRESS_FIELD], 
+                                                    zmBuf[ZDO_LEAVE_IND_SHORT_ADDRESS_FIELD + 1]));
+    if ((k < 0) || zmBuf[ZDO_LEAVE_IND_REJOIN_FIELD])
+        return;
+    routers[k].short_address = SHORT_ADDRESS_UNKNOWN;
+    forceLost(k, "LEFT NETWORK");
+}
+
+/** Handles ZDO_STATUS_ERROR_RSP: the stack failed to reach a device, e.g. its route or link failed. */
+static void handleZdoStatusError()
+{
+    if (zmBuf[ZDO_STATUS_ERROR_RSP_STATUS_FIELD] == MODULE_SUCCESS)
+        return;
+    int k = findRouterByShortAddress(CONVERT_TO_INT(zmBuf[ZDO_STATUS_ERROR_RSP_SHORT_ADDRESS_FIELD], 
+                                                    zmBuf[ZDO_STATUS_ERROR_RSP_SHORT_ADDRESS_FIELD + 1]));
+    if (k < 0)
+        return;
+    forceLost(k, "LINK FAILED");
+}
+
+/** Adds RATE_LIMIT_PER_PERIOD tokens to each device's rate limiter. Called every MAINTENANCE_PERIOD_MS. */
+static void refillRateLimiters()
+{
+    int i;
+    for (i = 0; i < NUM_DEVICES; i++)
+    {
+        routers[i].tokens += RATE_LIMIT_PER_PERIOD;
+        if (routers[i].tokens > RATE_LIMIT_BURST)
+            routers[i].tokens = RATE_LIMIT_BURST;
+    }
+}
+
 /* 
 Displays the pretty name of the LED display mode.
 @param mode which LED display mode
@@ -615,10 +1282,11 @@ static char* getRgbLedDisplayModeName(uint8_t mode)
 
 
 /** 
-Sets the module LEDs to the selected mode.
+Sets the module LEDs to the selected mode. The commands are queued and sent by moduleCommandTask(), 
+so this returns without waiting for the module.
 On Zigbee BoosterPack, GPIO2 & GPIO3 are connected to LEDs. 
 @param mode - LED Display mode
-@pre module GPIOs were configured as outputs
+@pre module GPIOs were configured as outputs, or the command to do so is queued
 @return 0 if success, else error
 @note on Zigbee BoosterPack, DIP switch S4 must have switches "3" and "4" set to "ON" to see the LEDs.
 */
@@ -629,20 +1297,28 @@ static uint8_t setModuleLeds(uint8_t mode)
     
     mode <<= 2;         // Since GPIO2 & GPIO3 are used, need to shift over 2 bits
     
-    if (sysGpio(GPIO_CLEAR, ALL_GPIO_PINS) != MODULE_SUCCESS)   //First, turn all off
+    if (moduleAsyncSysGpio(GPIO_CLEAR, ALL_GPIO_PINS, moduleGpioDone) != 0)  //First, turn all off
     {
-        return 2;       // Module error
+        return 2;       // Queue full
     }      
     if (mode != 0)      // If mode is 0 then don't leave all off
     {
-        if (sysGpio(GPIO_SET, (mode & 0x0C)) != MODULE_SUCCESS)
+        if (moduleAsyncSysGpio(GPIO_SET, (mode & 0x0C), moduleGpioDone) != 0)
         {
-            return 3;   // Module error
+            return 3;   // Queue full
         }
     }
+    schedulerPost(TASK_MODULE_COMMAND);
     return 0;
 }
 
+/** Called when a queued SYS_GPIO command completes */
+static void moduleGpioDone(moduleResult_t result)
+{
+    if (result != MODULE_SUCCESS)
+        outPrintf("ERROR: SYS_GPIO 0x%02X\r\n", result);
+}
+
 
 /** 
 Button interrupt service routine. Called when interrupt generated on the button.
@@ -651,7 +1327,42 @@ Button interrupt service routine. Called when interrupt generated on the button.
 */
 static void handleButtonPress(int8_t button)
 {
-    stateFlags |= STATE_FLAG_BUTTON_PRESSED;
+    eventQueuePush(EVENT_BUTTON, (uint8_t) button);
+    schedulerPost(TASK_EVENT);
+}
+
+/** Debug console interrupt service routine. Called when a byte is received on the debug console. */
+static void handleConsoleByte(int8_t c)
+{
+    eventQueuePush(EVENT_CONSOLE, (uint8_t) c);
+    schedulerPost(TASK_EVENT);
+}
+
+/** 
+SRDY interrupt service routine. Called when the module pulls SRDY low. Not queued as an event: SRDY 
+stays low until the message is read, so posting the task again is harmless, and the HAL keeps the 
+timestamp, see halSrdyTimestamp().
+*/
+static void handleSrdy(void)
+{
+    schedulerPost(TASK_MESSAGE_RECEPTION);
+}
+
+/** 
+sysTick interrupt service routine. Posts the tasks that run periodically.
+*/
+static void handleSysTick(void)
+{
+    static uint32_t lastMaintenance = 0;
+    uint32_t now = halMillis();
+    
+    if (buttonPhase != BUTTON_IDLE)
+        schedulerPost(TASK_BUTTON);
+    if ((now - lastMaintenance) >= MAINTENANCE_PERIOD_MS)
+    {
+        lastMaintenance = now;
+        schedulerPost(TASK_MAINTENANCE);
+    }
 }
 
 /* @} */
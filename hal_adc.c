@@ -0,0 +1,258 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_adc.c
+*
+* @brief Interrupt-driven, oversampled ADC10 acquisition. See hal_adc.h.
+*
+How it works:
+- On every sysTick, if the ADC is idle, halAdcSamplerTick() turns on the ADC and its reference and 
+  starts a block of ADC_BLOCK_SIZE conversions of the current channel in repeat-single-channel mode. 
+  The DTC writes each result to adcBlock[] as it completes; the CPU is not involved.
+- When the block is full the ADC10 ISR stops the ADC, discards the first ADC_SETTLE_SAMPLES samples 
+  (taken while the reference turns on and settles, at most 30uSec), sums the rest and low-pass 
+  filters the sum.
+- The ISR then sets up the input for the other channel and turns the ADC and reference off until the 
+  next block. Channels therefore alternate: A11 (Vcc/2, 2.5V reference) and A4 (current sense, 1.5V 
+  reference). The reference (about 0.25mA) is only on during a block, 0.25 - 0.4mSec of each sysTick.
+A4 is P1.4, which is also MRDY, the SPI chip select of the module. Its analog input enable is not set, 
+so the port keeps driving the pin and the sample and hold can't disturb the handshake; but a sample 
+taken while MRDY is asserted reads MRDY, not the current sensor. A current block is therefore not 
+started while a module transaction is in progress or pending (MRDY or SRDY low); the Vcc channel is 
+sampled instead. It is discarded if one is in progress when it ends. A transaction that starts and ends 
+within one block (0.25 - 0.4mSec) would not be noticed; an SREQ round trip normally takes longer.
+Filtered values are kept as the sum of ADC_OVERSAMPLE samples, i.e. with 3 more bits than the ADC, and 
+are only converted to mV / mA when read.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_adc.h"
+#include <stdint.h>
+#include <intrinsics.h>
+
+/** 
+Function pointer for the ISR called when a block has been converted. Parameters are the channel and 
+the sum of its ADC_OVERSAMPLE samples, before filtering. Set to 0 if not used. */
+void (*adcBlockIsr)(uint8_t, uint16_t) = 0;
+
+/** Samples averaged per block. Must be a power of 2; see ADC_OVERSAMPLE_SHIFT. */
+#define ADC_OVERSAMPLE                  8
+#define ADC_OVERSAMPLE_SHIFT            3
+
+/** 
+Samples thrown away at the start of each block while the reference settles. With ADC10CLK divided by 2, 
+a sample takes 154 cycles of ADC10OSC, at least 24uSec. 
+*/
+#define ADC_SETTLE_SAMPLES              2
+#define ADC_BLOCK_SIZE                  (ADC_OVERSAMPLE + ADC_SETTLE_SAMPLES)
+
+/** A module transaction is in progress (MRDY low) or about to start (SRDY low): A4 reads MRDY */
+#define ADC_A4_IN_USE()                 ((!(P1OUT & BIT4)) || SRDY_IS_LOW())
+
+/** Weight of a new block in the filtered value is 1/2^ADC_FILTER_SHIFT */
+#define ADC_FILTER_SHIFT                2
+
+/** Written by the DTC */
+static uint16_t adcBlock[ADC_BLOCK_SIZE];
+
+/** Filtered sums of ADC_OVERSAMPLE samples, per channel. 0 until the first block of that channel. */
+static volatile uint16_t filtered[ADC_NUM_CHANNELS];
+
+/** Channel of the block being converted, or about to be */
+static uint8_t channel = ADC_CHANNEL_VCC;
+
+static uint8_t running = 0;
+static volatile uint8_t busy = 0;
+
+/** Channel the sampler is locked to, or ADC_CHANNEL_ALL for round-robin */
+static uint8_t lockedChannel = ADC_CHANNEL_ALL;
+
+/** 
+Configures reference, input and mode for the selected channel, with the ADC and reference off until 
+the block is started. @pre ENC is clear. 
+*/
+static void adcSelectChannel(uint8_t ch)
+{
+    channel = ch;
+    if (ch == ADC_CHANNEL_VCC)
+    {
+        ADC10CTL0 = SREF_1 + REF2_5V + ADC10SHT_3 + MSC + ADC10IE;                     // 2.5V ref, 64 cycles
+        ADC10CTL1 = INCH_11 + ADC10DIV_1 + CONSEQ_2;                                    // Vcc/2, repeat
+    } else {
+        ADC10CTL0 = SREF_1 + ADC10SHT_3 + MSC + ADC10IE;                               // 1.5V ref, 64 cycles
+        ADC10CTL1 = INCH_4 + ADC10DIV_1 + CONSEQ_2;                                     // Current sense, repeat
+    }
+    ADC10DTC0 = 0;                              // One block, then stop transferring
+    ADC10DTC1 = ADC_BLOCK_SIZE;
+}
+
+/**
+Starts sampling Vcc and the current sensor in the background.
+@pre initSysTick() has been called; blocks are started from the sysTick.
+@note getVcc3() and getCurrentSensor() return the filtered values while the sampler runs.
+*/
+void halAdcSamplerStart()
+{
+    uint8_t i;
+    for (i = 0; i < ADC_NUM_CHANNELS; i++)
+        filtered[i] = 0;
+    busy = 0;
+    lockedChannel = ADC_CHANNEL_ALL;
+    adcSelectChannel(ADC_CHANNEL_VCC);
+    running = 1;
+}
+
+/** Stops the sampler and turns off the ADC and its reference. */
+void halAdcSamplerStop()
+{
+    running = 0;
+    ADC10CTL1 = 0;                              // CONSEQ_0 and ENC clear stop any conversion immediately
+    ADC10CTL0 = 0;
+    busy = 0;
+}
+
+/** @return 1 if the sampler is running */
+uint8_t halAdcSamplerIsRunning()
+{
+    return running;
+}
+
+/** Starts the next block if the ADC is idle. Called from the watchdog timer (sysTick) ISR. */
+void halAdcSamplerTick()
+{
+    halAdcSamplerTrigger();
+}
+
+/** 
+Starts a block right away, if the sampler is running and the ADC is idle. Lets a caller sample at a 
+moment of its choosing, e.g. at the start of an operation whose current draw is of interest.
+@note May be called from an ISR or from the main loop.
+@return 1 if a block was started, else 0
+*/
+uint8_t halAdcSamplerTrigger()
+{
+    uint8_t started = 0;
+    __istate_t interruptState = __get_interrupt_state();
+    __disable_interrupt();
+    if (running && !busy)
+    {
+        if ((channel == ADC_CHANNEL_CURRENT) && ADC_A4_IN_USE() && (lockedChannel == ADC_CHANNEL_ALL))
+            adcSelectChannel(ADC_CHANNEL_VCC);  // The current is sampled after this block instead
+        if (!((channel == ADC_CHANNEL_CURRENT) && ADC_A4_IN_USE()))     // If locked, wait for the module
+        {
+            busy = 1;
+            ADC10SA = (uint16_t) adcBlock;      // Arms the DTC
+            ADC10CTL0 |= REFON + ADC10ON;       // Settles during the first ADC_SETTLE_SAMPLES
+            ADC10CTL0 |= ENC + ADC10SC;         // Go
+            started = 1;
+        }
+    }
+    __set_interrupt_state(interruptState);
+    return started;
+}
+
+/** 
+Restricts the sampler to one channel, so that every block samples it, or returns it to round-robin. 
+Takes effect from the next block.
+@param ch e.g. ADC_CHANNEL_CURRENT, or ADC_CHANNEL_ALL
+*/
+void halAdcSamplerLockChannel(uint8_t ch)
+{
+    lockedChannel = ch;
+}
+
+/** Converts a sum of ADC_OVERSAMPLE samples to a value in the units of the caller; see adcScale(). */
+static uint16_t adcScaleSum(uint32_t sum, uint32_t fullScale)
+{
+    return ((uint16_t) ((sum * fullScale) >> (10 + ADC_OVERSAMPLE_SHIFT)));
+}
+
+/** 
+Converts a filtered sum to a value in the units of the caller.
+@param ch which channel
+@param fullScale value corresponding to an ADC reading of 1024
+*/
+static uint16_t adcScale(uint8_t ch, uint32_t fullScale)
+{
+    return adcScaleSum(filtered[ch], fullScale);    // 16-bit read is atomic
+}
+
+/** @return filtered supply voltage, in millivolts, or 0 if not sampled yet. Does not block. */
+uint16_t halAdcGetVcc()
+{
+    return adcScale(ADC_CHANNEL_VCC, 2500l * 2);            // 2.5V reference, Vcc / 2
+}
+
+/** 
+@return filtered current sense reading, in mA multiplied by 10, or 0 if not sampled yet. Does not block.
+@see getCurrentSensor()
+*/
+uint16_t halAdcGetCurrent()
+{
+    return adcScale(ADC_CHANNEL_CURRENT, 1500l);            // 1.5V reference, 10mV per mA
+}
+
+/** 
+Converts a sum of ADC_OVERSAMPLE current sense samples, as passed to adcBlockIsr, to mA x 10. 
+@param sum a sum of current samples, or the mean of several such sums
+*/
+uint16_t halAdcSumToCurrent(uint32_t sum)
+{
+    return adcScaleSum(sum, 1500l);
+}
+
+/** ADC10 ISR. Called when the DTC has filled adcBlock[]. */
+#pragma vector = ADC10_VECTOR
+__interrupt void ADC10_ISR(void)
+{
+    ADC10CTL1 &= ~CONSEQ_2;                     // Stop immediately
+    ADC10CTL0 &= ~(ENC + ADC10IFG);
+    
+    if (!((channel == ADC_CHANNEL_CURRENT) && ADC_A4_IN_USE()))    // Else some samples may be of MRDY
+    {
+        uint16_t sum = 0;
+        uint8_t i;
+        for (i = ADC_SETTLE_SAMPLES; i < ADC_BLOCK_SIZE; i++)
+            sum += adcBlock[i];
+        
+        if (filtered[channel] == 0)
+            filtered[channel] = sum;
+        else
+            filtered[channel] = (uint16_t) ((int16_t) filtered[channel] + (((int16_t) sum - (int16_t) filtered[channel]) >> ADC_FILTER_SHIFT));
+        
+        if (adcBlockIsr)
+            adcBlockIsr(channel, sum);
+    }
+    
+    if (lockedChannel != ADC_CHANNEL_ALL)
+        adcSelectChannel(lockedChannel);
+    else
+        adcSelectChannel((channel == ADC_CHANNEL_VCC) ? ADC_CHANNEL_CURRENT : ADC_CHANNEL_VCC);
+    busy = 0;
+}
+
+/* @} */
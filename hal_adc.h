@@ -0,0 +1,61 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_adc.h
+*
+* @brief Interrupt-driven, oversampled ADC10 acquisition of the supply voltage and the BoosterPack
+* current sensor. The Data Transfer Controller fills a block of samples without CPU involvement; the
+* ADC10 ISR averages and filters each block, and the latest values can be read at any time without
+* blocking.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_ADC_H
+#define HAL_ADC_H
+
+#include <stdint.h>
+
+/** Channels sampled round-robin by the sampler */
+#define ADC_CHANNEL_VCC                 0
+#define ADC_CHANNEL_CURRENT             1
+#define ADC_NUM_CHANNELS                2
+
+/** Passed to halAdcSamplerLockChannel() to sample all channels round-robin */
+#define ADC_CHANNEL_ALL                 0xFF
+
+void halAdcSamplerStart();
+void halAdcSamplerStop();
+uint8_t halAdcSamplerIsRunning();
+void halAdcSamplerTick();
+uint16_t halAdcGetVcc();
+uint16_t halAdcGetCurrent();
+uint8_t halAdcSamplerTrigger();
+void halAdcSamplerLockChannel(uint8_t ch);
+uint16_t halAdcSumToCurrent(uint32_t sum);
+
+#endif
+
+/* @} */
@@ -0,0 +1,225 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_clock.c
+*
+* @brief Clock manager for the TI LaunchPad. See hal_clock.h.
+*
+Clocking, per profile:
+- 1MHz:  MCLK = DCO = 1MHz,  SMCLK = 1MHz. For idling.
+- 8MHz:  MCLK = DCO = 8MHz,  SMCLK = 4MHz. Default, same as before the clock manager existed.
+- 16MHz: MCLK = DCO = 16MHz, SMCLK = 4MHz. For processing bursts of messages. SPI runs at 4MHz, 
+the maximum the module supports.
+The sysTick is 2.048mSec, or 8.192mSec in the 1MHz profile to idle cheaper. It maintains the 
+monotonic millisecond timebase, halMillis(), which does not depend on the profile; use that rather 
+than counting sysTicks. The WDT count can't be read, so a switch made mid-tick would lose the partial 
+tick; switches are made at a sysTick boundary instead, see halClockTick().
+@note MSP430G2553 requires Vcc of at least 3.3V to run at 16MHz. The LaunchPad supplies 3.6V.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_clock.h"
+#include <stdint.h>
+#include <intrinsics.h>
+
+/* Peripheral initialization in hal_launchpad.c, repeated when SMCLK changes */
+void halUartInit();
+void halSpiInitModule();
+
+/** Must be in the same order as the HAL_CLOCK_x defines */
+static const struct halClockProfile clockProfiles[HAL_CLOCK_NUM_PROFILES] =
+{
+    /* MHz  SMCLK divider  SMCLK kHz  UART BR0  UART MCTL                     SPI BR0  sysTick     uSec */
+    {  1,   DIVS_0,        1000,      6,        UCBRS_0 + UCBRF_8 + UCOS16,   1,       WDT_MDLY_8,  8192 },
+    {  8,   DIVS_1,        4000,      26,       UCBRS_0 + UCBRF_1 + UCOS16,   2,       WDT_MDLY_8,  2048 },
+    {  16,  DIVS_2,        4000,      26,       UCBRS_0 + UCBRF_1 + UCOS16,   1,       WDT_MDLY_8,  2048 },
+};
+
+/** Currently selected profile; 0xFF until oscInit() selects one. */
+static uint8_t currentProfile = 0xFF;
+
+/** Milliseconds since the sysTick was started. Written only by halClockTick(). */
+static volatile uint32_t milliseconds = 0;
+
+/** Microseconds accumulated towards the next millisecond */
+static uint16_t microseconds = 0;
+
+/** sysTick period of the current profile, cached for halClockTick() */
+static uint16_t sysTickUs = 2048;
+
+/** Number of profile switches, so that measurements timed by the sysTick can detect one */
+static uint16_t switchCount = 0;
+
+/** Profile requested by halClockSet() while the sysTick is running, applied by halClockTick(); or PROFILE_NONE */
+#define PROFILE_NONE                    0xFF
+static volatile uint8_t pendingProfile = PROFILE_NONE;
+
+/** Module chip select (MRDY), P1.4, is low for the whole of a module transaction; see SPI_SS_SET() */
+#define SPI_TRANSACTION_IN_PROGRESS()   (!(P1OUT & BIT4))
+
+/** Reads the DCO calibration constants for a profile from information memory segment A */
+static void getCalibration(uint8_t profile, uint8_t* calbc1, uint8_t* caldco)
+{
+    switch (profile)
+    {
+    case HAL_CLOCK_1MHZ:
+        *calbc1 = CALBC1_1MHZ;
+        *caldco = CALDCO_1MHZ;
+        break;
+    case HAL_CLOCK_16MHZ:
+        *calbc1 = CALBC1_16MHZ;
+        *caldco = CALDCO_16MHZ;
+        break;
+    default:
+        *calbc1 = CALBC1_8MHZ;
+        *caldco = CALDCO_8MHZ;
+        break;
+    }
+}
+
+/** 
+Switches MCLK/SMCLK to the selected profile and reprograms the peripherals that depend on them.
+@pre interrupts disabled, calibration constants checked by halClockSet(), UART and SPI idle
+*/
+static void applyProfile(uint8_t profile)
+{
+    uint8_t calbc1, caldco;
+    getCalibration(profile, &calbc1, &caldco);
+    const struct halClockProfile* p = &clockProfiles[profile];
+    uint16_t oldInterval = (currentProfile < HAL_CLOCK_NUM_PROFILES) ? 
+        clockProfiles[currentProfile].sysTickInterval : 0;
+    
+    DCOCTL = 0;                                 // Lowest DCOx and MODx while changing RSELx
+    BCSCTL1 = (calbc1 & ~DIVA_3) | (BCSCTL1 & DIVA_3);  // Keep the ACLK divider
+    DCOCTL = caldco;
+    BCSCTL2 = (BCSCTL2 & ~DIVS_3) | p->smclkDivider;
+    currentProfile = profile;
+    switchCount++;
+    
+    sysTickUs = p->sysTickUs;
+    if ((IE1 & WDTIE) && (p->sysTickInterval != oldInterval))
+        WDTCTL = p->sysTickInterval;            // Only at a sysTick boundary, see halClockTick()
+    if (!(UCA0CTL1 & UCSWRST))
+        halUartInit();
+    if (!(UCB0CTL1 & UCSWRST))
+        halSpiInitModule();
+}
+
+/**
+Selects a clock profile. Once the sysTick is running, the switch is made by halClockTick() at the next 
+sysTick boundary at which the UART is neither sending nor receiving and no module transaction is in 
+progress, so that halMillis() keeps counting the whole of every tick and no console byte is cut short. 
+Before that, e.g. from oscInit(), it is made straight away.
+@param profile which clock profile, e.g. HAL_CLOCK_16MHZ
+@return 0 if success, -1 if illegal profile, -2 if the DCO calibration constants have been erased
+*/
+int16_t halClockSet(uint8_t profile)
+{
+    if (profile >= HAL_CLOCK_NUM_PROFILES)
+        return -1;
+    uint8_t calbc1, caldco;
+    getCalibration(profile, &calbc1, &caldco);
+    if (calbc1 == 0xFF || caldco == 0xFF)
+        return -2;
+    
+    __istate_t interruptState = __get_interrupt_state();
+    __disable_interrupt();
+    if (IE1 & WDTIE)
+    {
+        pendingProfile = (profile == currentProfile) ? PROFILE_NONE : profile;
+    }
+    else if (profile != currentProfile)
+    {
+        if (!(UCA0CTL1 & UCSWRST))
+            while (UCA0STAT & UCBUSY);          // Let the last byte go out at the old baud rate
+        applyProfile(profile);
+    }
+    __set_interrupt_state(interruptState);
+    return 0;
+}
+
+/** @return the current clock profile, e.g. HAL_CLOCK_8MHZ */
+uint8_t halClockGet()
+{
+    return currentProfile;
+}
+
+/** @return the settings of the current clock profile */
+const struct halClockProfile* halClockGetProfile()
+{
+    if (currentProfile >= HAL_CLOCK_NUM_PROFILES)
+        return &clockProfiles[HAL_CLOCK_DEFAULT];
+    return &clockProfiles[currentProfile];
+}
+
+/** 
+@return the number of times the clock profile has changed. Anything timed in sysTicks across a change 
+is inaccurate, since the sysTick period changes.
+*/
+uint16_t halClockGetSwitchCount()
+{
+    return switchCount;
+}
+
+/** 
+Advances the millisecond timebase by one sysTick period, then makes any profile switch requested by 
+halClockSet(). Called first thing from the watchdog timer ISR, so that the tick just ended is counted 
+at the old period and the next one, which has barely started, at the new one.
+*/
+void halClockTick()
+{
+    microseconds += sysTickUs;
+    while (microseconds >= 1000)
+    {
+        microseconds -= 1000;
+        milliseconds++;
+    }
+    if ((pendingProfile != PROFILE_NONE) && 
+        !(UCA0STAT & UCBUSY) && !SPI_TRANSACTION_IN_PROGRESS())    // Else try again next tick
+    {
+        applyProfile(pendingProfile);
+        pendingProfile = PROFILE_NONE;
+    }
+}
+
+/** 
+Monotonic millisecond clock. Resolution is one sysTick period (see clockProfiles[]); accuracy is that 
+of the DCO, typically +/-1%.
+@pre initSysTick() has been called; the clock does not advance without it.
+@return milliseconds since initSysTick() was called; wraps after ~49 days.
+@note Safe to call from an ISR or from the main loop. Does not disable interrupts.
+*/
+uint32_t halMillis()
+{
+    uint32_t now;
+    do {
+        now = milliseconds;                 // Read twice in case a tick split the two word reads
+    } while (now != milliseconds);
+    return now;
+}
+
+/* @} */
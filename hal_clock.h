@@ -0,0 +1,77 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_clock.h
+*
+* @brief Clock manager for the TI LaunchPad. Switches MCLK between clock profiles at runtime and
+* reprograms everything that depends on the clock: the UART and SPI baud rate dividers, the sysTick
+* interval and the delayMs() loop count.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_CLOCK_H
+#define HAL_CLOCK_H
+
+#include <stdint.h>
+
+/** Clock profiles, see clockProfiles[] in hal_clock.c */
+#define HAL_CLOCK_1MHZ                  0
+#define HAL_CLOCK_8MHZ                  1
+#define HAL_CLOCK_16MHZ                 2
+#define HAL_CLOCK_NUM_PROFILES          3
+
+/** Profile selected by oscInit() */
+#define HAL_CLOCK_DEFAULT               HAL_CLOCK_8MHZ
+
+/** Everything that has to change together when MCLK changes. */
+struct halClockProfile
+{
+    uint8_t mclkMhz;
+    /** SMCLK divider, DIVS_x */
+    uint8_t smclkDivider;
+    uint16_t smclkKhz;
+    /** UART baud rate divider and modulation for 9600bps, see halUartInit() */
+    uint8_t uartBr0;
+    uint8_t uartMctl;
+    /** SPI clock divider, see halSpiInitModule() */
+    uint8_t spiBr0;
+    /** Watchdog timer interval, see initSysTick() */
+    uint16_t sysTickInterval;
+    /** Resulting sysTick period, in microseconds */
+    uint16_t sysTickUs;
+};
+
+int16_t halClockSet(uint8_t profile);
+uint8_t halClockGet();
+const struct halClockProfile* halClockGetProfile();
+
+void halClockTick();
+uint32_t halMillis();
+uint16_t halClockGetSwitchCount();
+
+#endif
+
+/* @} */
@@ -0,0 +1,249 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_energy.c
+*
+* @brief Per-region current and energy profiling. See hal_energy.h.
+*
+How it works:
+- While profiling, the ADC sampler (see hal_adc.c) is locked to the current sense channel and every 
+  block it converts is attributed to a region: the region entered when the block was started.
+- Blocks are started on every sysTick, which samples whatever was running at the time, and on entry 
+  to a region, so that short operations like a burst of console output or an LED change get their 
+  own samples even though they rarely coincide with a sysTick.
+- The current sense input, A4, is P1.4, which is also MRDY. The sampler refuses or discards any block 
+  taken while a module transaction is in progress or pending (MRDY or SRDY low), see hal_adc.c. 
+  Module transactions therefore can't be measured and have no region; their time counts towards the 
+  calling region, at that region's mean current. Samples of the other regions are also skipped while 
+  a frame is pending, so they slightly favour quiet moments.
+- Time is attributed to the region that was interrupted by the sysTick. Over a long enough run this 
+  converges on the share of time spent in each region.
+Energy per region is then the time in the region times its mean current times Vcc. Messages received 
+and bytes printed are counted too, giving the energy cost of each. The cost of a message leaves out 
+what the module draws while exchanging it over SPI.
+@note Vcc is not sampled while profiling; the value from before profiling started is used.
+@note Sampling keeps the ADC and its reference on, which itself adds about 0.75mA to every region.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_energy.h"
+#include "hal_output.h"
+#include "hal_adc.h"
+#include "hal_clock.h"
+#include <stdint.h>
+
+#ifdef ENERGY_PROFILING
+
+extern void (*adcBlockIsr)(uint8_t, uint16_t);
+
+/** Used if Vcc had not been sampled when profiling started */
+#define ENERGY_DEFAULT_VCC_MV           3300
+
+/** Time is kept in units of 256uSec, which all sysTick intervals are a multiple of */
+#define ENERGY_TIME_SHIFT               8
+
+struct energyRegionStats
+{
+    /** Time in the region, in units of 2^ENERGY_TIME_SHIFT uSec */
+    uint32_t time;
+    /** Sum of the current sense block sums attributed to the region */
+    uint32_t currentSum;
+    /** Number of blocks in currentSum */
+    uint16_t blocks;
+};
+
+static struct energyRegionStats stats[ENERGY_NUM_REGIONS];
+static uint32_t bytesPrinted = 0;
+static uint16_t messages = 0;
+static uint16_t vccMv = ENERGY_DEFAULT_VCC_MV;
+static uint8_t profiling = 0;
+
+/** Region being executed by the main loop */
+static volatile uint8_t currentRegion = ENERGY_REGION_APP;
+
+/** Region that the block being converted will be attributed to */
+static volatile uint8_t blockRegion = ENERGY_REGION_APP;
+
+/** Starts a block attributed to region, if the ADC is idle */
+static void energyTrigger(uint8_t region)
+{
+    if (profiling && halAdcSamplerTrigger())
+        blockRegion = region;               // Block takes >100uSec, so can't complete before this
+}
+
+/** Called from the ADC10 ISR when a block has been converted */
+static void energyBlockIsr(uint8_t channel, uint16_t sum)
+{
+    if (channel != ADC_CHANNEL_CURRENT)     // e.g. a Vcc block already in progress when we started
+        return;
+    struct energyRegionStats* s = &stats[blockRegion];
+    if (s->blocks == 0xFFFF)                // Halve both to keep the mean and avoid overflow
+    {
+        s->currentSum >>= 1;
+        s->blocks >>= 1;
+    }
+    s->currentSum += sum;
+    s->blocks++;
+}
+
+/**
+Clears the statistics and starts profiling.
+@pre the ADC sampler is running, see halAdcSamplerStart()
+@return 0 if success, -1 if the ADC sampler is not running
+*/
+int16_t halEnergyProfilingStart()
+{
+    if (!halAdcSamplerIsRunning())
+        return -1;
+    
+    halEnergyProfilingStop();
+    uint8_t i;
+    for (i = 0; i < ENERGY_NUM_REGIONS; i++)
+    {
+        stats[i].time = 0;
+        stats[i].currentSum = 0;
+        stats[i].blocks = 0;
+    }
+    bytesPrinted = 0;
+    messages = 0;
+    vccMv = halAdcGetVcc();
+    if (vccMv == 0)
+        vccMv = ENERGY_DEFAULT_VCC_MV;
+    
+    halAdcSamplerLockChannel(ADC_CHANNEL_CURRENT);
+    adcBlockIsr = energyBlockIsr;
+    profiling = 1;
+    return 0;
+}
+
+/** Stops profiling and returns the ADC sampler to sampling all channels. Statistics are kept. */
+void halEnergyProfilingStop()
+{
+    profiling = 0;
+    adcBlockIsr = 0;
+    halAdcSamplerLockChannel(ADC_CHANNEL_ALL);
+}
+
+/** 
+Enters a region and samples the current. Use ENERGY_REGION_ENTER() instead of calling directly.
+@return the region being left, to be passed to halEnergyExit()
+*/
+uint8_t halEnergyEnter(uint8_t region)
+{
+    uint8_t previous = currentRegion;
+    currentRegion = region;
+    energyTrigger(region);
+    return previous;
+}
+
+/** Returns to the region that was left by halEnergyEnter(). Use ENERGY_REGION_EXIT() instead. */
+void halEnergyExit(uint8_t previous)
+{
+    currentRegion = previous;
+}
+
+/** Changes the current region without sampling. Use ENERGY_SET_REGION() instead. */
+void halEnergySetRegion(uint8_t region)
+{
+    currentRegion = region;
+}
+
+/** Samples the current, attributing it to region. Use ENERGY_SAMPLE() instead. */
+void halEnergySample(uint8_t region)
+{
+    energyTrigger(region);
+}
+
+/** Counts one received message. Use ENERGY_COUNT_MESSAGE() instead. */
+void halEnergyCountMessage()
+{
+    if (profiling)
+        messages++;
+}
+
+/** Counts one byte printed to the console. Use ENERGY_COUNT_BYTE() instead. */
+void halEnergyCountByte()
+{
+    if (profiling)
+        bytesPrinted++;
+}
+
+/** 
+Attributes the last sysTick interval to the current region and samples it. Called from the 
+watchdog timer (sysTick) ISR, before halAdcSamplerTick().
+*/
+void halEnergyTick()
+{
+    if (!profiling)
+        return;
+    stats[currentRegion].time += (halClockGetProfile()->sysTickUs >> ENERGY_TIME_SHIFT);
+    energyTrigger(currentRegion);
+}
+
+/** @return energy used in the region, in uJ */
+static uint32_t energyOfRegion(uint8_t region, uint32_t* timeMs, uint16_t* current)
+{
+    struct energyRegionStats s;
+    HAL_DISABLE_INTERRUPTS();
+    s = stats[region];
+    HAL_ENABLE_INTERRUPTS();
+    
+    *timeMs = (s.time << ENERGY_TIME_SHIFT) / 1000;
+    *current = (s.blocks == 0) ? 0 : halAdcSumToCurrent(s.currentSum / s.blocks);
+    /* mA x 10 * mV * mSec = nJ x 10 */
+    return (uint32_t) (((float) *current) * ((float) vccMv) * ((float) *timeMs) / 10000.0f);
+}
+
+/** Prints time, mean current and energy per region, and energy per message and per printed byte. */
+void halEnergyDisplay()
+{
+    const char* names[ENERGY_NUM_REGIONS] = {"APP", "IDLE", "UART", "LED"};
+    uint32_t timeMs;
+    uint16_t current;
+    uint32_t total = 0;
+    uint32_t uart = 0;
+    uint8_t i;
+    
+    outPrintf("Energy profile%s, Vcc=%umV\r\n", profiling ? "" : " (stopped)", vccMv);
+    outStr("Region\tmSec\tmA x10\tuJ\r\n");
+    for (i = 0; i < ENERGY_NUM_REGIONS; i++)
+    {
+        uint32_t energy = energyOfRegion(i, &timeMs, &current);
+        outPrintf("%s\t%lu\t%u\t%lu\r\n", names[i], timeMs, current, energy);
+        total += energy;
+        if (i == ENERGY_REGION_UART)
+            uart = energy;
+    }
+    /* A byte costs about a microjoule, so is shown in nJ */
+    outPrintf("Total %luuJ; %u messages, %luuJ per message; %lu bytes printed, %lunJ per byte\r\n", 
+              total, messages, (messages == 0) ? 0 : (total / messages), bytesPrinted, 
+              (bytesPrinted == 0) ? 0 : (uint32_t) (((float) uart) * 1000.0f / ((float) bytesPrinted)));
+}
+
+#endif
+
+/* @} */
@@ -0,0 +1,93 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_energy.h
+*
+* @brief Per-region current and energy profiling. Opt-in, see ENERGY_PROFILING.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_ENERGY_H
+#define HAL_ENERGY_H
+
+#include <stdint.h>
+
+/** 
+Uncomment below to compile in energy profiling. Adds a few instructions to putchar() and the LED 
+functions, and about 60 bytes of RAM. Profiling must then be started with halEnergyProfilingStart().
+@note The current sense input (A4, P1.4) is also MRDY, so the current can't be sampled during a module 
+transaction, nor while one is pending. Module transactions therefore have no region of their own; their 
+time counts towards the region that called spiWrite(). See hal_energy.c.
+*/
+//#define ENERGY_PROFILING
+
+/** Code regions that current and time are attributed to */
+enum ENERGY_REGION
+{
+    /** Application code; anything not in another region */
+    ENERGY_REGION_APP,
+    /** Idle loop, waiting for a task to be posted */
+    ENERGY_REGION_IDLE,
+    /** Console output, putchar() */
+    ENERGY_REGION_UART,
+    /** LED or RGB PWM change */
+    ENERGY_REGION_LED,
+    ENERGY_NUM_REGIONS
+};
+
+#ifdef ENERGY_PROFILING
+int16_t halEnergyProfilingStart();
+void halEnergyProfilingStop();
+uint8_t halEnergyEnter(uint8_t region);
+void halEnergyExit(uint8_t previous);
+void halEnergySetRegion(uint8_t region);
+void halEnergySample(uint8_t region);
+void halEnergyCountMessage();
+void halEnergyCountByte();
+void halEnergyTick();
+void halEnergyDisplay();
+
+/** Enters a region until the matching ENERGY_REGION_EXIT() in the same block. Regions nest. */
+#define ENERGY_REGION_ENTER(region)     uint8_t energyPreviousRegion = halEnergyEnter(region)
+#define ENERGY_REGION_EXIT()            halEnergyExit(energyPreviousRegion)
+/** Changes the current region without nesting, e.g. when the scheduler goes idle or runs a task */
+#define ENERGY_SET_REGION(region)       halEnergySetRegion(region)
+/** Takes one sample attributed to region, without changing the current region */
+#define ENERGY_SAMPLE(region)           halEnergySample(region)
+#define ENERGY_COUNT_MESSAGE()          halEnergyCountMessage()
+#define ENERGY_COUNT_BYTE()             halEnergyCountByte()
+#else
+#define ENERGY_REGION_ENTER(region)
+#define ENERGY_REGION_EXIT()
+#define ENERGY_SET_REGION(region)
+#define ENERGY_SAMPLE(region)
+#define ENERGY_COUNT_MESSAGE()
+#define ENERGY_COUNT_BYTE()
+#endif
+
+#endif
+
+/* @} */
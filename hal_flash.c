@@ -0,0 +1,110 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_flash.c
+*
+* @brief Erasing and writing the MSP430G2553's information memory. See hal_flash.h.
+*
+How it works:
+- The flash timing generator is clocked from MCLK, divided down to 257-476kHz as the datasheet requires. 
+  The divider is computed from the current clock profile on every call, so it stays right after 
+  halClockSet().
+- Code runs from main flash, so the CPU is held for the whole of each operation: about 11ms for a 
+  segment erase and 75us per byte written. Interrupts are disabled meanwhile, as the user's guide 
+  requires; they are delayed, not lost, but the sysTick falls behind by up to 11ms per erase. Callers 
+  should erase from a low priority task.
+- Only addresses in segments B to D are accepted, so segment A (DCO calibration) can't be erased by 
+  mistake. Writes can only clear bits; write to erased bytes.
+Flash must not be programmed below 2.2V; checking VCC is up to the caller.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_clock.h"
+#include "hal_flash.h"
+#include <stdint.h>
+#include <intrinsics.h>
+
+/** Highest flash timing generator frequency allowed is 476kHz; leave some margin for the DCO */
+#define FLASH_TIMING_KHZ_MAX            450
+
+#define IS_INFO_ADDRESS(a)  (((a) >= HAL_FLASH_INFO_D) && ((a) < HAL_FLASH_INFO_B + HAL_FLASH_SEGMENT_SIZE))
+
+/** Selects MCLK for the flash timing generator, divided to at most FLASH_TIMING_KHZ_MAX */
+static void flashSetTiming()
+{
+    uint16_t divider = ((uint16_t) halClockGetProfile()->mclkMhz * 1000 + FLASH_TIMING_KHZ_MAX - 1) / 
+        FLASH_TIMING_KHZ_MAX;               // e.g. 18 at 8MHz, for 444kHz
+    FCTL2 = FWKEY + FSSEL_1 + (divider - 1);  // FNx = divider - 1
+}
+
+/**
+Erases one segment of information memory.
+@param address any address in the segment
+@return 0 if success, -1 if address is not in segments B to D
+*/
+int16_t halFlashEraseSegment(uint16_t address)
+{
+    if (!IS_INFO_ADDRESS(address))
+        return -1;
+    __istate_t interruptState = __get_interrupt_state();
+    __disable_interrupt();
+    flashSetTiming();
+    FCTL3 = FWKEY;                          // Clear LOCK
+    FCTL1 = FWKEY + ERASE;                  // Segment erase
+    *((volatile uint8_t*) address) = 0;     // Dummy write starts the erase; the CPU is held until done
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY + LOCK;
+    __set_interrupt_state(interruptState);
+    return 0;
+}
+
+/**
+Writes bytes to information memory, in order. They should have been erased.
+@param address where to write
+@param bytes what to write
+@param numBytes how many
+@return 0 if success, -1 if any byte would fall outside segments B to D
+*/
+int16_t halFlashWrite(uint16_t address, const uint8_t* bytes, uint8_t numBytes)
+{
+    if ((numBytes == 0) || !IS_INFO_ADDRESS(address) || !IS_INFO_ADDRESS(address + numBytes - 1))
+        return -1;
+    __istate_t interruptState = __get_interrupt_state();
+    __disable_interrupt();
+    flashSetTiming();
+    FCTL3 = FWKEY;
+    FCTL1 = FWKEY + WRT;                    // Byte write
+    uint8_t i;
+    for (i = 0; i < numBytes; i++)
+        *((volatile uint8_t*) (address + i)) = bytes[i];
+    FCTL1 = FWKEY;
+    FCTL3 = FWKEY + LOCK;
+    __set_interrupt_state(interruptState);
+    return 0;
+}
+
+/* @} */
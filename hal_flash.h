@@ -0,0 +1,61 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_flash.h
+*
+* @brief Erasing and writing the MSP430G2553's information memory. Segments B, C and D (64 bytes each)
+* are free for the application; segment A holds the DCO calibration and is never touched.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_FLASH_H
+#define HAL_FLASH_H
+
+#include <stdint.h>
+
+/** Information memory segments available to the application, lowest address first */
+#define HAL_FLASH_INFO_D                0x1000
+#define HAL_FLASH_INFO_C                0x1040
+#define HAL_FLASH_INFO_B                0x1080
+#define HAL_FLASH_SEGMENT_SIZE          64
+
+/** Value of an erased byte */
+#define HAL_FLASH_ERASED                0xFF
+
+/** Pointer to read information memory at an address; it's ordinary memory except with HAL_POSIX */
+#ifdef HAL_POSIX
+extern uint8_t halPosixFlash[];
+#define HAL_FLASH_PTR(address)          ((const uint8_t*) (halPosixFlash + ((address) - HAL_FLASH_INFO_D)))
+#else
+#define HAL_FLASH_PTR(address)          ((const uint8_t*) (address))
+#endif
+
+int16_t halFlashEraseSegment(uint16_t address);
+int16_t halFlashWrite(uint16_t address, const uint8_t* bytes, uint8_t numBytes);
+
+#endif
+
+/* @} */
@@ -13,7 +13,8 @@
 * @see hal_helper.c for utilities to assist when changing hardware platforms
 *
 Clocking:
-SMCLK: 4MHz (see oscInit()), sources the following:
+MCLK: 8MHz by default; may be switched to 1MHz or 16MHz at runtime with halClockSet(), see hal_clock.c
+SMCLK: 4MHz (1MHz in the 1MHz clock profile), sources the following:
 - UART - see halUartInit()
 - SPI - see halSpiInitModule()
 - PWM for RGB LEDs
@@ -50,6 +51,11 @@ ACLK: Sourced by VLO, ~12kHz
 
 #include "hal_launchpad.h"
 #include "hal_version.h"
+#include "hal_clock.h"
+#include "hal_vlo.h"
+#include "hal_adc.h"
+#include "hal_energy.h"
+#include "hal_rgb.h"
 #include <stdint.h>
 
 /** 
@@ -76,6 +82,11 @@ void (*srdyIsr)(void);
 /** Function pointer for the ISR called when a sysTick interrupt occurs */
 void (*sysTickIsr)(void);
 
+/** 
+Value of halMillis() when SRDY last went low, i.e. when the module last signalled that it has a 
+message. Set in the SRDY ISR; read with halSrdyTimestamp(). */
+static volatile uint32_t srdyTimestamp = 0;
+
 
 /** 
 Flags to indicate when to wake up the processor. These are read in the various ISRs. 
@@ -132,6 +143,8 @@ __interrupt void PORT2_ISR(void)
 {
     if (P2IFG & BIT2)                   //Modify this based on which pin is connected to SRDY
     {
+        if (P1OUT & BIT4)               // MRDY high: not the SRDY handshake of a command in flight
+            srdyTimestamp = halMillis();
         srdyIsr();
         if (wakeupFlags & WAKEUP_AFTER_SRDY)    
             HAL_WAKEUP();          
@@ -139,6 +152,20 @@ __interrupt void PORT2_ISR(void)
     P2IFG = 0;                          // clear the interrupt
 }
 
+/**
+@return value of halMillis() when the module last signalled a message by pulling SRDY low. Edges that 
+are part of the handshake of a command (MRDY low) are not counted.
+@note Safe to call from the main loop: read twice in case the SRDY ISR split the two word reads.
+*/
+uint32_t halSrdyTimestamp()
+{
+    uint32_t t;
+    do {
+        t = srdyTimestamp;
+    } while (t != srdyTimestamp);
+    return t;
+}
+
 /**
 Whether the selected button is pressed.
 @param button which button - must be ANY_BUTTON or BUTTON_0 on this implementation.
@@ -158,18 +185,23 @@ static void doNothing(int8_t a)
     volatile int8_t b = a;  //prevent this from getting optimized out
 }
 
-/** Initializes Oscillator: turns off WDT, configures MCLK to 8MHz using internal DCO and sets SMCLK to 4MHz */
+/** Placeholder for the function pointers that take no parameter */
+static void doNothingVoid(void)
+{
+}
+
+/** 
+Initializes Oscillator: turns off WDT, configures MCLK to 8MHz using internal DCO and sets SMCLK to 4MHz
+@see halClockSet() to change this later.
+*/
 void oscInit()
 {
     WDTCTL = WDTPW + WDTHOLD; // Stop WDT
     
-    if (CALBC1_8MHZ ==0xFF || CALDCO_8MHZ == 0xFF)                                     
+    if (halClockSet(HAL_CLOCK_DEFAULT) != 0)    // Set DCO = 8MHz for MCLK, SMCLK = DCO/2 (4MHz)
     {  
         while(1); // Stop if calibration constants erased
     }   
-    BCSCTL1 = CALBC1_8MHZ;          // Set DCO = 8MHz for MCLK
-    DCOCTL = CALDCO_8MHZ;
-    BCSCTL2 |= DIVS_1;              // SMCLK = DCO/2 (4MHz) 
     BCSCTL3 |= LFXT1S_2;            // Use VLO for ACLK
 }
 
@@ -210,7 +242,9 @@ void portInit()
     P2DIR = BIT0 | BIT1 | BIT5 | BIT6 | BIT7;           // Configure outputs
     P2SEL = 0;
     P2SEL2 = 0;
+    P2IES = BIT2;                                       // SRDY interrupt on high-to-low transition
     P2IFG = 0;
+    P2IE  = BIT2;                                       // Enable SRDY Interrupt, see srdyIsr
     P2OUT &= ~(BIT0);                                   //turn off module
     // Note: Bit-Bang I2C signals will be configured by the Bit-Bang I2C Driver
     
@@ -223,14 +257,16 @@ void portInit()
 Initialize UART debug console for I/O. Configures the USCI in the processor to use UART mode. 
 @post UART may be used by putchar() etc. 
 @note LaunchPad debugger can only handle 9600 baud, no faster
+@note Also called by halClockSet() to recompute the baud rate divider for the new SMCLK.
 */
 void halUartInit()
 {
+    const struct halClockProfile* clock = halClockGetProfile();
     UCA0CTL1 = UCSWRST;                         // Stop USCIA0 state machine
     UCA0CTL0 = 0;
     UCA0CTL1 |= UCSSEL_2;                       // USCIA0 source from SMCLK
-    UCA0BR0 = 26; UCA0BR1 = 0;                  // 4mHz smclk w/modulation for 9,600bps, table 15-5 
-    UCA0MCTL = UCBRS_0 +UCBRF_1 + UCOS16;       // Modulation UCBRSx=1, over sampling      
+    UCA0BR0 = clock->uartBr0; UCA0BR1 = 0;      // e.g. 4mHz smclk w/modulation for 9,600bps = 26, table 15-5 
+    UCA0MCTL = clock->uartMctl;                 // Modulation, over sampling      
     UCA0CTL1 &= ~UCSWRST;                       // **Initialize USCI state machine**
     IE2 |= UCA0RXIE;                            // Enable USCI_A0 RX interrupt
 }
@@ -266,6 +302,9 @@ void halInit()
 
     //Point the function pointers to doNothing() so that they don't trigger a restart
     buttonIsr = &doNothing;
+    srdyIsr = &doNothingVoid;
+    sysTickIsr = &doNothingVoid;
+    timerIsr = &doNothingVoid;
     //Note: during development you may want to comment out the line below. 
     //That way you can restart the micro by pressing any key in the terminal window.
     debugConsoleIsr = &doNothing;
@@ -281,8 +320,11 @@ void halInit()
 /** Send one byte via hardware UART. Required for printf() etc. in stdio.h */
 int putchar(int c)
 {	
+    ENERGY_REGION_ENTER(ENERGY_REGION_UART);
+    ENERGY_COUNT_BYTE();
     while (!(IFG2 & UCA0TXIFG));   // Wait for ready
     UCA0TXBUF = (uint8_t) (c & 0xFF); 
+    ENERGY_REGION_EXIT();
     return c;
 }
 
@@ -296,12 +338,13 @@ Initializes the Serial Peripheral Interface (SPI) interface to the Zigbee Module
 - SRDY configured as an input.
 @post SPI port is configured for communications with the module.
 @note this function is not required if using the UART to communicate with the module
+@note Also called by halClockSet() to recompute the clock divider for the new SMCLK.
 */
 void halSpiInitModule()
 {
     UCB0CTL1 |= UCSSEL_2 | UCSWRST;                 //serial clock source = SMCLK, hold SPI interface in reset
     UCB0CTL0 = UCCKPH | UCMSB | UCMST | UCSYNC;     //clock polarity = inactive is LOW (CPOL=0); Clock Phase = 0; MSB first; Master Mode; Synchronous Mode    
-    UCB0BR0 = 2;  UCB0BR1 = 0;                      //SPI running at 2MHz (SMCLK / 2)
+    UCB0BR0 = halClockGetProfile()->spiBr0;  UCB0BR1 = 0;   //SPI running at 2MHz (SMCLK / 2) by default
     UCB0CTL1 &= ~UCSWRST;                           //start USCI_B1 state machine  
 }
 
@@ -334,14 +377,20 @@ A fairly accurate blocking delay for waits in the millisecond range. Good for 1m
 @note At 8MHz, error of zero for 1000mSec.
 @note Accuracy will depend on the clock source. MSP430F2xx internal DCO is typically +/-1%. 
 For better timing accuracy, use a timer, or a crystal.
-@pre TICKS_PER_MS is defined correctly for the clock setting used.
+@note Scales with the current clock profile, see halClockSet(). Waits DELAY_CYCLES_PER_MHZ once per 
+MHz of MCLK for each millisecond.
 @param delay number of milliseconds to delay
 */
+#define DELAY_LOOP_OVERHEAD_CYCLES      4       // DEC + JNZ of the inner loop, plus slack
+#define DELAY_CYCLES_PER_MHZ            (1000 - DELAY_LOOP_OVERHEAD_CYCLES)
 void delayMs(uint16_t delay)
 {
+    uint8_t mhz = halClockGetProfile()->mclkMhz;
     while (delay--)
     {
-        __delay_cycles(TICKS_PER_MS);
+        uint8_t i = mhz;
+        while (i--)
+            __delay_cycles(DELAY_CYCLES_PER_MHZ);
     }
 }
 
@@ -353,6 +402,7 @@ Turns ON the specified LED.
 */
 int16_t setLed(uint8_t led)
 {
+    ENERGY_SAMPLE(ENERGY_REGION_LED);   // Block starts after a few cycles, so sees the new state
     switch (led)
     {
     case 0:
@@ -383,6 +433,7 @@ Turns OFF the specified LED.
 */
 int16_t clearLed(uint8_t led)
 {
+    ENERGY_SAMPLE(ENERGY_REGION_LED);
     switch (led)
     {
     case 0:
@@ -424,6 +475,7 @@ Toggles the specified LED.
 */
 int16_t toggleLed(uint8_t led)
 {
+    ENERGY_SAMPLE(ENERGY_REGION_LED);
     switch (led)
     {
     case 0:
@@ -456,10 +508,14 @@ int16_t toggleLed(uint8_t led)
 /** 
 Reads the MSP430 supply voltage using the Analog to Digital Converter (ADC) and internal voltage reference. 
 ADC clocked by ADC10OSC
+@note If the background sampler is running (see halAdcSamplerStart()) then returns its latest filtered 
+value instead, without blocking.
 @return Vcc supply voltage, in millivolts
 */
 uint16_t getVcc3()
 {
+    if (halAdcSamplerIsRunning())
+        return halAdcGetVcc();
     ADC10CTL0 = SREF_1 + REFON + REF2_5V + ADC10ON + ADC10SHT_3;  // use internal ref, turn on 2.5V ref, set samp time = 64 cycles
     ADC10CTL1 = INCH_11;                         
     delayMs(1);                                     // Allow internal reference to stabilize
@@ -480,10 +536,14 @@ current translates into 10mV measured by MSP430.
 ADC clocked by ADC10OSC
 @note Current sense input is on P1.4/A4 on MSP430G2553
 @pre Current sense shunt is installed on the BoosterPack
+@note If the background sampler is running (see halAdcSamplerStart()) then returns its latest filtered 
+value instead, without blocking.
 @return Current in mA multiplied by 10 (e.g. return value of 713 = 71.3mA)
 */
 uint16_t getCurrentSensor()
 {
+    if (halAdcSamplerIsRunning())
+        return halAdcGetCurrent();
     ADC10CTL0 = SREF_1 + REFON + ADC10ON + ADC10SHT_3;  // use internal ref, set samp time = 64 cycles
     ADC10CTL1 = INCH_4;                         
     delayMs(1);                                     // Allow internal reference to stabilize
@@ -570,17 +630,18 @@ void stopTimer()
 //
 
 /** 
-Initializes the systick interval timer. Default Interval is approximately 8mSec and is not
-adjustable because we are using the watchdog timer which has fixed timeout periods.
+Initializes the systick interval timer. Interval is 2.048mSec (8.192mSec in the 1MHz clock profile) and is 
+not otherwise adjustable because we are using the watchdog timer which has fixed timeout periods.
+The systick also maintains the millisecond timebase, see halMillis().
 @note we are using the Watchdog Timer module to be a timer, not a classic watchdog. This is because 
 we need the systick function at the same time as the PWM. The PWM uses all the normal timer modules
 on the microcontroller so we have to use the WDT module instead. If you aren't using PWM then we
 recommend just using initTimer() instead.
-@note WDT sourced from SMCLK
+@note WDT sourced from SMCLK. The interval is taken from the clock profile, see halClockSet().
 */
 void initSysTick(void)
 {
-  WDTCTL = WDT_MDLY_32;                     // Set Watchdog Timer interval, source from SMCLK (4MHz), 8Msec
+  WDTCTL = halClockGetProfile()->sysTickInterval;   // Set Watchdog Timer interval, e.g. WDT_MDLY_8 from SMCLK (4MHz), 2Msec
   IE1 |= WDTIE;                             // Enable WDT interrupt
 }
 
@@ -588,6 +649,13 @@ void initSysTick(void)
 #pragma vector=WDT_VECTOR
 __interrupt void watchdog_timer(void)
 {
+  halClockTick();
+  halVloCalibrationTick();
+#ifdef ENERGY_PROFILING
+  halEnergyTick();                          // Before halAdcSamplerTick(), so the block is attributed
+#endif
+  halAdcSamplerTick();
+  halRgbAnimationTick();
   sysTickIsr();
 }
 
@@ -608,8 +676,7 @@ Calibrate VLO. Once this is done, the VLO can be used semi-accurately for timers
 calibrated, VLO is within ~2% of actual when using a 1% calibrated DCO frequency and temperature and 
 supply voltage remain unchanged.
 @return VLO frequency (number of VLO counts in 1sec), or -1 if out of range
-@pre SMCLK is 4MHz
-@pre MCLK is 8MHz
+@pre SMCLK is as given by the current clock profile, see halClockSet()
 @pre ACLK sourced by VLO (BCSCTL3 = LFXT1S_2 in MSP430F2xxx)
 @note Calibration is only as good as MCLK source. Obviously, if using the internal DCO (+/- 1%) then 
 this value will only be as good as +/- 1%. YMMV.
@@ -620,7 +687,8 @@ Modify TACCTLx, TACCRx, and CCIS_x accordingly
 For example, see page 23 of the MSP430F24x datasheet or page 17 of the MSP430F20x2 datasheet, or 
 page 18 of the MSP430F22x4 datasheet.
 @note If application will require accuracy over change in temperature or supply voltage, recommend 
-calibrating VLO more often.
+calibrating VLO more often. halVloCalibrationStart() does this in the background without blocking.
+@note Stops the watchdog timer, and with it the sysTick.
 @post Timer A settings restored to what they were beforehand except for TACCR0 which is reset.
 */
 int16_t calibrateVlo()
@@ -645,14 +713,14 @@ int16_t calibrateVlo()
     
     while ((TACCTL0 & CCIFG) ==0);        // Wait for next capture
     
-    unsigned long counts = (TACCR0 - firstCapture);        // # of VLO clocks in 8Mhz
+    unsigned long counts = (TACCR0 - firstCapture);        // # of SMCLK clocks in 8 VLO clocks
     BCSCTL1 = temp_BCSCTL1;                  // Restore original settings
     TACCTL0 = temp_TACCTL0;
     TACTL = temp_TACTL;
     
     //TACCTL0 = 0; TACTL = 0;                 // Clear Timer settings
     
-    vloFrequency = ((uint16_t) (32000000l / counts));
+    vloFrequency = ((uint16_t) ((halClockGetProfile()->smclkKhz * 8000l) / counts));  // e.g. 32000000 / counts at 4MHz
     if ((vloFrequency > VLO_MIN) && (vloFrequency < VLO_MAX))
         return vloFrequency;
     else
@@ -695,10 +763,11 @@ void halRgbLedPwmInit()
     halRgbSetLeds(0,0,0);                   // Initialization done, turn them off
 }
 
-/* Multiply given values by this to get true white. Measured empirically. */
-#define COLOR_BALANCE_RED (0.27f)
-#define COLOR_BALANCE_BLUE (0.75f)
-#define COLOR_BALANCE_GREEN (1.0f)
+/* Multiply given values by this, then divide by 256, to get true white. Measured empirically as 
+0.27, 0.75 and 1.0. Fixed point, since this is called from the sysTick ISR by animations. */
+#define COLOR_BALANCE_RED               69
+#define COLOR_BALANCE_BLUE              192
+#define COLOR_BALANCE_GREEN             256
 
 /** 
 Sets RGB LED color to the selected values. Adjusts intensities so that illuminance of each color is 
@@ -712,9 +781,9 @@ even. This way calling the function with (0xFF, 0xFF, 0xFF) will result in a fai
 void halRgbSetLeds(uint8_t red, uint8_t blue, uint8_t green)
 {
     /* Adjust intensity of each color for white balance */
-    float colorBalancedRed = COLOR_BALANCE_RED * ((float) red);
-    float colorBalancedGreen = COLOR_BALANCE_GREEN * ((float) green);
-    float colorBalancedBlue = COLOR_BALANCE_BLUE * ((float) blue);
+    uint16_t colorBalancedRed = (((uint16_t) red) * COLOR_BALANCE_RED) >> 8;
+    uint16_t colorBalancedGreen = (((uint16_t) green) * COLOR_BALANCE_GREEN) >> 8;
+    uint16_t colorBalancedBlue = (((uint16_t) blue) * COLOR_BALANCE_BLUE) >> 8;
 
     /* Now, need to set the PWM cycle. 
     PWM register of 0 = LED totally ON (LEDs are active-low)
@@ -722,44 +791,17 @@ void halRgbSetLeds(uint8_t red, uint8_t blue, uint8_t green)
     RED_PWM  = RGB_LED_PWM_PERIOD - ((uint8_t) colorBalancedRed);
     GREEN_PWM  = RGB_LED_PWM_PERIOD - ((uint8_t) colorBalancedGreen);
     BLUE_PWM  = RGB_LED_PWM_PERIOD - ((uint8_t) colorBalancedBlue);
+    ENERGY_SAMPLE(ENERGY_REGION_LED);
 }
 
-/** Simple test of RGB LED. */
+/** 
+Simple test of RGB LED: cycles through all the colors, about 3 seconds per cycle, until stopped with 
+halRgbAnimationStop(). Returns immediately; see hal_rgb.h.
+@pre halRgbLedPwmInit() and initSysTick() have been called
+*/
 void halRgbLedTest()
 {
-    int i;
-    for (i=0; i< 0xFF; i++)
-    {
-        halRgbSetLeds(0xFF-i,0xFF,0xFF);
-        delayMs(5);
-    }
-    for (i=0; i< 0xFF; i++)
-    {
-        halRgbSetLeds(i,0xFF,0xFF);
-        delayMs(5);
-    }
-    
-    for (i=0; i< 0xFF; i++)
-    {
-        halRgbSetLeds(0xFF,0xFF-i,0xFF);
-        delayMs(5);
-    }        
-    for (i=0; i< 0xFF; i++)
-    {
-        halRgbSetLeds(0xFF,i,0xFF);
-        delayMs(5);
-    }
-    
-    for (i=0; i< 0xFF; i++)
-    {
-        halRgbSetLeds(0xFF,0xFF,0xFF-i);
-        delayMs(5);
-    }        
-    for (i=0; i< 0xFF; i++)
-    {
-        halRgbSetLeds(0xFF,0xFF,i);
-        delayMs(5);
-    }
+    halRgbAnimationStart(HAL_RGB_WAVE_COLOR_CYCLE, 0, 0, 0, 50);
 }
 
 /* @} */
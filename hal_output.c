@@ -0,0 +1,221 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_output.c
+*
+* @brief Lightweight console output. See hal_output.h.
+*
+Everything is written with putchar(), so goes wherever printf() output goes. The emitters avoid 
+printf()'s format string parsing, varargs and 32-bit arithmetic: outHex8() is a two-entry table 
+lookup, and outUnsigned() uses 16-bit division whenever the value fits.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_output.h"
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+/** Writes a null-terminated string, without a newline. */
+void outStr(const char* s)
+{
+    while (*s)
+        putchar(*s++);
+}
+
+/** Writes "\r\n" */
+void outNewline()
+{
+    putchar('\r');
+    putchar('\n');
+}
+
+/** Writes a byte as two uppercase hex digits, same as printf("%02X") */
+void outHex8(uint8_t b)
+{
+    putchar(hexDigits[b >> 4]);
+    putchar(hexDigits[b & 0x0F]);
+}
+
+/** 
+Writes bytes as hex digits, two per byte, without separators.
+@param bytes the bytes to write
+@param len how many
+*/
+void outHexBytes(const uint8_t* bytes, uint8_t len)
+{
+    while (len--)
+        outHex8(*bytes++);
+}
+
+/** 
+Writes bytes as hex digits, last byte first. Use for MAC addresses, which are stored LSB first.
+@param bytes the bytes to write
+@param len how many
+*/
+void outHexBytesReversed(const uint8_t* bytes, uint8_t len)
+{
+    bytes += len;
+    while (len--)
+        outHex8(*--bytes);
+}
+
+/** 
+Writes a number in decimal or hex, padded on the left to width.
+@param value the number
+@param base 10 or 16
+@param width minimum number of characters, or 0
+@param pad '0' or ' '
+@param sign '-' to write a minus sign, counted in width, or 0
+*/
+static void outNumber(uint32_t value, uint8_t base, uint8_t width, char pad, char sign)
+{
+    char digits[10];                            // 2^32 has 10 decimal digits
+    uint8_t n = 0;
+    if (value <= 0xFFFF)                        // 16-bit division is much faster
+    {
+        uint16_t v = (uint16_t) value;
+        do {
+            digits[n++] = hexDigits[v % base];
+            v /= base;
+        } while (v);
+    } else {
+        do {
+            digits[n++] = hexDigits[value % base];
+            value /= base;
+        } while (value);
+    }
+    if (sign)
+    {
+        if (width)
+            width--;
+        if (pad == '0')                         // -0005, but   -5
+            putchar(sign);
+    }
+    while (width > n)
+    {
+        putchar(pad);
+        width--;
+    }
+    if (sign && (pad != '0'))
+        putchar(sign);
+    while (n)
+        putchar(digits[--n]);
+}
+
+/** Writes an unsigned number in decimal, same as printf("%lu") */
+void outUnsigned(uint32_t value)
+{
+    outNumber(value, 10, 0, ' ', 0);
+}
+
+/** 
+Writes a signed number in decimal, same as printf("%ld"). The magnitude is taken in unsigned 
+arithmetic: -value overflows for INT32_MIN. 
+*/
+void outSigned(int32_t value)
+{
+    if (value < 0)
+        outNumber(0 - (uint32_t) value, 10, 0, ' ', '-');
+    else
+        outNumber((uint32_t) value, 10, 0, ' ', 0);
+}
+
+/**
+Drop-in replacement for printf() for code that isn't on the hot path. Supports %c, %s, %d, %i, %u, %x 
+and %X, with a width, a '0' flag and the 'l' modifier, and %%. Anything else is written as-is.
+@note hex digits are always uppercase
+@return 0; unlike printf() the number of characters written is not counted
+*/
+int outPrintf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    while (*format)
+    {
+        if (*format != '%')
+        {
+            putchar(*format++);
+            continue;
+        }
+        format++;
+        char pad = ' ';
+        uint8_t width = 0;
+        uint8_t isLong = 0;
+        if (*format == '0')
+        {
+            pad = '0';
+            format++;
+        }
+        while ((*format >= '0') && (*format <= '9'))
+            width = (width * 10) + (*format++ - '0');
+        if (*format == 'l')
+        {
+            isLong = 1;
+            format++;
+        }
+        switch (*format)
+        {
+        case 'c':
+            putchar(va_arg(args, int));
+            break;
+        case 's':
+            outStr(va_arg(args, const char*));
+            break;
+        case 'd':
+        case 'i':
+            {
+                int32_t value = isLong ? va_arg(args, long) : va_arg(args, int);
+                if (value < 0)
+                    outNumber(0 - (uint32_t) value, 10, width, pad, '-');     // As outSigned()
+                else
+                    outNumber((uint32_t) value, 10, width, pad, 0);
+            }
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+            {
+                uint32_t value = isLong ? va_arg(args, unsigned long) : va_arg(args, unsigned int);
+                outNumber(value, (*format == 'u') ? 10 : 16, width, pad, 0);
+            }
+            break;
+        case '\0':                                 // Format ends in '%'
+            format--;
+            break;
+        default:                                    // Including '%'
+            putchar(*format);
+            break;
+        }
+        format++;
+    }
+    va_end(args);
+    return 0;
+}
+
+/* @} */
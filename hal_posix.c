@@ -0,0 +1,930 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_posix.c
+*
+* @brief POSIX implementation of the HAL. See hal_posix.h.
+*
+How it works:
+- Interrupts: a single interrupt thread runs the ISR hooks (sysTick, console, button, SRDY, timer), 
+  holding interruptLock. __disable_interrupt() takes the same lock, so code that disables interrupts 
+  excludes the handlers exactly as on the MSP430, and handlers never nest. Interrupts start disabled, 
+  as after reset, until main() enables them.
+- sysTick: every HAL_POSIX_SYSTICK_US, like the watchdog interval on the LaunchPad. Ticks missed 
+  because the host didn't run the interrupt thread in time are made up back to back. halMillis() is 
+  the monotonic clock.
+- Console: a pseudo-terminal, or stdin/stdout. printf() and putchar() write to stdout. As with the 
+  UART, output that nothing reads is lost, once the pseudo-terminal's buffer is full.
+- Zigbee module: the MT frames written with spiWrite() are sent to an emulator process over a Unix 
+  domain socket, see tools/zm_emulator.c. A reader thread receives frames from it: synchronous 
+  responses (SRSP) complete the SREQ waiting for them, and asynchronous ones (AREQ) are queued, 
+  pulling SRDY low and calling srdyIsr() as the module would. Each POLL that reads an AREQ is passed 
+  on to the emulator too, which uses it for flow control. The SPI handshake is emulated at frame 
+  level: with SS asserted, SRDY is low until a whole frame has been written, then goes high while the 
+  response is read out, one byte per byte written, as with the CC2530's "write-to-read" SPI.
+- Information memory: an array backed by a file.
+- LEDs, ADC and clock profiles: state only; VCC reads as HAL_POSIX_VCC_MV. The stack is not measured.
+The main loop spins when idle, as on the LaunchPad without low power modes.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#define _GNU_SOURCE
+#include "hal_posix.h"
+#include "hal_clock.h"
+#include "hal_vlo.h"
+#include "hal_adc.h"
+#include "hal_rgb.h"
+#include "hal_stack.h"
+#include "hal_flash.h"
+#include "hal_output.h"
+#include "hal_version.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define HAL_POSIX_SYSTICK_US            2048
+#define HAL_POSIX_VCC_MV                3300
+#define HAL_POSIX_VLO_HZ                12000
+#define HAL_POSIX_MODULE_SOCKET         "/tmp/zm_emulator.sock"
+#define HAL_POSIX_FLASH_FILE            "hal_posix_flash.bin"
+
+/** How long the button reads as pressed after SIGUSR1 (press) and SIGUSR2 (hold) */
+#define BUTTON_PRESS_MS                 300
+#define BUTTON_HOLD_MS                  6000
+
+/** How long an SREQ waits for its SRSP before the module is treated as unresponsive */
+#define SRSP_TIMEOUT_MS                 2000
+
+/** Largest MT frame: length, command, and up to 250 bytes of data */
+#define MT_FRAME_MAX                    253
+#define MT_HEADER_SIZE                  3
+#define MT_TYPE_MASK                    0xE0
+#define MT_TYPE_POLL                    0x00
+#define MT_TYPE_SREQ                    0x20
+#define MT_TYPE_AREQ                    0x40
+#define MT_TYPE_SRSP                    0x60
+
+/** Ticks delivered late, back to back, when the interrupt thread was not scheduled in time */
+#define MAX_LATE_TICKS                  16
+
+/** AREQs received from the module and not yet read by the application */
+#define AREQ_QUEUE_SIZE                 16
+
+void (*debugConsoleIsr)(int8_t);
+void (*buttonIsr)(int8_t);
+void (*timerIsr)(void);
+void (*srdyIsr)(void);
+void (*sysTickIsr)(void);
+static volatile uint32_t srdyTimestamp = 0;
+uint16_t wakeupFlags = 0;
+uint16_t vloFrequency = 0;
+
+static void doNothing(int8_t a)
+{
+    (void) a;
+}
+
+static void doNothingVoid(void)
+{
+}
+
+//
+//  Interrupts
+//
+
+static pthread_mutex_t interruptLock = PTHREAD_MUTEX_INITIALIZER;
+/** Whether this thread holds interruptLock */
+static __thread uint8_t interruptsDisabled = 0;
+
+__istate_t __get_interrupt_state(void)
+{
+    return interruptsDisabled;
+}
+
+void __disable_interrupt(void)
+{
+    if (!interruptsDisabled)
+    {
+        pthread_mutex_lock(&interruptLock);
+        interruptsDisabled = 1;
+    }
+}
+
+void __enable_interrupt(void)
+{
+    if (interruptsDisabled)
+    {
+        interruptsDisabled = 0;
+        pthread_mutex_unlock(&interruptLock);
+    }
+}
+
+void __set_interrupt_state(__istate_t state)
+{
+    if (state)
+        __disable_interrupt();
+    else
+        __enable_interrupt();
+}
+
+//
+//  Clock
+//
+
+/** Same profiles as hal_clock.c, but all ticking at HAL_POSIX_SYSTICK_US */
+static const struct halClockProfile clockProfiles[HAL_CLOCK_NUM_PROFILES] =
+{
+    {  1,  0, 1000,  6, 0, 1, 0, HAL_POSIX_SYSTICK_US },
+    {  8,  0, 4000, 26, 0, 2, 0, HAL_POSIX_SYSTICK_US },
+    { 16,  0, 4000, 26, 0, 1, 0, HAL_POSIX_SYSTICK_US },
+};
+static uint8_t currentProfile = HAL_CLOCK_DEFAULT;
+static uint16_t switchCount = 0;
+static struct timespec startTime;
+
+int16_t halClockSet(uint8_t profile)
+{
+    if (profile >= HAL_CLOCK_NUM_PROFILES)
+        return -1;
+    if (profile != currentProfile)
+        switchCount++;
+    currentProfile = profile;
+    return 0;
+}
+
+uint8_t halClockGet()
+{
+    return currentProfile;
+}
+
+const struct halClockProfile* halClockGetProfile()
+{
+    return &clockProfiles[currentProfile];
+}
+
+void halClockTick()
+{
+}
+
+uint32_t halMillis()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) ((now.tv_sec - startTime.tv_sec) * 1000 + (now.tv_nsec - startTime.tv_nsec) / 1000000);
+}
+
+uint16_t halClockGetSwitchCount()
+{
+    return switchCount;
+}
+
+uint32_t halSrdyTimestamp()
+{
+    return srdyTimestamp;                       // Set only while no command is in flight, see runInterrupts()
+}
+
+void delayMs(uint16_t delay)
+{
+    struct timespec t = {delay / 1000, (delay % 1000) * 1000000L};
+    while (nanosleep(&t, &t) != 0 && errno == EINTR)
+        ;
+}
+
+void oscInit()
+{
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    halClockSet(HAL_CLOCK_DEFAULT);
+}
+
+//
+//  VLO and ADC: nothing to measure
+//
+
+void halVloCalibrationStart(uint16_t intervalSeconds)
+{
+    (void) intervalSeconds;
+    vloFrequency = HAL_POSIX_VLO_HZ;
+}
+
+void halVloCalibrationStop()
+{
+}
+
+void halVloCalibrationTick()
+{
+}
+
+uint16_t halVloGetLastMeasurement()
+{
+    return HAL_POSIX_VLO_HZ;
+}
+
+int16_t calibrateVlo()
+{
+    vloFrequency = HAL_POSIX_VLO_HZ;
+    return vloFrequency;
+}
+
+static uint8_t adcRunning = 0;
+
+void halAdcSamplerStart()
+{
+    adcRunning = 1;
+}
+
+void halAdcSamplerStop()
+{
+    adcRunning = 0;
+}
+
+uint8_t halAdcSamplerIsRunning()
+{
+    return adcRunning;
+}
+
+void halAdcSamplerTick()
+{
+}
+
+uint8_t halAdcSamplerTrigger()
+{
+    return 0;
+}
+
+void halAdcSamplerLockChannel(uint8_t ch)
+{
+    (void) ch;
+}
+
+uint16_t halAdcGetVcc()
+{
+    return HAL_POSIX_VCC_MV;
+}
+
+uint16_t halAdcGetCurrent()
+{
+    return 0;
+}
+
+uint16_t halAdcSumToCurrent(uint32_t sum)
+{
+    (void) sum;
+    return 0;
+}
+
+uint16_t getVcc3()
+{
+    return HAL_POSIX_VCC_MV;
+}
+
+uint16_t getCurrentSensor()
+{
+    return 0;
+}
+
+//
+//  Stack: not measured; the host's stack is not the MSP430's
+//
+
+void halStackPaint()
+{
+}
+
+uint16_t halStackSize()
+{
+    return 0;
+}
+
+uint16_t halStackHighWater()
+{
+    return 0;
+}
+
+void halRamDisplay()
+{
+    outStr("RAM: not measured on POSIX\r\n");
+}
+
+//
+//  Information memory, backed by a file
+//
+
+uint8_t halPosixFlash[3 * HAL_FLASH_SEGMENT_SIZE];
+static int flashFd = -1;
+
+#define IS_INFO_ADDRESS(a)  (((a) >= HAL_FLASH_INFO_D) && ((a) < HAL_FLASH_INFO_B + HAL_FLASH_SEGMENT_SIZE))
+
+static void flashLoad()
+{
+    const char* name = getenv("HAL_POSIX_FLASH");
+    memset(halPosixFlash, HAL_FLASH_ERASED, sizeof(halPosixFlash));
+    flashFd = open(name ? name : HAL_POSIX_FLASH_FILE, O_RDWR | O_CREAT, 0644);
+    if (flashFd < 0)
+    {
+        perror("HAL_POSIX_FLASH");
+        return;
+    }
+    if (pread(flashFd, halPosixFlash, sizeof(halPosixFlash), 0) != sizeof(halPosixFlash))
+        memset(halPosixFlash, HAL_FLASH_ERASED, sizeof(halPosixFlash));     // New or short: erased
+}
+
+static void flashSave()
+{
+    if ((flashFd >= 0) && (pwrite(flashFd, halPosixFlash, sizeof(halPosixFlash), 0) != sizeof(halPosixFlash)))
+        perror("HAL_POSIX_FLASH");
+}
+
+int16_t halFlashEraseSegment(uint16_t address)
+{
+    if (!IS_INFO_ADDRESS(address))
+        return -1;
+    uint16_t offset = (address - HAL_FLASH_INFO_D) & ~(HAL_FLASH_SEGMENT_SIZE - 1);
+    memset(halPosixFlash + offset, HAL_FLASH_ERASED, HAL_FLASH_SEGMENT_SIZE);
+    flashSave();
+    return 0;
+}
+
+int16_t halFlashWrite(uint16_t address, const uint8_t* bytes, uint8_t numBytes)
+{
+    if ((numBytes == 0) || !IS_INFO_ADDRESS(address) || !IS_INFO_ADDRESS(address + numBytes - 1))
+        return -1;
+    uint8_t i;
+    for (i = 0; i < numBytes; i++)
+        halPosixFlash[address - HAL_FLASH_INFO_D + i] &= bytes[i];          // Can only clear bits
+    flashSave();
+    return 0;
+}
+
+//
+//  LEDs and button
+//
+
+static uint8_t leds = 0;
+static uint8_t rgb[3] = {0, 0, 0};
+static volatile sig_atomic_t buttonSignal = 0;
+static uint32_t buttonReleaseTime = 0;
+
+int16_t setLed(uint8_t led)
+{
+    if (led > 4)
+        return -1;
+    leds |= (1 << led);
+    return 0;
+}
+
+int16_t clearLed(uint8_t led)
+{
+    if (led > 4)
+        return -1;
+    leds &= ~(1 << led);
+    return 0;
+}
+
+void clearLeds()
+{
+    leds = 0;
+}
+
+int16_t toggleLed(uint8_t led)
+{
+    if (led > 4)
+        return -1;
+    leds ^= (1 << led);
+    return 0;
+}
+
+void halRgbLedPwmInit()
+{
+    halRgbSetLeds(0, 0, 0);
+}
+
+void halRgbSetLeds(uint8_t red, uint8_t blue, uint8_t green)
+{
+    rgb[0] = red;
+    rgb[1] = blue;
+    rgb[2] = green;
+}
+
+void halRgbLedTest()
+{
+    halRgbAnimationStart(HAL_RGB_WAVE_COLOR_CYCLE, 0, 0, 0, 50);
+}
+
+uint8_t buttonIsPressed(uint8_t button)
+{
+    if ((button == ANY_BUTTON) || (button == BUTTON_0))
+        return ((int32_t) (buttonReleaseTime - halMillis()) > 0);
+    return 0;
+}
+
+static void handleButtonSignal(int sig)
+{
+    buttonSignal = sig;
+}
+
+void halSetAllPinsToInputs(void)
+{
+}
+
+void halSetWakeupFlags(uint16_t wakeupFlagsToSet)
+{
+    wakeupFlags |= wakeupFlagsToSet;
+}
+
+void halClearWakeupFlags(uint16_t wakeupFlagsToClear)
+{
+    wakeupFlags &= ~wakeupFlagsToClear;
+}
+
+//
+//  Console
+//
+
+static int consoleFd = -1;
+
+void halUartInit()
+{
+    const char* mode = getenv("HAL_POSIX_CONSOLE");
+    if (mode && (strcmp(mode, "stdio") == 0))
+    {
+        consoleFd = STDIN_FILENO;
+    } else {
+        consoleFd = posix_openpt(O_RDWR | O_NOCTTY);
+        if ((consoleFd < 0) || (grantpt(consoleFd) != 0) || (unlockpt(consoleFd) != 0))
+        {
+            perror("posix_openpt");
+            exit(1);
+        }
+        int terminal = open(ptsname(consoleFd), O_RDWR | O_NOCTTY);     // Kept open, so output isn't lost
+        struct termios raw;
+        if ((terminal < 0) || (tcgetattr(terminal, &raw) != 0))
+        {
+            perror("ptsname");
+            exit(1);
+        }
+        cfmakeraw(&raw);                    // No echo: output would come back as input
+        tcsetattr(terminal, TCSANOW, &raw);
+        fprintf(stderr, "Console on %s\n", ptsname(consoleFd));
+        fflush(stdout);
+        dup2(consoleFd, STDOUT_FILENO);
+    }
+    fcntl(consoleFd, F_SETFL, fcntl(consoleFd, F_GETFL) | O_NONBLOCK);
+    setvbuf(stdout, 0, _IOLBF, 0);
+}
+
+int putchar(int c)
+{
+    return fputc(c, stdout);
+}
+
+uint8_t halUartBusy()
+{
+    return 0;
+}
+
+void displayVersion()
+{
+    printf("\r\n\r\n-------- Module Interface and Examples %s --------\r\n", MODULE_INTERFACE_STRING);
+    printf("%s (POSIX)", MODULE_VERSION_STRING);
+}
+
+//
+//  Zigbee module
+//
+
+static pthread_mutex_t moduleLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t moduleCondition = PTHREAD_COND_INITIALIZER;
+static int moduleFd = -1;
+
+/** Frames from the module: queued AREQs, and the SRSP being waited for */
+static uint8_t areqQueue[AREQ_QUEUE_SIZE][MT_FRAME_MAX];
+static uint8_t areqHead = 0;
+static uint8_t areqCount = 0;
+static uint8_t srsp[MT_FRAME_MAX];
+static uint8_t srspReady = 0;
+
+/** SPI transaction: the frame being written, then the response being read */
+#define SPI_IDLE                        0
+#define SPI_WRITING                     1
+#define SPI_READING                     2
+static uint8_t spiPhase = SPI_IDLE;
+static uint8_t request[MT_FRAME_MAX];
+static uint8_t requestLength = 0;
+static uint8_t response[MT_FRAME_MAX];
+static uint8_t responseIndex = 0;
+/** Whether srdyIsr() has been called for the AREQ at the head of the queue */
+static uint8_t srdySignalled = 0;
+
+/** Wakes the interrupt thread when SRDY may have changed */
+static int wakePipe[2] = {-1, -1};
+
+static void wakeInterruptThread()
+{
+    char c = 0;
+    ssize_t n = write(wakePipe[1], &c, 1);  // Fails only if the pipe is full, i.e. already awake
+    (void) n;
+}
+
+/** Writes all of a frame to fd. @return 0 if success */
+static int writeFrame(int fd, const uint8_t* frame)
+{
+    size_t length = frame[0] + MT_HEADER_SIZE;
+    while (length > 0)
+    {
+        ssize_t n = write(fd, frame, length);
+        if (n <= 0)
+            return -1;
+        frame += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/** Reads exactly length bytes. @return 0 if success */
+static int readFully(int fd, uint8_t* bytes, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t n = read(fd, bytes, length);
+        if (n <= 0)
+            return -1;
+        bytes += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/** Connects to the module emulator if not connected. @pre moduleLock held */
+static void moduleConnect()
+{
+    if (moduleFd >= 0)
+        return;
+    const char* path = getenv("HAL_POSIX_MODULE");
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path ? path : HAL_POSIX_MODULE_SOCKET, sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((fd < 0) || (connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0))
+    {
+        if (fd >= 0)
+            close(fd);
+        return;                             // No module: SRDY never goes low, as if unpowered
+    }
+    moduleFd = fd;
+    pthread_cond_broadcast(&moduleCondition);   // Starts the reader
+}
+
+/** Receives frames from the module, for as long as it's connected */
+static void* moduleReaderThread(void* arg)
+{
+    (void) arg;
+    uint8_t frame[MT_FRAME_MAX];
+    while (1)
+    {
+        pthread_mutex_lock(&moduleLock);
+        while (moduleFd < 0)
+            pthread_cond_wait(&moduleCondition, &moduleLock);
+        int fd = moduleFd;
+        pthread_mutex_unlock(&moduleLock);
+        
+        if ((readFully(fd, frame, MT_HEADER_SIZE) != 0) || 
+            (frame[0] > MT_FRAME_MAX - MT_HEADER_SIZE) ||
+            (readFully(fd, frame + MT_HEADER_SIZE, frame[0]) != 0))
+        {
+            pthread_mutex_lock(&moduleLock);
+            close(moduleFd);
+            moduleFd = -1;                  // Reconnects at the next transaction
+            pthread_cond_broadcast(&moduleCondition);
+            pthread_mutex_unlock(&moduleLock);
+            continue;
+        }
+        
+        pthread_mutex_lock(&moduleLock);
+        if ((frame[1] & MT_TYPE_MASK) == MT_TYPE_SRSP)
+        {
+            memcpy(srsp, frame, frame[0] + MT_HEADER_SIZE);
+            srspReady = 1;
+        } else {
+            while ((areqCount == AREQ_QUEUE_SIZE) && (moduleFd == fd))
+                pthread_cond_wait(&moduleCondition, &moduleLock);   // Hold the module back, as SRDY would
+            memcpy(areqQueue[(areqHead + areqCount) % AREQ_QUEUE_SIZE], frame, frame[0] + MT_HEADER_SIZE);
+            areqCount++;
+        }
+        pthread_cond_broadcast(&moduleCondition);
+        pthread_mutex_unlock(&moduleLock);
+        wakeInterruptThread();
+    }
+    return 0;
+}
+
+/** Handles a complete frame written by the application. @pre moduleLock held */
+static void processRequest()
+{
+    memset(response, 0, sizeof(response));
+    responseIndex = 0;
+    switch (request[1] & MT_TYPE_MASK)
+    {
+    case MT_TYPE_POLL:                      // Read the oldest AREQ
+        if (areqCount > 0)
+        {
+            memcpy(response, areqQueue[areqHead], areqQueue[areqHead][0] + MT_HEADER_SIZE);
+            areqHead = (areqHead + 1) % AREQ_QUEUE_SIZE;
+            areqCount--;
+            srdySignalled = 0;
+            pthread_cond_broadcast(&moduleCondition);
+            if (moduleFd >= 0)
+                writeFrame(moduleFd, request);  // Lets the emulator send another, see its WINDOW
+        }
+        break;
+    case MT_TYPE_SREQ:
+        {
+            srspReady = 0;
+            if ((moduleFd < 0) || (writeFrame(moduleFd, request) != 0))
+                break;
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += SRSP_TIMEOUT_MS / 1000;
+            while (!srspReady)
+                if (pthread_cond_timedwait(&moduleCondition, &moduleLock, &deadline) == ETIMEDOUT)
+                    break;
+            if (srspReady)
+                memcpy(response, srsp, srsp[0] + MT_HEADER_SIZE);
+            srspReady = 0;
+            break;
+        }
+    default:                                // AREQ: no response
+        if (moduleFd >= 0)
+            writeFrame(moduleFd, request);
+        break;
+    }
+}
+
+/**
+Emulates the module's chip select (MRDY). Selecting starts a transaction: SRDY goes low, as the module 
+is ready to receive. 
+*/
+void halPosixSpiSelect(uint8_t selected)
+{
+    pthread_mutex_lock(&moduleLock);
+    if (selected)
+    {
+        moduleConnect();
+        spiPhase = (moduleFd >= 0) ? SPI_WRITING : SPI_IDLE;
+        requestLength = 0;
+    } else {
+        spiPhase = SPI_IDLE;
+    }
+    pthread_mutex_unlock(&moduleLock);
+    if (!selected)
+        wakeInterruptThread();              // Another AREQ may be waiting
+}
+
+/** @return 1 if SRDY is low: ready for a request, or an AREQ is waiting to be read */
+uint8_t halPosixSrdyIsLow()
+{
+    pthread_mutex_lock(&moduleLock);
+    uint8_t low = (spiPhase == SPI_WRITING) || ((spiPhase == SPI_IDLE) && (areqCount > 0));
+    pthread_mutex_unlock(&moduleLock);
+    return low;
+}
+
+/**
+Emulates the module's reset line. Releasing reset sends SYS_RESET_REQ to the emulator, which answers 
+with SYS_RESET_IND as the module does when it boots.
+*/
+void halPosixModuleReset(uint8_t inReset)
+{
+    static const uint8_t sysResetReq[] = {1, 0x41, 0x00, 0x00};
+    pthread_mutex_lock(&moduleLock);
+    areqCount = 0;                          // Whatever the module had queued is lost
+    srdySignalled = 0;
+    if (!inReset)
+    {
+        moduleConnect();
+        if (moduleFd >= 0)
+            writeFrame(moduleFd, sysResetReq);
+    }
+    pthread_cond_broadcast(&moduleCondition);
+    pthread_mutex_unlock(&moduleLock);
+}
+
+void halSpiInitModule()
+{
+}
+
+/**
+Writes bytes to the module, and replaces them with the bytes it returns: zeros while a request is 
+being written, then the response.
+*/
+void spiWrite(uint8_t *bytes, uint8_t numBytes)
+{
+    pthread_mutex_lock(&moduleLock);
+    while (numBytes--)
+    {
+        uint8_t in = *bytes;
+        *bytes = 0;
+        if (spiPhase == SPI_WRITING)
+        {
+            request[requestLength++] = in;
+            if ((requestLength >= MT_HEADER_SIZE) && (requestLength == request[0] + MT_HEADER_SIZE))
+            {
+                processRequest();
+                spiPhase = SPI_READING;     // SRDY goes high: the response can be read
+            }
+        } 
+        else if ((spiPhase == SPI_READING) && (responseIndex < sizeof(response)))
+        {
+            *bytes = response[responseIndex++];
+        }
+        bytes++;
+    }
+    pthread_mutex_unlock(&moduleLock);
+}
+
+//
+//  Interrupt thread
+//
+
+static uint8_t sysTickRunning = 0;
+static uint32_t timerPeriod = 0;
+static uint32_t timerNext = 0;
+
+void initSysTick(void)
+{
+    sysTickRunning = 1;
+}
+
+int16_t initTimer(uint8_t seconds)
+{
+    if ((seconds > TIMER_MAX_SECONDS) || (seconds == 0))
+        return -1;
+    if (vloFrequency == 0)
+        return -2;
+    wakeupFlags |= WAKEUP_AFTER_TIMER;
+    timerPeriod = seconds * 1000;
+    timerNext = halMillis() + timerPeriod;
+    return 0;
+}
+
+void stopTimer()
+{
+    timerPeriod = 0;
+}
+
+/** Runs the handlers for everything that happened since the last pass. @pre interruptLock held */
+static void runInterrupts(uint8_t sysTick)
+{
+    uint8_t c;
+    while (read(consoleFd, &c, 1) == 1)
+        debugConsoleIsr((int8_t) c);
+    
+    if (buttonSignal)
+    {
+        buttonReleaseTime = halMillis() + ((buttonSignal == SIGUSR2) ? BUTTON_HOLD_MS : BUTTON_PRESS_MS);
+        buttonSignal = 0;
+        buttonIsr(BUTTON_0);
+    }
+    
+    pthread_mutex_lock(&moduleLock);
+    uint8_t srdyFalling = (spiPhase == SPI_IDLE) && (areqCount > 0) && !srdySignalled;
+    if (srdyFalling)
+        srdySignalled = 1;
+    pthread_mutex_unlock(&moduleLock);
+    if (srdyFalling)
+    {
+        srdyTimestamp = halMillis();
+        srdyIsr();
+    }
+    
+    if (timerPeriod && ((int32_t) (halMillis() - timerNext) >= 0))
+    {
+        timerNext += timerPeriod;
+        timerIsr();
+    }
+    
+    if (sysTick && sysTickRunning)
+    {
+        halRgbAnimationTick();
+        sysTickIsr();
+    }
+}
+
+static void* interruptThread(void* arg)
+{
+    (void) arg;
+    struct timespec nextTick;
+    clock_gettime(CLOCK_MONOTONIC, &nextTick);
+    struct pollfd fds[2] = {{wakePipe[0], POLLIN, 0}, {consoleFd, POLLIN, 0}};
+    while (1)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t waitNs = (nextTick.tv_sec - now.tv_sec) * 1000000000LL + (nextTick.tv_nsec - now.tv_nsec);
+        if (waitNs > 0)
+        {
+            struct timespec timeout = {waitNs / 1000000000LL, waitNs % 1000000000LL};
+            ppoll(fds, 2, &timeout, 0);
+        }
+        
+        char drain[16];
+        while (read(wakePipe[0], drain, sizeof(drain)) > 0)
+            ;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        uint8_t sysTick = (now.tv_sec > nextTick.tv_sec) || 
+            ((now.tv_sec == nextTick.tv_sec) && (now.tv_nsec >= nextTick.tv_nsec));
+        if (sysTick)
+        {
+            nextTick.tv_nsec += HAL_POSIX_SYSTICK_US * 1000L;
+            if (nextTick.tv_nsec >= 1000000000L)
+            {
+                nextTick.tv_sec++;
+                nextTick.tv_nsec -= 1000000000L;
+            }
+            int64_t lateNs = (now.tv_sec - nextTick.tv_sec) * 1000000000LL + (now.tv_nsec - nextTick.tv_nsec);
+            if (lateNs > MAX_LATE_TICKS * HAL_POSIX_SYSTICK_US * 1000LL)
+                nextTick = now;             // Stopped, e.g. in a debugger: don't replay all the ticks missed
+        }
+        
+        __disable_interrupt();
+        runInterrupts(sysTick);
+        __enable_interrupt();
+    }
+    return 0;
+}
+
+/** Initializes the emulated hardware and starts the interrupt and module threads. Interrupts stay 
+disabled until HAL_ENABLE_INTERRUPTS(). */
+void halInit()
+{
+    __disable_interrupt();                  // As after reset
+    oscInit();
+    portInit();
+    halUartInit();
+    flashLoad();
+    
+    buttonIsr = &doNothing;
+    srdyIsr = &doNothingVoid;
+    sysTickIsr = &doNothingVoid;
+    timerIsr = &doNothingVoid;
+    debugConsoleIsr = &doNothing;
+    
+    signal(SIGUSR1, handleButtonSignal);
+    signal(SIGUSR2, handleButtonSignal);
+    signal(SIGPIPE, SIG_IGN);               // A lost module shows up as a failed write instead
+    if (pipe2(wakePipe, O_NONBLOCK) != 0)
+    {
+        perror("pipe2");
+        exit(1);
+    }
+    pthread_t thread;
+    if ((pthread_create(&thread, 0, moduleReaderThread, 0) != 0) || 
+        (pthread_create(&thread, 0, interruptThread, 0) != 0))
+    {
+        perror("pthread_create");
+        exit(1);
+    }
+    clearLeds();
+    displayVersion();
+}
+
+void portInit()
+{
+    leds = 0;
+}
+
+/* @} */
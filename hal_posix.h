@@ -0,0 +1,138 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_posix.h
+*
+* @brief POSIX implementation of the HAL, so that the unmodified application and Zigbee module
+* interface can run as a Linux process at host speed, for throughput testing and profiling. Declares
+* the same API as hal_launchpad.h.
+*
+To build for POSIX, compile with -DHAL_POSIX and this directory's HAL sources replaced as follows:
+- hal_posix.c replaces hal_launchpad.c, hal_clock.c, hal_vlo.c, hal_adc.c, hal_flash.c and hal_stack.c. 
+  hal_rgb.c and hal_output.c are used as is. hal_energy.c and hal_profiler.c are left out 
+  (ENERGY_PROFILING and PC_PROFILING must stay off).
+- hal_launchpad.h and <intrinsics.h> come from tools/posix/, which must be first on the include path.
+tools/posix/build.sh does this in a staging directory, with the ZM, Common and Messages sources taken 
+from the module SDK:
+    ZM_SDK=/path/to/sdk tools/posix/build.sh coordinator
+Anything added to hal_launchpad.h that the application or ZM code uses must be added here too.
+*
+The emulated hardware is configured from the environment:
+- HAL_POSIX_CONSOLE: "stdio" to use stdin and stdout as the debug console; otherwise a pseudo-terminal 
+  is created and its name printed on stderr, e.g. connect with "screen /dev/pts/3".
+- HAL_POSIX_MODULE: Unix domain socket of the emulated Zigbee module, default /tmp/zm_emulator.sock. 
+  See tools/zm_emulator.c.
+- HAL_POSIX_FLASH: file holding information memory, default hal_posix_flash.bin, so the journal 
+  survives restarts.
+The button is pressed with SIGUSR1 and held with SIGUSR2, e.g. "kill -USR1 <pid>".
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_POSIX_H
+#define HAL_POSIX_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <intrinsics.h>
+
+#define BIT0                            0x01
+#define BIT1                            0x02
+#define BIT2                            0x04
+#define BIT3                            0x08
+#define BIT4                            0x10
+#define BIT5                            0x20
+#define BIT6                            0x40
+#define BIT7                            0x80
+
+/** Interrupts are emulated by one lock, held by the interrupt thread while it runs a handler */
+#define HAL_ENABLE_INTERRUPTS()         __enable_interrupt()
+#define HAL_DISABLE_INTERRUPTS()        __disable_interrupt()
+#define HAL_WAKEUP()
+
+#define WAKEUP_AFTER_BUTTON             BIT0
+#define WAKEUP_AFTER_SRDY               BIT1
+#define WAKEUP_AFTER_TIMER              BIT2
+
+#define ANY_BUTTON                      0xFF
+#define BUTTON_0                        0
+
+#define RGB_LED_PWM_PERIOD              0xFF
+#define TIMER_MAX_SECONDS               4
+#define VLO_MIN                         9000
+#define VLO_MAX                         15000
+
+/** Module interface signals, emulated; see the SPI section of hal_posix.c */
+#define SPI_SS_SET()                    halPosixSpiSelect(1)
+#define SPI_SS_CLEAR()                  halPosixSpiSelect(0)
+#define SRDY_IS_HIGH()                  (!halPosixSrdyIsLow())
+#define SRDY_IS_LOW()                   (halPosixSrdyIsLow())
+#define RADIO_ON()                      halPosixModuleReset(0)
+#define RADIO_OFF()                     halPosixModuleReset(1)
+
+void halPosixSpiSelect(uint8_t selected);
+uint8_t halPosixSrdyIsLow();
+void halPosixModuleReset(uint8_t inReset);
+
+extern void (*debugConsoleIsr)(int8_t);
+extern void (*buttonIsr)(int8_t);
+extern void (*timerIsr)(void);
+extern void (*srdyIsr)(void);
+extern void (*sysTickIsr)(void);
+uint32_t halSrdyTimestamp();
+extern uint16_t wakeupFlags;
+extern uint16_t vloFrequency;
+
+void halInit();
+void oscInit();
+void portInit();
+void halUartInit();
+void displayVersion();
+int putchar(int c);
+void halSpiInitModule();
+void spiWrite(uint8_t *bytes, uint8_t numBytes);
+void delayMs(uint16_t delay);
+int16_t setLed(uint8_t led);
+int16_t clearLed(uint8_t led);
+void clearLeds();
+int16_t toggleLed(uint8_t led);
+uint8_t buttonIsPressed(uint8_t button);
+uint16_t getVcc3();
+uint16_t getCurrentSensor();
+void halSetAllPinsToInputs(void);
+void halSetWakeupFlags(uint16_t wakeupFlagsToSet);
+void halClearWakeupFlags(uint16_t wakeupFlagsToClear);
+int16_t initTimer(uint8_t seconds);
+void stopTimer();
+void initSysTick(void);
+int16_t calibrateVlo();
+uint8_t halUartBusy();
+void halRgbLedPwmInit();
+void halRgbSetLeds(uint8_t red, uint8_t blue, uint8_t green);
+void halRgbLedTest();
+
+#endif
+
+/* @} */
@@ -0,0 +1,199 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_profiler.c
+*
+* @brief Statistical PC sampling profiler. See hal_profiler.h.
+*
+Bins are 8 bits, to save RAM; when one is full they are all halved, which keeps their proportions. 
+The number of halvings is printed with the histogram.
+
+Output of halProfilerDisplay(), one bin per line, empty bins left out:
+    PROFILE start=C000 shift=8 bins=64 divider=13 samples=51234 scale=7 outside=0 invalid=3
+    P C200 41
+    P C300 255
+    PROFILE END
+where a bin covers 2^shift bytes from its address, and its count is in units of 2^scale samples.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_profiler.h"
+#include "hal_output.h"
+#include <intrinsics.h>
+#include <stdint.h>
+
+#ifdef PC_PROFILING
+
+/** Bits of the status register that are always zero */
+#define SR_RESERVED                     0xFE00
+
+static volatile uint8_t bins[HAL_PROFILER_BINS];
+static volatile uint32_t samples = 0;
+static volatile uint16_t outside = 0;
+static volatile uint16_t invalid = 0;
+static volatile uint8_t scale = 0;
+static uint16_t rangeStart = HAL_PROFILER_CODE_START;
+static uint16_t rangeEnd = HAL_PROFILER_CODE_END;
+static uint8_t shift = 0;
+static uint8_t sampleDivider = HAL_PROFILER_DIVIDER;
+static volatile uint8_t countdown = 1;
+static uint8_t running = 0;
+
+/**
+Clears the histogram and starts sampling.
+@param start lowest address profiled, even
+@param end address after the highest profiled
+@param divider sample every this many Timer A1 periods, at least 1
+@pre Timer A1 is running, see halRgbLedPwmInit()
+@return 0 if success, -1 if Timer A1 is stopped, -2 if the range or divider are invalid
+*/
+int16_t halProfilerStart(uint16_t start, uint16_t end, uint8_t divider)
+{
+    if (!(TA1CTL & MC_3))
+        return -1;
+    if ((end <= start) || (divider == 0))
+        return -2;
+    
+    halProfilerStop();
+    uint8_t i;
+    for (i = 0; i < HAL_PROFILER_BINS; i++)
+        bins[i] = 0;
+    samples = 0;
+    outside = 0;
+    invalid = 0;
+    scale = 0;
+    rangeStart = start & ~1;
+    rangeEnd = end;
+    shift = 1;                              // Instructions are word aligned
+    while (((uint32_t) HAL_PROFILER_BINS << shift) < (uint32_t) (rangeEnd - rangeStart))
+        shift++;
+    sampleDivider = divider;
+    countdown = divider;
+    running = 1;
+    TA1CCTL0 |= CCIE;
+    return 0;
+}
+
+/** Stops sampling. The histogram is kept. */
+void halProfilerStop()
+{
+    TA1CCTL0 &= ~CCIE;
+    running = 0;
+}
+
+uint8_t halProfilerIsRunning()
+{
+    return running;
+}
+
+/**
+Restarts profiling with the range narrowed to the bin with the most samples so far.
+@return 0 if success, -1 if there were no samples, -2 if already at one word per bin
+*/
+int16_t halProfilerZoom()
+{
+    uint8_t hottest = 0;
+    uint8_t i;
+    for (i = 1; i < HAL_PROFILER_BINS; i++)
+        if (bins[i] > bins[hottest])
+            hottest = i;
+    if (bins[hottest] == 0)
+        return -1;
+    if (shift <= 1)
+        return -2;
+    uint16_t start = rangeStart + ((uint16_t) hottest << shift);
+    uint16_t size = (uint16_t) 1 << shift;
+    return halProfilerStart(start, ((uint16_t) (rangeEnd - start) < size) ? rangeEnd : (start + size), sampleDivider);
+}
+
+/** Prints the histogram, in the format described above, for tools/profile_symbolize.py */
+void halProfilerDisplay()
+{
+    uint8_t copy[HAL_PROFILER_BINS];
+    uint32_t s;
+    uint16_t o, v;
+    uint8_t c;
+    uint8_t i;
+    
+    HAL_DISABLE_INTERRUPTS();               // Consistent snapshot: bins may be halved at any time
+    for (i = 0; i < HAL_PROFILER_BINS; i++)
+        copy[i] = bins[i];
+    s = samples;
+    o = outside;
+    v = invalid;
+    c = scale;
+    HAL_ENABLE_INTERRUPTS();
+    
+    outPrintf("PROFILE start=%04X shift=%u bins=%u divider=%u samples=%lu scale=%u outside=%u invalid=%u%s\r\n",
+              rangeStart, shift, HAL_PROFILER_BINS, sampleDivider, s, c, o, v, running ? "" : " (stopped)");
+    for (i = 0; i < HAL_PROFILER_BINS; i++)
+        if (copy[i] != 0)
+            outPrintf("P %04X %u\r\n", rangeStart + ((uint16_t) i << shift), copy[i]);
+    outStr("PROFILE END\r\n");
+}
+
+/** 
+Timer A1 CCR0 interrupt, once per RGB LED PWM period. Kept free of calls, so that its frame is just 
+the few registers it uses; see HAL_PROFILER_ISR_FRAME.
+*/
+#pragma vector = TIMER1_A0_VECTOR
+__interrupt void Timer1_A0(void)
+{
+    if (--countdown != 0)
+        return;
+    countdown = sampleDivider;
+    samples++;
+    
+    /* The interrupted context is at the top of the frame: SR, then PC */
+    const uint16_t* context = (const uint16_t*) (__get_SP_register() + HAL_PROFILER_ISR_FRAME - 4);
+    uint16_t sr = context[0];
+    uint16_t pc = context[1];
+    if ((sr & SR_RESERVED) || !(sr & GIE) || (pc & 1) || 
+        (pc < HAL_PROFILER_CODE_START) || (pc >= HAL_PROFILER_CODE_END))
+    {
+        invalid++;                          // Not an interrupted context: HAL_PROFILER_ISR_FRAME is wrong
+        return;
+    }
+    if ((pc < rangeStart) || (pc >= rangeEnd))
+    {
+        outside++;
+        return;
+    }
+    uint8_t bin = (uint8_t) ((uint16_t) (pc - rangeStart) >> shift);
+    if (bins[bin] == 0xFF)
+    {
+        uint8_t i;
+        for (i = 0; i < HAL_PROFILER_BINS; i++)
+            bins[i] >>= 1;
+        scale++;
+    }
+    bins[bin]++;
+}
+
+#endif
+
+/* @} */
@@ -0,0 +1,95 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_profiler.h
+*
+* @brief Statistical PC sampling profiler. Opt-in, see PC_PROFILING.
+*
+Samples the program counter of the code interrupted by Timer A1's CCR0 interrupt and counts it in a 
+histogram of HAL_PROFILER_BINS bins over an address range, initially all of main flash. This shows 
+where the CPU time actually goes, including library code (printf(), soft-float) and busy-waits 
+(spiWrite(), delayMs()) that explicit instrumentation doesn't see. The histogram is printed on the 
+console by halProfilerDisplay() and symbolized on the PC against the linker map with 
+tools/profile_symbolize.py. With 64 bins over 16kB each bin covers 256 bytes, often several small 
+functions; halProfilerZoom() restarts with the range narrowed to the hottest bin, down to one word per 
+bin.
+
+Timer A1 already runs continuously in up mode for the RGB LED PWM, so its CCR0 interrupt comes every 
+RGB_LED_PWM_PERIOD SMCLK cycles; one in every "divider" is sampled. With SMCLK at 4MHz and 
+HAL_PROFILER_DIVIDER, that's ~1200 samples per second. Interrupts that aren't sampled cost about 20 
+cycles each, i.e. 2-8% of the CPU depending on the clock profile, so profiling is off unless started.
+
+Limitations:
+- Interrupts don't nest, so time in other ISRs is not seen, and a sample due while interrupts are 
+  disabled is taken when they are enabled again, i.e. attributed to the code just after.
+- The interrupted PC is read from the stack at HAL_PROFILER_ISR_FRAME, which depends on the compiler. 
+  Samples where it doesn't look like an interrupted context are counted as invalid; if most are, set 
+  HAL_PROFILER_ISR_FRAME from the list file.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_PROFILER_H
+#define HAL_PROFILER_H
+
+#include <stdint.h>
+
+/** 
+Uncomment below to compile in the profiler. Uses Timer A1's CCR0 interrupt, so the RGB LED PWM must 
+be running (halRgbLedPwmInit()), and about 80 bytes of RAM.
+*/
+//#define PC_PROFILING
+
+/** Number of histogram bins */
+#define HAL_PROFILER_BINS               64
+
+/** Main flash of the MSP430G2553, less the interrupt vectors */
+#define HAL_PROFILER_CODE_START         0xC000
+#define HAL_PROFILER_CODE_END           0xFFE0
+
+/** Sample every this many Timer A1 periods by default. Prime, so as not to beat with the sysTick. */
+#ifndef HAL_PROFILER_DIVIDER
+#define HAL_PROFILER_DIVIDER            13
+#endif
+
+/** 
+Stack frame of the profiler ISR, including the interrupted PC and SR: the CSTACK figure for Timer1_A0 
+in the stack usage table of the list file (see tools/stack_report.py).
+*/
+#ifndef HAL_PROFILER_ISR_FRAME
+#define HAL_PROFILER_ISR_FRAME          10
+#endif
+
+#ifdef PC_PROFILING
+int16_t halProfilerStart(uint16_t start, uint16_t end, uint8_t divider);
+void halProfilerStop();
+uint8_t halProfilerIsRunning();
+int16_t halProfilerZoom();
+void halProfilerDisplay();
+#endif
+
+#endif
+
+/* @} */
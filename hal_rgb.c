@@ -0,0 +1,182 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_rgb.c
+*
+* @brief RGB LED animations. See hal_rgb.h.
+*
+An animation scales a color by a waveform: a table of brightness values in flash that is stepped 
+through every msPerStep, from the watchdog timer (sysTick) ISR. Each step is one call to 
+halRgbSetLeds(), i.e. three PWM compare register writes, so animations take no time in the main loop.
+Steps are timed by summing the sysTick interval of the current clock profile, so the speed of an 
+animation doesn't change with the clock. Resolution is one sysTick, 2mSec or 8mSec.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_rgb.h"
+#include "hal_clock.h"
+#include <stdint.h>
+
+/** Raised cosine, gamma corrected so that brightness appears to change evenly */
+static const uint8_t breatheWave[] =
+{
+      0,   0,   0,   0,   0,   1,   1,   2,   4,   6,   9,  14,  19,  26,  34,  44,
+     55,  68,  82,  97, 113, 130, 147, 164, 180, 196, 210, 223, 234, 243, 250, 254,
+    255, 254, 250, 243, 234, 223, 210, 196, 180, 164, 147, 130, 113,  97,  82,  68,
+     55,  44,  34,  26,  19,  14,   9,   6,   4,   2,   1,   1,   0,   0,   0,   0,
+};
+
+/** Gamma corrected ramp down */
+static const uint8_t fadeWave[] =
+{
+    255, 237, 220, 204, 188, 173, 159, 145, 132, 120, 108,  97,  87,  77,  68,  60,
+     52,  44,  38,  32,  26,  21,  17,  13,  10,   7,   5,   3,   1,   1,   0,   0,
+};
+
+static const uint8_t blinkWave[] = {255, 0};
+
+/** Sine. Color cycle plays it on each color a third of a period apart. */
+static const uint8_t sineWave[] =
+{
+    128, 140, 152, 165, 176, 188, 198, 208, 218, 226, 234, 240, 245, 250, 253, 254,
+    255, 254, 253, 250, 245, 240, 234, 226, 218, 208, 198, 188, 176, 165, 152, 140,
+    128, 115, 103,  90,  79,  67,  57,  47,  37,  29,  21,  15,  10,   5,   2,   1,
+      0,   1,   2,   5,  10,  15,  21,  29,  37,  47,  57,  67,  79,  90, 103, 115,
+};
+
+struct rgbWaveform
+{
+    const uint8_t* table;
+    uint8_t length;
+    /** 1 to repeat, 0 to stop at the last value */
+    uint8_t loop;
+};
+
+static const struct rgbWaveform waveforms[HAL_RGB_NUM_WAVEFORMS] =
+{
+    {fadeWave,      sizeof(fadeWave),       0},
+    {breatheWave,   sizeof(breatheWave),    1},
+    {blinkWave,     sizeof(blinkWave),      1},
+    {sineWave,      sizeof(sineWave),       1},
+};
+
+/** Animation being played. Written by the main loop only while running is 0. */
+static const struct rgbWaveform* wave = 0;
+static uint8_t waveformId = 0;
+static uint8_t color[3];                        // red, blue, green
+static uint32_t usPerStep = 0;
+static uint32_t elapsedUs = 0;
+static uint8_t step = 0;
+static volatile uint8_t running = 0;
+
+/** Shows step of the current animation */
+static void rgbShowStep()
+{
+    if (waveformId == HAL_RGB_WAVE_COLOR_CYCLE)
+    {
+        uint8_t third = wave->length / 3;
+        uint8_t blueStep = step + third;
+        uint8_t greenStep = step + third + third;
+        if (blueStep >= wave->length)
+            blueStep -= wave->length;
+        if (greenStep >= wave->length)
+            greenStep -= wave->length;
+        halRgbSetLeds(wave->table[step], wave->table[blueStep], wave->table[greenStep]);
+    } else {
+        uint16_t level = wave->table[step] + 1;     // So that 255 gives the full color
+        halRgbSetLeds((uint8_t) ((color[0] * level) >> 8), (uint8_t) ((color[1] * level) >> 8), 
+                      (uint8_t) ((color[2] * level) >> 8));
+    }
+}
+
+/**
+Starts an animation, replacing any that is playing. The first step is shown immediately.
+@param waveform which waveform, e.g. HAL_RGB_WAVE_BREATHE
+@param red the amount of red at full brightness - 0 to 0xFF
+@param blue the amount of blue at full brightness - 0 to 0xFF
+@param green the amount of green at full brightness - 0 to 0xFF
+@param msPerStep how long each step of the waveform is shown. Breathe and color cycle have 64 steps, 
+fade 32 and blink 2.
+@pre halRgbLedPwmInit() and initSysTick() have been called
+@return 0 if success, -1 if invalid waveform
+*/
+int16_t halRgbAnimationStart(uint8_t waveform, uint8_t red, uint8_t blue, uint8_t green, uint8_t msPerStep)
+{
+    if (waveform >= HAL_RGB_NUM_WAVEFORMS)
+        return -1;
+    running = 0;                                // Tick leaves everything alone while we change it
+    wave = &waveforms[waveform];
+    waveformId = waveform;
+    color[0] = red;
+    color[1] = blue;
+    color[2] = green;
+    usPerStep = ((uint32_t) msPerStep) * 1000;
+    elapsedUs = 0;
+    step = 0;
+    rgbShowStep();
+    running = 1;
+    return 0;
+}
+
+/** Stops the animation, leaving the LED as it is. Call before setting the LED with halRgbSetLeds(). */
+void halRgbAnimationStop()
+{
+    running = 0;
+}
+
+/** @return 1 if an animation is playing */
+uint8_t halRgbAnimationIsRunning()
+{
+    return running;
+}
+
+/** Advances the animation when a step is due. Called from the watchdog timer (sysTick) ISR. */
+void halRgbAnimationTick()
+{
+    if (!running)
+        return;
+    elapsedUs += halClockGetProfile()->sysTickUs;
+    if (elapsedUs < usPerStep)
+        return;
+    elapsedUs -= usPerStep;
+    if (elapsedUs >= usPerStep)                 // Step shorter than a sysTick; don't fall behind
+        elapsedUs = 0;
+    
+    step++;
+    if (step >= wave->length)
+    {
+        if (!wave->loop)
+        {
+            running = 0;                        // Last step stays on
+            return;
+        }
+        step = 0;
+    }
+    rgbShowStep();
+}
+
+/* @} */
@@ -0,0 +1,59 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_rgb.h
+*
+* @brief RGB LED animations, run from the sysTick using waveform tables in flash.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef HAL_RGB_H
+#define HAL_RGB_H
+
+#include <stdint.h>
+
+/** Waveforms for halRgbAnimationStart() */
+enum HAL_RGB_WAVEFORM
+{
+    /** Fades from the color to off, once, then stays off */
+    HAL_RGB_WAVE_FADE,
+    /** Smoothly brightens and dims the color */
+    HAL_RGB_WAVE_BREATHE,
+    /** Color on for one step, off for one step */
+    HAL_RGB_WAVE_BLINK,
+    /** Cycles through all hues. The color is ignored. */
+    HAL_RGB_WAVE_COLOR_CYCLE,
+    HAL_RGB_NUM_WAVEFORMS
+};
+
+int16_t halRgbAnimationStart(uint8_t waveform, uint8_t red, uint8_t blue, uint8_t green, uint8_t msPerStep);
+void halRgbAnimationStop();
+uint8_t halRgbAnimationIsRunning();
+void halRgbAnimationTick();
+
+#endif
+
+/* @} */
@@ -0,0 +1,87 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_stack.c
+*
+* @brief Stack high-water mark and RAM usage. See hal_stack.h.
+*
+The stack is the linker's CSTACK segment, which grows down from its end. halStackPaint() fills it 
+with HAL_STACK_PAINT from the bottom up to just below the current stack pointer; call it first thing 
+in main(), before any deep call. halStackHighWater() then scans up from the bottom for the first 
+byte that is no longer paint. A function that reserves stack but never writes to part of it can hide 
+a few bytes from this measurement, so leave some margin; tools/stack_report.py computes the static 
+worst case from the compiler's list files for comparison.
+*
+Segment sizes come from the linker (IAR __segment_size()), so halRamDisplay() always matches the map 
+file: DATA16_I is initialized data, DATA16_Z zero-initialized data and DATA16_N no-init data.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_stack.h"
+#include "hal_output.h"
+#include <stdint.h>
+#include <intrinsics.h>
+
+#pragma segment = "CSTACK"
+#pragma segment = "DATA16_I"
+#pragma segment = "DATA16_Z"
+#pragma segment = "DATA16_N"
+
+/** Paints the stack from its bottom to just below the current stack pointer. */
+void halStackPaint()
+{
+    volatile uint8_t* p = (volatile uint8_t*) __segment_begin("CSTACK");
+    volatile uint8_t* top = (volatile uint8_t*) __get_SP_register() - HAL_STACK_PAINT_MARGIN;
+    while (p < top)
+        *p++ = HAL_STACK_PAINT;
+}
+
+/** @return size of the stack, in bytes */
+uint16_t halStackSize()
+{
+    return (uint16_t) __segment_size("CSTACK");
+}
+
+/** @return most stack used since halStackPaint(), in bytes */
+uint16_t halStackHighWater()
+{
+    const uint8_t* p = (const uint8_t*) __segment_begin("CSTACK");
+    const uint8_t* end = (const uint8_t*) __segment_end("CSTACK");
+    while ((p < end) && (*p == HAL_STACK_PAINT))
+        p++;
+    return (uint16_t) (end - p);
+}
+
+/** Prints static RAM usage by segment, and stack usage so far. */
+void halRamDisplay()
+{
+    outPrintf("RAM: DATA=%u, BSS=%u, NOINIT=%u, STACK=%u of %u used\r\n", 
+              (uint16_t) __segment_size("DATA16_I"), (uint16_t) __segment_size("DATA16_Z"), 
+              (uint16_t) __segment_size("DATA16_N"), halStackHighWater(), halStackSize());
+}
+
+/* @} */
@@ -0,0 +1,207 @@
+/**
+* @ingroup hal
+* @{
+*
+* @file hal_vlo.c
+*
+* @brief Background recalibration of the Very Low Oscillator (VLO). See hal_vlo.h.
+*
+How it works:
+- Every intervalSeconds, ACLK is divided by 8 and Timer0_A capture/compare block 2 is set to capture 
+  on CCI2B, which is ACLK on the MSP430G2553, with an interrupt on each rising edge. Block 2 is free: 
+  the RGB PWM only uses blocks 0 and 1, and the capture does not disturb the count. 
+- The Timer0_A1 ISR counts the edges. The watchdog sysTick ISR times the window, VLO_WINDOW_MS, 
+  adding up the exact sysTick period of the clock profile so the window is as accurate as the DCO.
+- At the end of the window ACLK is restored, and the frequency is computed, checked against 
+  VLO_MIN/VLO_MAX and low-pass filtered into vloFrequency.
+Edges are not timed: Timer0_A runs in up mode for the PWM, with a period much shorter than an ACLK 
+cycle, so TAR capture deltas (as used by calibrateVlo()) would be ambiguous. Instead every edge must be 
+counted. Dividing ACLK by 8 leaves the ISR ~650uSec per edge rather than ~80uSec, and an edge that is 
+missed anyway sets COV; the window is then discarded rather than biasing the result low. A window that 
+sees a clock profile switch is discarded too, since a switch changes the sysTick period.
+ACLK is left undivided if Timer0_A is clocked from it (initTimer()), so as not to disturb the timer; the 
+ISR then runs at ~12kHz, and windows with missed edges are discarded the same way.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "hal_launchpad.h"
+#include "hal_clock.h"
+#include "hal_vlo.h"
+#include <stdint.h>
+
+/** Post-calibrated VLO frequency (in hal_launchpad.c), read by initTimer() */
+extern uint16_t vloFrequency;
+
+/** How long to count ACLK edges for. Longer is more precise and costs more interrupts. */
+#define VLO_WINDOW_MS                   1024
+
+/** ACLK divider while counting; DIVA_3 divides by 8 */
+#define VLO_DIVIDER                     8
+
+/** Weight of a new measurement in vloFrequency is 1/2^VLO_FILTER_SHIFT */
+#define VLO_FILTER_SHIFT                2
+
+#define VLO_STATE_OFF                   0
+#define VLO_STATE_WAITING               1
+#define VLO_STATE_COUNTING              2
+
+static uint8_t vloState = VLO_STATE_OFF;
+
+/** Seconds between windows, and halMillis() when the next one starts */
+static uint16_t vloIntervalSeconds = 0;
+static uint32_t vloNextWindow = 0;
+
+/** ACLK edges counted in the current window, by the Timer0_A1 ISR */
+static volatile uint16_t vloEdges = 0;
+
+/** Length of the current window so far, in microseconds, and the clock switch count at its start */
+static uint32_t vloWindowUs = 0;
+static uint16_t vloClockSwitches = 0;
+
+/** Result of the last accepted window, before filtering */
+static uint16_t vloLastMeasurement = 0;
+
+/** ACLK was divided for the current window */
+#define VLO_FLAG_DIVIDED                0x01
+/** An edge was missed in the current window; set by the Timer0_A1 ISR */
+#define VLO_FLAG_MISSED                 0x02
+static volatile uint8_t vloFlags = 0;
+
+/**
+Starts background recalibration. The first window starts at the next sysTick.
+@param intervalSeconds how often to recalibrate
+@pre initSysTick() has been called.
+@note If vloFrequency has not been set by calibrateVlo(), the first accepted window sets it directly.
+*/
+void halVloCalibrationStart(uint16_t intervalSeconds)
+{
+    vloIntervalSeconds = intervalSeconds;
+    vloNextWindow = halMillis();
+    vloState = VLO_STATE_WAITING;
+}
+
+/** Stops background recalibration. vloFrequency keeps its last value. */
+void halVloCalibrationStop()
+{
+    vloState = VLO_STATE_OFF;
+    TA0CCTL2 = 0;
+    if (vloFlags & VLO_FLAG_DIVIDED)
+        BCSCTL1 &= ~DIVA_3;
+    vloFlags = 0;
+}
+
+/** @return the VLO frequency measured by the last accepted window, unfiltered, or 0 if none yet */
+uint16_t halVloGetLastMeasurement()
+{
+    return vloLastMeasurement;
+}
+
+/** Ends the current window and folds its result into vloFrequency. */
+static void vloEndWindow()
+{
+    TA0CCTL2 = 0;                               // Stop capturing
+    uint32_t edges = vloEdges;
+    if (vloFlags & VLO_FLAG_DIVIDED)
+    {
+        BCSCTL1 &= ~DIVA_3;
+        edges *= VLO_DIVIDER;
+    }
+    if (vloFlags & VLO_FLAG_MISSED)
+        return;                                 // The count is short
+    if (halClockGetSwitchCount() != vloClockSwitches)
+        return;                                 // sysTick was restarted during the window
+    
+    /* f = edges / (windowUs / 1000000). Both scaled by 64 so that the product fits in 32 bits. */
+    uint16_t measured = (uint16_t) ((edges * 15625l) / (vloWindowUs >> 6));
+    if ((measured <= VLO_MIN) || (measured >= VLO_MAX))
+        return;
+    
+    vloLastMeasurement = measured;
+    if (vloFrequency == 0)
+        vloFrequency = measured;
+    else
+        vloFrequency = (uint16_t) ((int16_t) vloFrequency + (((int16_t) measured - (int16_t) vloFrequency) >> VLO_FILTER_SHIFT));
+}
+
+/** 
+Runs the calibration window state machine. Called from the watchdog timer (sysTick) ISR.
+*/
+void halVloCalibrationTick()
+{
+    switch (vloState)
+    {
+    case VLO_STATE_WAITING:
+        if ((int32_t) (halMillis() - vloNextWindow) >= 0)
+        {
+            vloEdges = 0;
+            vloWindowUs = 0;
+            vloClockSwitches = halClockGetSwitchCount();
+            vloFlags = 0;
+            if ((TA0CTL & TASSEL_3) != TASSEL_1)       // Not disturbing initTimer()
+            {
+                BCSCTL1 |= DIVA_3;
+                vloFlags = VLO_FLAG_DIVIDED;
+            }
+            TA0CCTL2 = CM_1 + CCIS_1 + CAP + CCIE;      // Capture rising edges of ACLK (CCI2B)
+            vloState = VLO_STATE_COUNTING;
+        }
+        break;
+    case VLO_STATE_COUNTING:
+        vloWindowUs += halClockGetProfile()->sysTickUs;
+        if (vloWindowUs >= (VLO_WINDOW_MS * 1000l))
+        {
+            vloEndWindow();
+            vloNextWindow = halMillis() + (vloIntervalSeconds * 1000l);
+            vloState = VLO_STATE_WAITING;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/** 
+Interrupt Service Routine for Timer0_A capture/compare blocks 1 and 2. Counts ACLK edges on block 2. 
+COV is set if an edge was captured while the previous one was still pending, i.e. one was missed.
+*/
+#pragma vector = TIMER0_A1_VECTOR
+__interrupt void Timer_A1 (void)
+{
+    switch (TA0IV)                              // Reading TA0IV clears the flag
+    {
+    case TA0IV_TACCR2:
+        vloEdges++;
+        if (TA0CCTL2 & COV)
+        {
+            TA0CCTL2 &= ~COV;
+            vloFlags |= VLO_FLAG_MISSED;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/* @} */
@@ -0,0 +1,279 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file journal.c
+*
+* @brief Append-only binary event journal in information flash. See journal.h.
+*
+Layout: segments D, C and B of information memory form a ring. Each starts with a header, a sequence 
+number and JOURNAL_MAGIC, followed by JOURNAL_RECORDS_PER_SEGMENT 4-byte records. Records are 
+appended to the newest segment; when it is full, the next segment in the ring, which is the oldest, 
+is erased and becomes the newest with the next sequence number. Every segment is erased in turn, 
+which levels the wear, and the journal always holds the last two to three segments' worth of events.
+*
+Writes are deferred: journalLog() only queues the record in RAM. journalFlush() does at most one flash 
+operation per call, so the caller can run it from a low priority task and let messages through in 
+between. It does nothing while VCC is unknown or too low to program flash.
+*
+Power can fail at any point, so:
+- A record's event byte is written last. A record is valid once its event byte is programmed; a 
+  record with an erased event byte but other bytes programmed was torn, and is skipped.
+- A header's magic is written after its sequence number, so a segment whose erase or header write 
+  was interrupted has no valid header and is treated as the oldest.
+*
+Tail recovery at boot, journalInit(), reads the three headers to find the newest segment, then 
+binary searches it for the first erased event byte. That is about eight flash reads, whatever the 
+journal holds.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../HAL/hal.h"
+#include "../HAL/hal_clock.h"
+#include "../HAL/hal_flash.h"
+#include "../HAL/hal_output.h"
+#include "journal.h"
+#include <stdint.h>
+
+#define JOURNAL_NUM_SEGMENTS            3
+#define JOURNAL_MAGIC                   0x4A4C
+#define JOURNAL_RECORDS_PER_SEGMENT     ((HAL_FLASH_SEGMENT_SIZE - sizeof(struct journalHeader)) / sizeof(struct journalRecord))
+
+/** Flash is only programmed above this. The MSP430G2553 needs 2.2V; allow for the ADC's error. */
+#define JOURNAL_MIN_VCC_MV              2400
+
+/** Start of each segment of information memory */
+struct journalHeader
+{
+    uint16_t sequence;
+    uint16_t magic;
+};
+
+/** The ring, in order */
+static const uint16_t segments[JOURNAL_NUM_SEGMENTS] = {HAL_FLASH_INFO_D, HAL_FLASH_INFO_C, HAL_FLASH_INFO_B};
+
+/** Newest segment, its sequence number, and the next free record in it */
+static uint8_t newest = 0;
+static uint16_t newestSequence = 0;
+static uint8_t tail = 0;
+
+/** Records waiting to be written, oldest first */
+static struct journalRecord queue[JOURNAL_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueCount = 0;
+static uint8_t dropped = 0;
+
+/** Dump position: segments from the oldest, and the record in that segment */
+static uint8_t dumpSegments = 0;
+static uint8_t dumpSegment = 0;
+static uint8_t dumpRecord = 0;
+
+#define HEADER(segment)     ((const struct journalHeader*) HAL_FLASH_PTR(segments[segment]))
+#define RECORD_ADDRESS(segment, i) \
+    (segments[segment] + sizeof(struct journalHeader) + (i) * sizeof(struct journalRecord))
+#define RECORD(segment, i)  ((const struct journalRecord*) HAL_FLASH_PTR(RECORD_ADDRESS(segment, i)))
+
+/** @return 1 if every byte of the record is erased */
+static uint8_t isErased(const struct journalRecord* r)
+{
+    const uint8_t* p = (const uint8_t*) r;
+    uint8_t i;
+    for (i = 0; i < sizeof(struct journalRecord); i++)
+        if (p[i] != HAL_FLASH_ERASED)
+            return 0;
+    return 1;
+}
+
+/**
+Finds the newest segment and the end of its records. If no segment has a valid header, the journal 
+is empty and the first write starts a new one in segment D.
+*/
+void journalInit()
+{
+    uint8_t found = 0;
+    uint8_t s;
+    for (s = 0; s < JOURNAL_NUM_SEGMENTS; s++)
+    {
+        if (HEADER(s)->magic != JOURNAL_MAGIC)
+            continue;
+        if (!found || ((int16_t) (HEADER(s)->sequence - newestSequence) > 0))
+        {
+            newest = s;
+            newestSequence = HEADER(s)->sequence;
+            found = 1;
+        }
+    }
+    if (!found)
+    {
+        newest = JOURNAL_NUM_SEGMENTS - 1;  // Full, so the next write erases segment 0
+        newestSequence = 0;
+        tail = JOURNAL_RECORDS_PER_SEGMENT;
+        return;
+    }
+    
+    uint8_t low = 0;                        // Records are appended in order, so binary search
+    uint8_t high = JOURNAL_RECORDS_PER_SEGMENT;
+    while (low < high)
+    {
+        uint8_t mid = (low + high) / 2;
+        if (RECORD(newest, mid)->event == HAL_FLASH_ERASED)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    tail = low;
+    while ((tail < JOURNAL_RECORDS_PER_SEGMENT) && !isErased(RECORD(newest, tail)))
+        tail++;                             // Torn write: skip it
+}
+
+/**
+Queues an event to be written by journalFlush(). Must not be called from an ISR.
+@param event what happened, a JOURNAL_EVENT
+@param arg event-specific detail
+*/
+void journalLog(uint8_t event, uint8_t arg)
+{
+    if (queueCount == JOURNAL_QUEUE_SIZE)
+    {
+        if (dropped < 0xFF)
+            dropped++;
+        return;
+    }
+    struct journalRecord* r = &queue[(queueHead + queueCount) % JOURNAL_QUEUE_SIZE];
+    r->event = event;
+    r->arg = arg;
+    r->seconds = (uint16_t) (halMillis() / 1000);
+    queueCount++;
+}
+
+/** Erases the oldest segment and makes it the newest */
+static void startSegment()
+{
+    uint8_t next = (newest + 1) % JOURNAL_NUM_SEGMENTS;
+    struct journalHeader h;
+    h.sequence = newestSequence + 1;
+    h.magic = JOURNAL_MAGIC;
+    halFlashEraseSegment(segments[next]);
+    halFlashWrite(segments[next], (const uint8_t*) &h.sequence, sizeof(h.sequence));
+    halFlashWrite(segments[next] + sizeof(h.sequence), (const uint8_t*) &h.magic, sizeof(h.magic));
+    newest = next;
+    newestSequence = h.sequence;
+    tail = 0;
+}
+
+/**
+Writes the oldest queued record to flash, or erases a segment to make room for it. 
+@return 1 if there is more to do and journalFlush() should be called again, 0 if the queue is empty 
+or VCC is too low to write flash now
+*/
+uint8_t journalFlush()
+{
+    if (queueCount == 0)
+        return 0;
+    uint16_t vcc = getVcc3();
+    if ((vcc == 0) || (vcc < JOURNAL_MIN_VCC_MV))
+        return 0;
+    if (tail >= JOURNAL_RECORDS_PER_SEGMENT)
+    {
+        startSegment();                     // The long operation: leave the write for next time
+        return 1;
+    }
+    uint16_t address = RECORD_ADDRESS(newest, tail);
+    const uint8_t* r = (const uint8_t*) &queue[queueHead];
+    halFlashWrite(address + 1, r + 1, sizeof(struct journalRecord) - 1);
+    halFlashWrite(address, r, 1);           // Event last: makes the record valid
+    tail++;
+    queueHead = (queueHead + 1) % JOURNAL_QUEUE_SIZE;
+    queueCount--;
+    return (queueCount > 0);
+}
+
+/** @return number of records waiting to be written */
+uint8_t journalPendingCount()
+{
+    return queueCount;
+}
+
+/** @return number of records dropped because the queue was full, saturating at 255 */
+uint8_t journalDroppedCount()
+{
+    return dropped;
+}
+
+static const char* eventName(uint8_t event)
+{
+    switch (event)
+    {
+    case JOURNAL_BOOT:                  return "BOOT";
+    case JOURNAL_ALARM_ON:              return "ALARM";
+    case JOURNAL_ALARM_OFF:             return "ALL CONNECTED";
+    case JOURNAL_ALARM_SILENCED:        return "SILENCED";
+    case JOURNAL_COORDINATOR_OFF:       return "COORDINATOR OFF";
+    case JOURNAL_COORDINATOR_ON:        return "COORDINATOR ON";
+    case JOURNAL_MODULE_START_FAILED:   return "MODULE START FAILED";
+    default:                            return "UNKNOWN";
+    }
+}
+
+/** Starts a dump of the journal, oldest first. Call journalDumpNext() until it returns 0. */
+void journalDumpStart()
+{
+    dumpSegments = 0;
+    dumpSegment = (newest + 1) % JOURNAL_NUM_SEGMENTS;
+    dumpRecord = 0;
+}
+
+/**
+Prints the next record of the dump. Records queued but not yet written are not included. 
+@return 1 if a record was printed, 0 if the dump is finished
+*/
+uint8_t journalDumpNext()
+{
+    while (dumpSegments < JOURNAL_NUM_SEGMENTS)
+    {
+        /* Only segments written in this ring cycle count; older ones were superseded or never used */
+        uint16_t age = JOURNAL_NUM_SEGMENTS - 1 - dumpSegments;
+        if ((HEADER(dumpSegment)->magic == JOURNAL_MAGIC) && 
+            (HEADER(dumpSegment)->sequence == (uint16_t) (newestSequence - age)) &&
+            (newestSequence >= age))
+        {
+            while (dumpRecord < JOURNAL_RECORDS_PER_SEGMENT)
+            {
+                const struct journalRecord* r = RECORD(dumpSegment, dumpRecord++);
+                if (r->event == HAL_FLASH_ERASED)
+                    continue;               // Free, or torn
+                outPrintf("JOURNAL %u.%u: %us %s %u\r\n", HEADER(dumpSegment)->sequence, dumpRecord - 1, 
+                          r->seconds, eventName(r->event), r->arg);
+                return 1;
+            }
+        }
+        dumpSegments++;
+        dumpSegment = (dumpSegment + 1) % JOURNAL_NUM_SEGMENTS;
+        dumpRecord = 0;
+    }
+    return 0;
+}
+
+/* @} */
@@ -0,0 +1,79 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file journal.h
+*
+* @brief Append-only binary event journal in information flash, so that alarms and other significant
+* events survive a reset and can be read back later from the console.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+
+/** Events recorded. 0 and 0xFF are reserved. */
+enum JOURNAL_EVENT
+{
+    JOURNAL_BOOT = 1,
+    /** Alarm started; arg is the index of the first lost device */
+    JOURNAL_ALARM_ON,
+    /** All devices connected again */
+    JOURNAL_ALARM_OFF,
+    /** Alarm silenced with the button */
+    JOURNAL_ALARM_SILENCED,
+    /** Coordinator switched off or on with a button hold */
+    JOURNAL_COORDINATOR_OFF,
+    JOURNAL_COORDINATOR_ON,
+    /** startModule() failed; arg is the error code */
+    JOURNAL_MODULE_START_FAILED,
+    JOURNAL_NUM_EVENTS
+};
+
+/** One journal record, as stored in flash */
+struct journalRecord
+{
+    uint8_t event;
+    uint8_t arg;
+    /** halMillis() / 1000 when logged; restarts at each JOURNAL_BOOT */
+    uint16_t seconds;
+};
+
+/** Records that can wait in RAM to be written. More are dropped, and counted. */
+#define JOURNAL_QUEUE_SIZE              4
+
+void journalInit();
+void journalLog(uint8_t event, uint8_t arg);
+uint8_t journalFlush();
+uint8_t journalPendingCount();
+uint8_t journalDroppedCount();
+void journalDumpStart();
+uint8_t journalDumpNext();
+
+#endif
+
+/* @} */
@@ -0,0 +1,129 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file latency.c
+*
+* @brief Alarm path latency instrumentation. See latency.h.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../HAL/hal.h"
+#include "../HAL/hal_clock.h"
+#include "../HAL/hal_output.h"
+#include "latency.h"
+#include <stdint.h>
+
+#ifdef LATENCY_HISTOGRAMS
+
+/** 
+Histogram of each stage. When a bucket is full, all the buckets of that stage are halved, which keeps 
+their proportions: the counts are relative, but percentiles read from them still hold.
+*/
+static uint8_t histograms[LATENCY_NUM_STAGES][LATENCY_NUM_BUCKETS];
+
+#ifdef LATENCY_INSTRUMENTATION
+/** Longest latency seen for each stage, in mSec */
+static uint16_t maximums[LATENCY_NUM_STAGES];
+#endif
+
+static char* const stageNames[LATENCY_NUM_STAGES] = {"GETMSG", "PARSE", "DECISION", "OUTPUT"};
+
+/**
+Records that a stage has just completed.
+@param stage which stage, e.g. LATENCY_STAGE_PARSE
+@param srdyTime halMillis() at the SRDY edge of the frame being processed
+*/
+void latencyRecord(uint8_t stage, uint32_t srdyTime)
+{
+    if (stage >= LATENCY_NUM_STAGES)
+        return;
+    
+    uint32_t elapsed = halMillis() - srdyTime;
+    uint16_t latency = (elapsed > 0xFFFF) ? 0xFFFF : ((uint16_t) elapsed);
+    
+    uint8_t bucket = 0;                         // Position of the highest set bit, plus one
+    uint16_t remaining = latency >> LATENCY_BUCKET0_SHIFT;
+    while ((remaining != 0) && (bucket < (LATENCY_NUM_BUCKETS - 1)))
+    {
+        remaining >>= 1;
+        bucket++;
+    }
+    
+    uint8_t* histogram = histograms[stage];
+    if (histogram[bucket] == 0xFF)
+    {
+        uint8_t i;
+        for (i = 0; i < LATENCY_NUM_BUCKETS; i++)
+            histogram[i] >>= 1;
+    }
+    histogram[bucket]++;
+#ifdef LATENCY_INSTRUMENTATION
+    if (latency > maximums[stage])
+        maximums[stage] = latency;
+#endif
+}
+
+/** Clears all histograms. */
+void latencyClear()
+{
+    uint8_t stage, bucket;
+    for (stage = 0; stage < LATENCY_NUM_STAGES; stage++)
+    {
+        for (bucket = 0; bucket < LATENCY_NUM_BUCKETS; bucket++)
+            histograms[stage][bucket] = 0;
+#ifdef LATENCY_INSTRUMENTATION
+        maximums[stage] = 0;
+#endif
+    }
+}
+
+/** 
+Displays all histograms. One line per stage: the name, the maximum if kept, and then the count in each 
+bucket, in order of bucket upper bound.
+*/
+void latencyDisplay()
+{
+    uint8_t stage, bucket;
+#ifdef LATENCY_INSTRUMENTATION
+    outPrintf("LATENCY FROM SRDY (mSec): STAGE MAX <32 <64 <128 <256 <512 >=512\r\n");
+#else
+    outPrintf("LATENCY FROM SRDY (mSec): STAGE <32 <64 <128 <256 <512 >=512\r\n");
+#endif
+    for (stage = 0; stage < LATENCY_NUM_STAGES; stage++)
+    {
+        outPrintf("%s", stageNames[stage]);
+#ifdef LATENCY_INSTRUMENTATION
+        outPrintf(" %u", maximums[stage]);
+#endif
+        for (bucket = 0; bucket < LATENCY_NUM_BUCKETS; bucket++)
+            outPrintf(" %u", histograms[stage][bucket]);
+        outPrintf("\r\n");
+    }
+}
+
+#endif
+
+/* @} */
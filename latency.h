@@ -0,0 +1,87 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file latency.h
+*
+* @brief Alarm path latency instrumentation. Records how long after the SRDY edge of a frame each
+* stage of processing that frame completed, in log2-bucketed histograms kept in RAM. The histograms
+* are displayed on demand from the debug console.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+/** Comment out below to remove the histograms and reclaim their RAM (24 bytes). */
+#define LATENCY_HISTOGRAMS
+
+/** 
+Uncomment below to add the rest of the instrumentation: the longest latency of each stage, and the 
+statistics kept by the scheduler and by module_async.c. Costs about 100 bytes of RAM, which the default 
+build can't spare; see the RAM budget in tools/stack_report.py. Implies LATENCY_HISTOGRAMS.
+*/
+//#define LATENCY_INSTRUMENTATION
+
+#if defined(LATENCY_INSTRUMENTATION) && !defined(LATENCY_HISTOGRAMS)
+#define LATENCY_HISTOGRAMS
+#endif
+
+/** Stages of the alarm path, each measured from the SRDY edge of the frame */
+enum LATENCY_STAGE
+{
+    /** getMessage() has read the frame from the module */
+    LATENCY_STAGE_GET_MESSAGE,
+    /** parseMessages() has finished with the frame */
+    LATENCY_STAGE_PARSE,
+    /** trackingStateMachine() has decided the state of the device that sent the frame */
+    LATENCY_STAGE_DECISION,
+    /** The alarm output (red LED, buzzer) was asserted because of the frame */
+    LATENCY_STAGE_OUTPUT,
+    LATENCY_NUM_STAGES
+};
+
+/** 
+Bucket 0 counts latencies under LATENCY_BUCKET0_MS; bucket n counts 2^(n-1) to 2^n - 1 times that, so 
+32, 64, 128, 256 and 512mSec are the bucket boundaries. The last bucket also counts everything longer.
+*/
+#define LATENCY_NUM_BUCKETS             6
+#define LATENCY_BUCKET0_SHIFT           5
+#define LATENCY_BUCKET0_MS              (1 << LATENCY_BUCKET0_SHIFT)
+
+#ifdef LATENCY_HISTOGRAMS
+void latencyRecord(uint8_t stage, uint32_t srdyTime);
+void latencyClear();
+void latencyDisplay();
+#define LATENCY_RECORD(stage, srdyTime)     latencyRecord((stage), (srdyTime))
+#else
+#define LATENCY_RECORD(stage, srdyTime)
+#endif
+
+#endif
+
+/* @} */
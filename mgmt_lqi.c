@@ -0,0 +1,111 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file mgmt_lqi.c
+*
+* @brief ZDO Mgmt_Lqi neighbor table queries. See mgmt_lqi.h.
+*
+Mgmt_Lqi_req asks a device for its neighbor table, including the link quality at which it hears each 
+neighbor. Asking the coordinator's own module (short address 0x0000) therefore gives the LQI of every 
+device in radio range of the coordinator, in one request, whether or not the device has sent anything 
+recently. The table is returned in pages of a few entries; request the next page with the startIndex 
+following the last page.
+The request is queued with moduleAsync, so that it doesn't hold the SPI bus while other tasks run. 
+Each page arrives later as a ZDO_MGMT_LQI_RSP message, to be parsed with mgmtLqiParseResponse().
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../ZM/module.h"
+#include "../ZM/zm_phy_spi.h"
+#include "mgmt_lqi.h"
+#include "module_async.h"
+#include <stdint.h>
+
+extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
+
+/**
+Queues a request for a page of a device's neighbor table, to be sent by moduleAsyncRun().
+@param destinationAddress short address of the device, 0x0000 for the coordinator
+@param startIndex index of the first table entry wanted
+@param callback called when the module has accepted or refused the request; the SRSP status is then 
+in zmBuf[SRSP_PAYLOAD_START]. May be NULL.
+@return as moduleAsyncQueue()
+*/
+int16_t mgmtLqiRequest(uint16_t destinationAddress, uint8_t startIndex, moduleAsyncCallback callback)
+{
+    uint8_t data[ZDO_MGMT_LQI_REQ_PAYLOAD_LEN];
+    data[0] = LSB(destinationAddress);
+    data[1] = MSB(destinationAddress);
+    data[2] = startIndex;
+    return moduleAsyncQueue(ZDO_MGMT_LQI_REQ, data, sizeof(data), callback);
+}
+
+/**
+Parses the ZDO_MGMT_LQI_RSP message in zmBuf.
+@param rsp filled in with the page of the table
+@return 0 if success, -1 if zmBuf doesn't hold a complete, successful ZDO_MGMT_LQI_RSP
+*/
+int16_t mgmtLqiParseResponse(struct mgmtLqiResponse* rsp)
+{
+    if (!IS_ZDO_MGMT_LQI_RSP())
+        return -1;
+    rsp->sourceAddress = CONVERT_TO_INT(zmBuf[MGMT_LQI_RSP_SOURCE_ADDRESS_FIELD], 
+                                        zmBuf[MGMT_LQI_RSP_SOURCE_ADDRESS_FIELD + 1]);
+    rsp->status = zmBuf[MGMT_LQI_RSP_STATUS_FIELD];
+    rsp->totalEntries = zmBuf[MGMT_LQI_RSP_TOTAL_ENTRIES_FIELD];
+    rsp->startIndex = zmBuf[MGMT_LQI_RSP_START_INDEX_FIELD];
+    rsp->count = zmBuf[MGMT_LQI_RSP_COUNT_FIELD];
+    rsp->list = zmBuf + MGMT_LQI_RSP_LIST_FIELD;
+    if (rsp->status != MODULE_SUCCESS)
+        return -1;
+    
+    /* Don't trust count beyond what was actually received */
+    uint16_t length = zmBuf[SRSP_LENGTH_FIELD] + SRSP_HEADER_SIZE;
+    if ((MGMT_LQI_RSP_LIST_FIELD + ((uint16_t) rsp->count * MGMT_LQI_ENTRY_SIZE)) > length)
+        return -1;
+    return 0;
+}
+
+/** @return the extended (MAC) address of a neighbor, LSB first as in routers[].MAC_address */
+const uint8_t* mgmtLqiEntryExtendedAddress(const struct mgmtLqiResponse* rsp, uint8_t entry)
+{
+    return rsp->list + (entry * MGMT_LQI_ENTRY_SIZE) + MGMT_LQI_ENTRY_EXTENDED_ADDRESS;
+}
+
+/** @return the short address of a neighbor */
+uint16_t mgmtLqiEntryShortAddress(const struct mgmtLqiResponse* rsp, uint8_t entry)
+{
+    const uint8_t* e = rsp->list + (entry * MGMT_LQI_ENTRY_SIZE);
+    return CONVERT_TO_INT(e[MGMT_LQI_ENTRY_SHORT_ADDRESS], e[MGMT_LQI_ENTRY_SHORT_ADDRESS + 1]);
+}
+
+/** @return the link quality at which the queried device hears a neighbor */
+uint8_t mgmtLqiEntryLqi(const struct mgmtLqiResponse* rsp, uint8_t entry)
+{
+    return rsp->list[(entry * MGMT_LQI_ENTRY_SIZE) + MGMT_LQI_ENTRY_LQI];
+}
+
+/* @} */
@@ -0,0 +1,92 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file mgmt_lqi.h
+*
+* @brief ZDO Mgmt_Lqi neighbor table queries, for collecting the LQI of many devices at once.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef MGMT_LQI_H
+#define MGMT_LQI_H
+
+#include <stdint.h>
+#include "../ZM/module.h"
+#include "../ZM/zm_phy_spi.h"
+#include "module_async.h"
+
+#ifndef ZDO_MGMT_LQI_REQ
+#define ZDO_MGMT_LQI_REQ                0x2531
+#define ZDO_MGMT_LQI_RSP                0x45B1
+#endif
+
+#define ZDO_MGMT_LQI_REQ_PAYLOAD_LEN    3
+
+#define IS_ZDO_MGMT_LQI_RSP()   ((zmBuf[SRSP_CMD_MSB_FIELD] == MSB(ZDO_MGMT_LQI_RSP)) && \
+                                 (zmBuf[SRSP_CMD_LSB_FIELD] == LSB(ZDO_MGMT_LQI_RSP)))
+
+/** 
+Fields of ZDO_MGMT_LQI_RSP, offsets from the start of zmBuf. The neighbor list is a sequence of 
+entries of MGMT_LQI_ENTRY_SIZE bytes.
+*/
+#define MGMT_LQI_RSP_SOURCE_ADDRESS_FIELD   (SRSP_HEADER_SIZE)
+#define MGMT_LQI_RSP_STATUS_FIELD           (SRSP_HEADER_SIZE + 2)
+#define MGMT_LQI_RSP_TOTAL_ENTRIES_FIELD    (SRSP_HEADER_SIZE + 3)
+#define MGMT_LQI_RSP_START_INDEX_FIELD      (SRSP_HEADER_SIZE + 4)
+#define MGMT_LQI_RSP_COUNT_FIELD            (SRSP_HEADER_SIZE + 5)
+#define MGMT_LQI_RSP_LIST_FIELD             (SRSP_HEADER_SIZE + 6)
+
+/** Fields of one neighbor list entry, offsets from the start of the entry */
+#define MGMT_LQI_ENTRY_SIZE                 22
+#define MGMT_LQI_ENTRY_EXTENDED_ADDRESS     8
+#define MGMT_LQI_ENTRY_SHORT_ADDRESS        16
+#define MGMT_LQI_ENTRY_LQI                  21
+
+/** One page of a neighbor table, as received in ZDO_MGMT_LQI_RSP */
+struct mgmtLqiResponse
+{
+    /** Device whose neighbor table this is */
+    uint16_t sourceAddress;
+    uint8_t status;
+    /** Number of entries in the whole table */
+    uint8_t totalEntries;
+    /** Index in the table of the first entry in this page */
+    uint8_t startIndex;
+    /** Number of entries in this page */
+    uint8_t count;
+    /** First entry in this page, in zmBuf */
+    const uint8_t* list;
+};
+
+int16_t mgmtLqiRequest(uint16_t destinationAddress, uint8_t startIndex, moduleAsyncCallback callback);
+int16_t mgmtLqiParseResponse(struct mgmtLqiResponse* rsp);
+const uint8_t* mgmtLqiEntryExtendedAddress(const struct mgmtLqiResponse* rsp, uint8_t entry);
+uint16_t mgmtLqiEntryShortAddress(const struct mgmtLqiResponse* rsp, uint8_t entry);
+uint8_t mgmtLqiEntryLqi(const struct mgmtLqiResponse* rsp, uint8_t entry);
+
+#endif
+
+/* @} */
@@ -0,0 +1,289 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file module_async.c
+*
+* @brief Asynchronous module commands. See module_async.h.
+*
+A command goes through these phases, each left as soon as SRDY allows:
+- Queued.
+- Ready: SS asserted, waiting for the module to pull SRDY low. The request is then written.
+- Response (SREQ only): waiting for SRDY to go high. The SRSP is then read into zmBuf and SS released.
+An AREQ is complete once written. If a phase takes longer than MODULE_ASYNC_TIMEOUT_MS the command 
+fails with MODULE_ASYNC_TIMEOUT and SS is released.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../HAL/hal.h"
+#include "../HAL/hal_clock.h"
+#include "../HAL/hal_output.h"
+#include "../ZM/module.h"
+#include "../ZM/zm_phy_spi.h"
+#include "module_async.h"
+#include <stdint.h>
+
+extern uint8_t zmBuf[ZIGBEE_MODULE_BUFFER_SIZE];
+
+#define MT_TYPE_MASK                    0xE0
+#define MT_TYPE_SREQ                    0x20
+#define MT_TYPE_SRSP                    0x60
+#define MT_SUBSYSTEM_MASK               0x1F
+
+struct moduleCommand
+{
+    uint16_t command;
+    uint8_t length;
+    uint8_t data[MODULE_ASYNC_DATA_MAX];
+    moduleAsyncCallback callback;
+#ifdef LATENCY_INSTRUMENTATION
+    /** halMillis() when queued */
+    uint32_t queuedAt;
+#endif
+};
+
+enum MODULE_ASYNC_PHASE
+{
+    PHASE_IDLE,
+    PHASE_READY,
+    PHASE_RESPONSE
+};
+
+static struct moduleCommand queue[MODULE_ASYNC_QUEUE_SIZE];
+static uint8_t head = 0;                    // Oldest command, the one in progress if any
+static uint8_t count = 0;
+static uint8_t phase = PHASE_IDLE;
+/** halMillis() when the current phase started */
+static uint32_t phaseStart = 0;
+#ifdef LATENCY_INSTRUMENTATION
+/** halMillis() when SS was asserted */
+static uint32_t transactionStart = 0;
+static struct moduleAsyncStats stats;
+#endif
+
+/** Releases the module and hands the result of the command in progress to its callback */
+static void complete(moduleResult_t result)
+{
+    SPI_SS_CLEAR();
+    phase = PHASE_IDLE;
+    
+#ifdef LATENCY_INSTRUMENTATION
+    uint32_t roundTrip = halMillis() - transactionStart;
+    if (result == MODULE_SUCCESS)
+    {
+        stats.completed++;
+        stats.totalRoundTrip += roundTrip;
+        if (roundTrip > stats.maxRoundTrip)
+            stats.maxRoundTrip = (roundTrip > 0xFFFF) ? 0xFFFF : roundTrip;
+    } else {
+        stats.errors++;
+    }
+#endif
+    
+    moduleAsyncCallback callback = queue[head].callback;
+    head = (head + 1) % MODULE_ASYNC_QUEUE_SIZE;
+    count--;                                // Before the callback, which may queue another command
+    if (callback)
+        callback(result);
+}
+
+/** @return 1 if the current phase has taken too long, in which case the command has failed */
+static uint8_t timedOut()
+{
+    if ((halMillis() - phaseStart) < MODULE_ASYNC_TIMEOUT_MS)
+        return 0;
+    complete(MODULE_ASYNC_TIMEOUT);
+    return 1;
+}
+
+/** Empties the queue, e.g. because the module is being reset. Callbacks are not called. */
+void moduleAsyncInit()
+{
+    if (phase != PHASE_IDLE)
+        SPI_SS_CLEAR();
+    phase = PHASE_IDLE;
+    head = 0;
+    count = 0;
+}
+
+/**
+Queues a command. Doesn't talk to the module: call moduleAsyncRun() to send it.
+@param command MT command, cmd0 in the MSB and cmd1 in the LSB; SREQ or AREQ
+@param data payload, length bytes
+@param callback called when the command completes or fails, may be 0
+@return 0 if success, -1 if the payload is too long, -2 if the queue is full
+*/
+int16_t moduleAsyncQueue(uint16_t command, const uint8_t* data, uint8_t length, moduleAsyncCallback callback)
+{
+    if (length > MODULE_ASYNC_DATA_MAX)
+        return -1;
+    if (count == MODULE_ASYNC_QUEUE_SIZE)
+    {
+#ifdef LATENCY_INSTRUMENTATION
+        stats.overflows++;
+#endif
+        return -2;
+    }
+    struct moduleCommand* c = &queue[(head + count) % MODULE_ASYNC_QUEUE_SIZE];
+    c->command = command;
+    c->length = length;
+    uint8_t i;
+    for (i = 0; i < length; i++)
+        c->data[i] = data[i];
+    c->callback = callback;
+    count++;
+#ifdef LATENCY_INSTRUMENTATION
+    c->queuedAt = halMillis();
+    if (count > stats.maxDepth)
+        stats.maxDepth = count;
+#endif
+    return 0;
+}
+
+/**
+Queues SYS_GPIO, the asynchronous equivalent of sysGpio(). 
+@param operation GPIO_SET_DIRECTION, GPIO_SET, etc.
+@param value GPIO pins, or direction
+@return as moduleAsyncQueue()
+*/
+int16_t moduleAsyncSysGpio(uint8_t operation, uint8_t value, moduleAsyncCallback callback)
+{
+    uint8_t data[2];
+    data[0] = operation;
+    data[1] = value;
+    return moduleAsyncQueue(SYS_GPIO, data, sizeof(data), callback);
+}
+
+/**
+Advances the command in progress, or starts the next one, as far as SRDY allows without waiting.
+Completes at most one command per call.
+@return 1 if there is more to do: call again later
+*/
+uint8_t moduleAsyncRun()
+{
+    struct moduleCommand* c = &queue[head];
+    switch (phase)
+    {
+    case PHASE_IDLE:
+        if (count == 0)
+            return 0;
+        SPI_SS_SET();
+        phase = PHASE_READY;
+        phaseStart = halMillis();
+#ifdef LATENCY_INSTRUMENTATION
+        transactionStart = phaseStart;
+        {
+            uint32_t wait = transactionStart - c->queuedAt;
+            if (wait > stats.maxQueueWait)
+                stats.maxQueueWait = (wait > 0xFFFF) ? 0xFFFF : wait;
+        }
+#endif
+        /* fall through: the module may be ready already */
+    case PHASE_READY:
+        if (SRDY_IS_HIGH())
+            return (timedOut() ? (count > 0) : 1);
+        zmBuf[SRSP_LENGTH_FIELD] = c->length;
+        zmBuf[SRSP_CMD_MSB_FIELD] = MSB(c->command);
+        zmBuf[SRSP_CMD_LSB_FIELD] = LSB(c->command);
+        {
+            uint8_t i;
+            for (i = 0; i < c->length; i++)
+                zmBuf[SRSP_PAYLOAD_START + i] = c->data[i];
+        }
+        spiWrite(zmBuf, c->length + SRSP_HEADER_SIZE);
+        if ((MSB(c->command) & MT_TYPE_MASK) != MT_TYPE_SREQ)
+        {
+            complete(MODULE_SUCCESS);       // AREQ: nothing comes back
+            return (count > 0);
+        }
+        phase = PHASE_RESPONSE;
+        phaseStart = halMillis();
+        /* fall through */
+    case PHASE_RESPONSE:
+        if (SRDY_IS_LOW())
+            return (timedOut() ? (count > 0) : 1);
+        {
+            uint8_t i;
+            for (i = 0; i < SRSP_HEADER_SIZE; i++)
+                zmBuf[i] = 0;
+            spiWrite(zmBuf, SRSP_HEADER_SIZE);
+            uint8_t length = zmBuf[SRSP_LENGTH_FIELD];
+            if (length > (ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE))
+                length = ZIGBEE_MODULE_BUFFER_SIZE - SRSP_HEADER_SIZE;  // Read what fits, so that SS can be released cleanly
+            for (i = 0; i < length; i++)
+                zmBuf[SRSP_PAYLOAD_START + i] = 0;
+            spiWrite(zmBuf + SRSP_PAYLOAD_START, length);
+            uint8_t matches = (zmBuf[SRSP_CMD_MSB_FIELD] == (MT_TYPE_SRSP | (MSB(c->command) & MT_SUBSYSTEM_MASK))) &&
+                              (zmBuf[SRSP_CMD_LSB_FIELD] == LSB(c->command)) &&
+                              (zmBuf[SRSP_LENGTH_FIELD] == length);
+            complete(matches ? MODULE_SUCCESS : MODULE_ASYNC_BAD_RESPONSE);
+        }
+        return (count > 0);
+    default:
+        moduleAsyncInit();
+        return 0;
+    }
+}
+
+/** @return 1 if a command is in progress, i.e. SS is asserted and the module is reserved */
+uint8_t moduleAsyncIsBusy()
+{
+    return (phase != PHASE_IDLE);
+}
+
+/** @return number of commands queued, including the one in progress */
+uint8_t moduleAsyncPendingCount()
+{
+    return count;
+}
+
+#ifdef LATENCY_INSTRUMENTATION
+const struct moduleAsyncStats* moduleAsyncGetStats()
+{
+    return &stats;
+}
+
+void moduleAsyncClearStats()
+{
+    stats.completed = 0;
+    stats.errors = 0;
+    stats.overflows = 0;
+    stats.maxDepth = count;
+    stats.maxQueueWait = 0;
+    stats.maxRoundTrip = 0;
+    stats.totalRoundTrip = 0;
+}
+
+/** Displays the statistics on the debug console */
+void moduleAsyncDisplayStats()
+{
+    outPrintf("MODULE COMMANDS: %u OK, %u FAILED, %u OVERFLOWED, DEPTH %u MAX %u\r\n", 
+              stats.completed, stats.errors, stats.overflows, count, stats.maxDepth);
+    outPrintf("    QUEUE WAIT MAX %ums, ROUND TRIP AVG %lums MAX %ums\r\n", stats.maxQueueWait,
+              stats.completed ? (stats.totalRoundTrip / stats.completed) : 0UL, stats.maxRoundTrip);
+}
+#endif
+
+/* @} */
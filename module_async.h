@@ -0,0 +1,104 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file module_async.h
+*
+* @brief Asynchronous module commands: queued, and sent by a task one SRDY handshake step at a time.
+*
+The ZM library's commands (e.g. sysGpio()) each assert SS, busy-wait for SRDY to go low, write the 
+request, busy-wait for SRDY to go high and read the response, so the application stalls for every 
+round-trip. Commands queued here are sent by moduleAsyncRun() instead, which advances the handshake 
+as far as SRDY allows and returns, so that other tasks run while the module is busy. Responses are 
+checked against the request and handed to the command's callback, in the order queued.
+
+While a command is in progress (moduleAsyncIsBusy()) SS is asserted and the module is reserved: 
+nothing else may talk to it, synchronously or by reading messages, until the command completes.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef MODULE_ASYNC_H
+#define MODULE_ASYNC_H
+
+#include "../ZM/module.h"
+#include "latency.h"
+#include <stdint.h>
+
+/** 
+Commands that can be waiting, including the one in progress: the two SYS_GPIO of setModuleLeds() and 
+a ZDO_MGMT_LQI_REQ. moduleAsyncQueue() returns an error when full. 
+*/
+#define MODULE_ASYNC_QUEUE_SIZE         3
+/** Largest command payload; enough for SYS_GPIO (2) and ZDO_MGMT_LQI_REQ (3) */
+#define MODULE_ASYNC_DATA_MAX           3
+/** How long the module has to complete the SRDY handshake */
+#define MODULE_ASYNC_TIMEOUT_MS         200
+
+/** Results passed to callbacks besides MODULE_SUCCESS */
+#define MODULE_ASYNC_TIMEOUT            0xE0
+#define MODULE_ASYNC_BAD_RESPONSE       0xE1
+#define MODULE_ASYNC_CANCELLED          0xE2
+
+#ifndef SYS_GPIO
+#define SYS_GPIO                        0x210E
+#endif
+
+/** 
+Called when a command completes. For an SREQ the SRSP is in zmBuf, checked to be the response to the 
+command if result is MODULE_SUCCESS.
+*/
+typedef void (*moduleAsyncCallback)(moduleResult_t result);
+
+/** Statistics, in milliseconds of halMillis(). Kept only with LATENCY_INSTRUMENTATION. */
+struct moduleAsyncStats
+{
+    uint16_t completed;
+    /** Timeouts and bad responses */
+    uint16_t errors;
+    /** Commands not queued because the queue was full */
+    uint16_t overflows;
+    uint8_t maxDepth;
+    /** Longest time from being queued to being started */
+    uint16_t maxQueueWait;
+    /** Longest time from SS being asserted to the response being read */
+    uint16_t maxRoundTrip;
+    uint32_t totalRoundTrip;
+};
+
+void moduleAsyncInit();
+int16_t moduleAsyncQueue(uint16_t command, const uint8_t* data, uint8_t length, moduleAsyncCallback callback);
+int16_t moduleAsyncSysGpio(uint8_t operation, uint8_t value, moduleAsyncCallback callback);
+uint8_t moduleAsyncRun();
+uint8_t moduleAsyncIsBusy();
+uint8_t moduleAsyncPendingCount();
+#ifdef LATENCY_INSTRUMENTATION
+const struct moduleAsyncStats* moduleAsyncGetStats();
+void moduleAsyncClearStats();
+void moduleAsyncDisplayStats();
+#endif
+
+#endif
+
+/* @} */
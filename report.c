@@ -0,0 +1,149 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file report.c
+*
+* @brief Change-driven console reporting of the tracking table. See report.h.
+*
+Remembers what was last reported for each device: its state and average LQI. reportChanges() only 
+writes a one-line record for devices whose state changed, or whose average moved by more than 
+REPORT_LQI_HYSTERESIS, so console traffic follows the rate of change rather than the message rate. 
+reportSnapshot() writes the whole table, as a keyframe for anyone who starts watching the console late; 
+call it periodically.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../HAL/hal_output.h"
+#include "report.h"
+#include "tracking.h"
+#include <stdint.h>
+#include <stdio.h>
+
+/** What was last reported for each device */
+struct reportedDevice
+{
+    uint8_t state;
+    uint8_t average;
+};
+
+/** Value of reportedDevice.state that means never reported, so that the next report includes it */
+#define REPORTED_NEVER                  0xFF
+
+static struct reportedDevice reported[NUM_DEVICES];
+
+static const char* stateName(uint8_t state)
+{
+    switch (state)
+    {
+    case ALL_ITEMS_CONNECTED:   return "CONNECTED";
+    case SUSPECTED_ITEM_LOSS:   return "SUSPECTED";
+    case ITEM_LOST_ALARM:       return "LOST";
+    case ITEM_LOST_SILENCED:    return "SILENCED";
+    default:                    return "UNKNOWN";
+    }
+}
+
+/** Writes a one-line record for a device and remembers what was written */
+static void reportDevice(const struct router_device* r, uint16_t index)
+{
+    outStr("DEVICE ");
+    outUnsigned(index);
+    putchar(' ');
+    outHexBytesReversed(r->MAC_address, 8);
+    putchar(' ');
+    outStr(stateName(r->track_state));
+    outStr(" AVG=");
+    outHex8(r->LQI_average);
+    outStr(" LQI=");
+    outHex8(r->LQI);
+    outStr(" T=");
+    outUnsigned(r->rx_timestamp);
+    outNewline();
+    reported[index].state = r->track_state;
+    reported[index].average = r->LQI_average;
+}
+
+/** Forgets what was reported, so that the next reportChanges() reports every device. */
+void reportInit()
+{
+    uint16_t i;
+    for (i = 0; i < NUM_DEVICES; i++)
+    {
+        reported[i].state = REPORTED_NEVER;
+        reported[i].average = 0;
+    }
+}
+
+/**
+Reports the devices that changed since they were last reported.
+@param ctx the devices; at most NUM_DEVICES are reported
+@return number of devices reported
+*/
+uint8_t reportChanges(const struct trackingContext* ctx)
+{
+    uint8_t count = 0;
+    uint16_t i;
+    for (i = 0; (i < ctx->numDevices) && (i < NUM_DEVICES); i++)
+    {
+        const struct router_device* r = &ctx->routers[i];
+        int16_t delta = (int16_t) r->LQI_average - (int16_t) reported[i].average;
+        if ((r->track_state != reported[i].state) || 
+            (delta > REPORT_LQI_HYSTERESIS) || (delta < -REPORT_LQI_HYSTERESIS))
+        {
+            reportDevice(r, i);
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+Writes the whole table, with every LQI sample of every device.
+@param ctx the devices
+@param now current time, for the header, e.g. halMillis()
+*/
+void reportSnapshot(const struct trackingContext* ctx, uint32_t now)
+{
+    outStr("SNAPSHOT T=");
+    outUnsigned(now);
+    outNewline();
+    uint16_t i;
+    for (i = 0; (i < ctx->numDevices) && (i < NUM_DEVICES); i++)
+    {
+        const struct router_device* r = &ctx->routers[i];
+        reportDevice(r, i);
+        outStr("    SAMPLES:");
+        uint8_t j;
+        for (j = 0; j < LQI_NUM_SAMPLES; j++)
+        {
+            putchar(' ');
+            outHex8(r->LQI_running_average[j]);
+        }
+        outNewline();
+    }
+}
+
+/* @} */
@@ -0,0 +1,183 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file scheduler.c
+*
+* @brief Tiny run-to-completion task scheduler. See scheduler.h. Priority of a task is its index in
+* the task table. The ready bitmap is set from ISRs and cleared from the main loop, so only the clear
+* needs interrupts disabled. Worst case latency of a task is therefore the longest run time of any one
+* task, plus the ISR load.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "../HAL/hal.h"
+#include "../HAL/hal_clock.h"
+#include "../HAL/hal_energy.h"
+#include "../HAL/hal_output.h"
+#include "scheduler.h"
+#include <stdint.h>
+#include <intrinsics.h>
+
+/** The application's task table. Index in the table is the priority, 0 = highest. */
+static const struct schedulerTask* tasks = 0;
+static uint8_t numberOfTasks = 0;
+
+/** Called whenever no task is ready. */
+static void (*idleHook)(void) = 0;
+
+/** One bit per task, set when the task is ready to run. Written by ISRs. */
+static volatile uint8_t readyTasks = 0;
+
+#ifdef LATENCY_INSTRUMENTATION
+/** Time (low 16 bits of halMillis()) when each task was first posted since it last ran */
+static uint16_t postedAt[SCHEDULER_MAX_TASKS];
+
+static struct schedulerTaskStats stats[SCHEDULER_MAX_TASKS];
+#endif
+
+/**
+Initializes the scheduler.
+@param table the task table. Index in the table is the priority, 0 = highest.
+@param numTasks number of entries in table, maximum SCHEDULER_MAX_TASKS
+@param idle function to call when no tasks are ready, or 0 if none
+@return 0 if success, -1 if the table has too many tasks; nothing is initialized then
+*/
+int16_t schedulerInit(const struct schedulerTask* table, uint8_t numTasks, void (*idle)(void))
+{
+    if (numTasks > SCHEDULER_MAX_TASKS)
+        return -1;
+    tasks = table;
+    numberOfTasks = numTasks;
+    idleHook = idle;
+    readyTasks = 0;
+#ifdef LATENCY_INSTRUMENTATION
+    schedulerClearStats();
+#endif
+    return 0;
+}
+
+/**
+Makes a task ready to run. Posting a task that is already ready has no further effect.
+@note May be called from an ISR or from the main loop.
+@param taskId index of the task in the task table
+*/
+void schedulerPost(uint8_t taskId)
+{
+    if (taskId >= numberOfTasks)
+        return;
+    uint8_t mask = (1 << taskId);
+    __istate_t interruptState = __get_interrupt_state();    // Don't re-enable interrupts inside an ISR
+    __disable_interrupt();
+#ifdef LATENCY_INSTRUMENTATION
+    if (!(readyTasks & mask))
+        postedAt[taskId] = (uint16_t) halMillis();
+#endif
+    readyTasks |= mask;
+    __set_interrupt_state(interruptState);
+}
+
+/**
+Runs the highest priority ready task to completion, or the idle hook if no task is ready.
+Call this repeatedly from the main loop.
+*/
+void schedulerRun()
+{
+    uint8_t ready = readyTasks;
+    if (ready == 0)
+    {
+        ENERGY_SET_REGION(ENERGY_REGION_IDLE);
+        if (idleHook)
+            idleHook();
+        return;
+    }
+    
+    uint8_t taskId = 0;
+    uint8_t mask = 0x01;
+    while (!(ready & mask))                 // Lowest set bit is the highest priority
+    {
+        mask <<= 1;
+        taskId++;
+    }
+    
+    HAL_DISABLE_INTERRUPTS();               // ISRs may be setting other bits
+    readyTasks &= ~mask;
+    HAL_ENABLE_INTERRUPTS();
+    
+#ifdef LATENCY_INSTRUMENTATION
+    uint16_t start = (uint16_t) halMillis();
+    uint16_t latency = start - postedAt[taskId];
+#endif
+    ENERGY_SET_REGION(ENERGY_REGION_APP);
+    tasks[taskId].run();
+#ifdef LATENCY_INSTRUMENTATION
+    uint16_t runTime = (uint16_t) halMillis() - start;
+    
+    stats[taskId].runs++;
+    if (latency > stats[taskId].maxLatency)
+        stats[taskId].maxLatency = latency;
+    if (runTime > stats[taskId].maxRunTime)
+        stats[taskId].maxRunTime = runTime;
+#endif
+}
+
+#ifdef LATENCY_INSTRUMENTATION
+
+/**
+@param taskId index of the task in the task table
+@return statistics for the selected task, or 0 if not a valid task
+*/
+const struct schedulerTaskStats* schedulerGetStats(uint8_t taskId)
+{
+    if (taskId >= numberOfTasks)
+        return 0;
+    return &stats[taskId];
+}
+
+/** Resets the statistics of all tasks. */
+void schedulerClearStats()
+{
+    uint8_t i;
+    for (i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        stats[i].runs = 0;
+        stats[i].maxLatency = 0;
+        stats[i].maxRunTime = 0;
+    }
+}
+
+/** Displays the statistics of all tasks, in milliseconds. */
+void schedulerDisplayStats()
+{
+    uint8_t i;
+    outPrintf("Task\tRuns\tMaxLatency\tMaxRunTime (mSec)\r\n");
+    for (i = 0; i < numberOfTasks; i++)
+    {
+        outPrintf("%s\t%u\t%u\t%u\r\n", tasks[i].name, stats[i].runs, stats[i].maxLatency, stats[i].maxRunTime);
+    }
+}
+#endif
+
+/* @} */
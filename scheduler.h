@@ -0,0 +1,81 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file scheduler.h
+*
+* @brief Tiny run-to-completion task scheduler. Tasks live in a static table supplied by the
+* application; the index of a task in the table is its priority (0 = highest). Tasks are made ready
+* with schedulerPost(), which may be called from an ISR, and each ready task runs to completion before
+* the next one is selected.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "latency.h"
+#include <stdint.h>
+
+/** Maximum number of tasks in a task table. Limited by the width of the ready bitmap. */
+#define SCHEDULER_MAX_TASKS             8
+
+/** One entry in the application's task table. */
+struct schedulerTask
+{
+    /** Task body. Must run to completion; re-post the task to continue work later. */
+    void (*run)(void);
+    /** Pretty name, used by schedulerDisplayStats() */
+    char* name;
+};
+
+/** Per-task statistics, in milliseconds of halMillis(). Kept only with LATENCY_INSTRUMENTATION. */
+struct schedulerTaskStats
+{
+    uint16_t runs;
+    /** Longest time a task was ready before it was dispatched */
+    uint16_t maxLatency;
+    /** Longest time a task took to run */
+    uint16_t maxRunTime;
+};
+
+/** 
+Compile-time check that a task table fits, e.g. SCHEDULER_ASSERT_TASKS_FIT(NUM_TASKS); at file scope. 
+Fails to compile (negative array size) if there are more than SCHEDULER_MAX_TASKS.
+*/
+#define SCHEDULER_ASSERT_TASKS_FIT(n)   typedef char schedulerTasksFit[((n) <= SCHEDULER_MAX_TASKS) ? 1 : -1]
+
+int16_t schedulerInit(const struct schedulerTask* table, uint8_t numTasks, void (*idle)(void));
+void schedulerPost(uint8_t taskId);
+void schedulerRun();
+#ifdef LATENCY_INSTRUMENTATION
+const struct schedulerTaskStats* schedulerGetStats(uint8_t taskId);
+void schedulerClearStats();
+void schedulerDisplayStats();
+#endif
+
+#endif
+
+/* @} */
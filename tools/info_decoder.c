@@ -0,0 +1,300 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file info_decoder.c
+*
+* @brief Batch decoder for captured info messages. See info_decoder.h.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "info_decoder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+/** Smallest chunk worth a thread of its own */
+#define MIN_FRAMES_PER_THREAD           4096
+
+struct chunk
+{
+    const struct infoFrames* frames;
+    struct infoBatch* batch;
+    size_t first;
+    size_t last;
+    /** KVPs in the chunk, then where they start in the output */
+    size_t numKvps;
+    size_t firstKvp;
+    /** What to do: count the KVPs or decode */
+    int decode;
+};
+
+/**
+Allocates room for a batch. KVP arrays get INFO_DECODER_BLOCK spare entries, for the last block.
+@return 0 if success
+*/
+int infoBatchInit(struct infoBatch* batch, size_t frameCapacity, size_t kvpCapacity)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->frameCapacity = frameCapacity;
+    batch->kvpCapacity = kvpCapacity;
+    size_t k = kvpCapacity + INFO_DECODER_BLOCK;
+    batch->status = malloc(frameCapacity);
+    batch->sequence = malloc(frameCapacity);
+    batch->version = malloc(frameCapacity);
+    batch->flags = malloc(frameCapacity);
+    batch->mac = malloc(frameCapacity * sizeof(uint64_t));
+    batch->deviceType = malloc(frameCapacity);
+    batch->numParameters = malloc(frameCapacity);
+    batch->firstKvp = malloc(frameCapacity * sizeof(uint32_t));
+    batch->kvpFrame = malloc(k * sizeof(uint32_t));
+    batch->oid = malloc(k);
+    batch->value = malloc(k * sizeof(int16_t));
+    if (!batch->status || !batch->sequence || !batch->version || !batch->flags || !batch->mac || 
+        !batch->deviceType || !batch->numParameters || !batch->firstKvp || !batch->kvpFrame || 
+        !batch->oid || !batch->value)
+    {
+        infoBatchFree(batch);
+        return -1;
+    }
+    return 0;
+}
+
+void infoBatchFree(struct infoBatch* batch)
+{
+    free(batch->status);
+    free(batch->sequence);
+    free(batch->version);
+    free(batch->flags);
+    free(batch->mac);
+    free(batch->deviceType);
+    free(batch->numParameters);
+    free(batch->firstKvp);
+    free(batch->kvpFrame);
+    free(batch->oid);
+    free(batch->value);
+    memset(batch, 0, sizeof(*batch));
+}
+
+/** @return number of KVPs in a frame, 0 if it's invalid, with status set */
+static inline uint8_t frameKvps(const uint8_t* frame, uint8_t length, uint8_t* status)
+{
+    if (length < INFO_HEADER_SIZE)
+    {
+        *status = INFO_STATUS_TOO_SHORT;
+        return 0;
+    }
+    uint8_t n = frame[INFO_NUM_PARAMETERS_FIELD];
+    if (INFO_HEADER_SIZE + n * INFO_KVP_SIZE > length)
+    {
+        *status = INFO_STATUS_TRUNCATED;
+        return 0;
+    }
+    *status = INFO_STATUS_OK;
+    return n;
+}
+
+/** @return number of KVPs in valid frames first to last - 1 */
+size_t infoCountKvps(const struct infoFrames* frames, size_t first, size_t last)
+{
+    size_t n = 0, i;
+    uint8_t status;
+    for (i = first; i < last; i++)
+        n += frameKvps(frames->data + frames->offsets[i], frames->lengths[i], &status);
+    return n;
+}
+
+/** Decodes INFO_DECODER_BLOCK KVPs, whether or not they are all in the frame */
+static inline void decodeBlock(const uint8_t* p, uint8_t* oid, int16_t* value)
+{
+#ifdef __SSSE3__
+    // 24 bytes as two overlapping loads: bytes 0-15 and 8-23
+    __m128i low = _mm_loadu_si128((const __m128i*) p);
+    __m128i high = _mm_loadu_si128((const __m128i*) (p + 8));
+    __m128i oids = _mm_or_si128(
+        _mm_shuffle_epi8(low, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(high, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1)));
+    __m128i values = _mm_or_si128(
+        _mm_shuffle_epi8(low, _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, 13, 14, -1, -1, -1, -1, -1, -1)),
+        _mm_shuffle_epi8(high, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8, 9, 11, 12, 14, 15)));
+    _mm_storel_epi64((__m128i*) oid, oids);
+    _mm_storeu_si128((__m128i*) value, values);
+#else
+    int j;
+    for (j = 0; j < INFO_DECODER_BLOCK; j++)
+    {
+        oid[j] = p[INFO_KVP_SIZE * j];
+        value[j] = (int16_t) (p[INFO_KVP_SIZE * j + 1] | (p[INFO_KVP_SIZE * j + 2] << 8));
+    }
+#endif
+}
+
+/** Decodes a chunk of frames into its part of the output, which starts at c->firstKvp */
+static void decodeChunk(const struct chunk* c)
+{
+    const struct infoFrames* frames = c->frames;
+    struct infoBatch* b = c->batch;
+    size_t kvp = c->firstKvp;
+    /** Blocks must not write past here: the next chunk's KVPs, written by another thread */
+    size_t end = (c->last == frames->numFrames) ? (kvp + c->numKvps + INFO_DECODER_BLOCK) : (kvp + c->numKvps);
+    size_t i;
+    for (i = c->first; i < c->last; i++)
+    {
+        const uint8_t* f = frames->data + frames->offsets[i];
+        uint8_t status;
+        uint8_t n = frameKvps(f, frames->lengths[i], &status);
+        b->status[i] = status;
+        b->numParameters[i] = n;
+        b->firstKvp[i] = (uint32_t) kvp;
+        if (status == INFO_STATUS_TOO_SHORT)
+        {
+            b->sequence[i] = b->version[i] = b->flags[i] = b->deviceType[i] = 0;
+            b->mac[i] = 0;
+            continue;
+        }
+        b->sequence[i] = f[0];
+        b->version[i] = f[1];
+        b->flags[i] = f[2];
+        uint64_t mac;
+        memcpy(&mac, f + 3, sizeof(mac));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        mac = __builtin_bswap64(mac);
+#endif
+        b->mac[i] = mac;
+        b->deviceType[i] = f[11];
+        
+        const uint8_t* p = f + INFO_HEADER_SIZE;
+        uint32_t j;
+        for (j = 0; j < n; j += INFO_DECODER_BLOCK)
+        {
+            size_t k = kvp + j;
+            if (k + INFO_DECODER_BLOCK <= end)
+            {
+                decodeBlock(p + INFO_KVP_SIZE * j, b->oid + k, b->value + k);
+                int m;
+                for (m = 0; m < INFO_DECODER_BLOCK; m++)
+                    b->kvpFrame[k + m] = (uint32_t) i;
+            } else {
+                uint32_t m;
+                for (m = j; m < n; m++)         // Last KVPs of the chunk
+                {
+                    b->oid[kvp + m] = p[INFO_KVP_SIZE * m];
+                    b->value[kvp + m] = (int16_t) (p[INFO_KVP_SIZE * m + 1] | (p[INFO_KVP_SIZE * m + 2] << 8));
+                    b->kvpFrame[kvp + m] = (uint32_t) i;
+                }
+            }
+        }
+        kvp += n;
+    }
+}
+
+static void* runChunk(void* arg)
+{
+    struct chunk* c = arg;
+    if (c->decode)
+        decodeChunk(c);
+    else
+        c->numKvps = infoCountKvps(c->frames, c->first, c->last);
+    return 0;
+}
+
+/** Runs every chunk, one per thread. Chunks whose thread can't be started are run by the caller. */
+static void runChunks(struct chunk* chunks, pthread_t* threads, int numChunks)
+{
+    int k;
+    for (k = 1; k < numChunks; k++)
+        if (pthread_create(&threads[k], 0, runChunk, &chunks[k]) != 0)
+            break;
+    int started = k;
+    runChunk(&chunks[0]);
+    for (k = started; k < numChunks; k++)
+        runChunk(&chunks[k]);
+    for (k = 1; k < started; k++)
+        pthread_join(threads[k], 0);
+}
+
+/**
+Decodes a batch of frames. Frames must be followed by INFO_DECODER_PADDING readable bytes.
+@param frames the frames; at most batch->frameCapacity
+@param batch where to decode them; its previous contents are replaced
+@param numThreads number of threads to share the work between, including the caller
+@return 0 if success, -1 if the batch is too small: batch->numKvps is then the KVPs needed
+*/
+int infoDecodeBatch(const struct infoFrames* frames, struct infoBatch* batch, int numThreads)
+{
+    if (frames->numFrames > batch->frameCapacity)
+        return -1;
+    if (numThreads > (int) (frames->numFrames / MIN_FRAMES_PER_THREAD))
+        numThreads = (int) (frames->numFrames / MIN_FRAMES_PER_THREAD);
+    if (numThreads < 1)
+        numThreads = 1;
+    struct chunk* chunks = calloc(numThreads, sizeof(struct chunk));
+    pthread_t* threads = calloc(numThreads, sizeof(pthread_t));
+    if (!chunks || !threads)
+    {
+        free(chunks);
+        free(threads);
+        return -1;
+    }
+    size_t perChunk = (frames->numFrames + numThreads - 1) / numThreads;
+    int k;
+    for (k = 0; k < numThreads; k++)
+    {
+        struct chunk* c = &chunks[k];
+        c->frames = frames;
+        c->batch = batch;
+        c->first = k * perChunk;
+        c->last = c->first + perChunk;
+        if (c->last > frames->numFrames)
+            c->last = frames->numFrames;
+        if (c->first > c->last)
+            c->first = c->last;
+    }
+    runChunks(chunks, threads, numThreads);     // Count
+    
+    size_t total = 0;
+    for (k = 0; k < numThreads; k++)
+    {
+        chunks[k].firstKvp = total;
+        chunks[k].decode = 1;
+        total += chunks[k].numKvps;
+    }
+    batch->numFrames = frames->numFrames;
+    batch->numKvps = total;
+    int result = -1;
+    if ((total <= batch->kvpCapacity) && (total <= UINT32_MAX))
+    {
+        runChunks(chunks, threads, numThreads); // Decode, each chunk into its own part of the output
+        result = 0;
+    }
+    free(chunks);
+    free(threads);
+    return result;
+}
+
+/* @} */
@@ -0,0 +1,110 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file info_decoder.h
+*
+* @brief Batch decoder for captured info messages: decodes many frames at once into one array per
+* field.
+*
+Offline analysis reads millions of AF payloads captured from coordinators. deserializeInfoMessage() 
+decodes one frame into one struct infoMessage; this decodes a batch of frames into one array per field 
+(structure of arrays), which is what analysis wants to scan, and does it faster:
+- Frames are described by offset and length, so any capture format can be decoded in place.
+- KVPs have a fixed stride (INFO_KVP_SIZE bytes) and are decoded in blocks of INFO_DECODER_BLOCK without 
+  a tail loop: a block may read past the end of the frame, into the next frame or the input's padding, 
+  and write past the end of the frame's KVPs, which the next frame overwrites. With SSSE3 a block is 
+  a few shuffles, otherwise a loop the compiler can vectorize.
+- The batch is split into chunks, one per thread: each counts the KVPs in its chunk, then, with the 
+  offsets of every chunk known, decodes its chunk into its own part of the output.
+
+Layout, as assumed by tools/zm_emulator.c: sequence, version, flags, MAC (8, LSB first), device type, 
+number of parameters, then per parameter the OID and a 16-bit value, LSB first. Frames that are too short 
+for their number of parameters are marked INFO_STATUS_TRUNCATED and decoded with no KVPs.
+
+Build: compile with tools/info_decoder.c, -pthread, and preferably -march=native. 
+See tools/info_decoder_bench.c.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef INFO_DECODER_H
+#define INFO_DECODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bytes before the KVPs: sequence, version, flags, MAC, device type, number of parameters */
+#define INFO_HEADER_SIZE                13
+#define INFO_NUM_PARAMETERS_FIELD       12
+#define INFO_KVP_SIZE                   3
+
+/** KVPs decoded at a time */
+#define INFO_DECODER_BLOCK              8
+
+/** Bytes that must be readable after the last frame of a batch */
+#define INFO_DECODER_PADDING            (INFO_DECODER_BLOCK * INFO_KVP_SIZE)
+
+#define INFO_STATUS_OK                  0
+#define INFO_STATUS_TOO_SHORT           1
+#define INFO_STATUS_TRUNCATED           2
+
+/** Frames to decode: frame i is the lengths[i] bytes at data + offsets[i] */
+struct infoFrames
+{
+    const uint8_t* data;
+    const uint32_t* offsets;
+    const uint8_t* lengths;
+    size_t numFrames;
+};
+
+/** Decoded frames, one array per field. KVPs of frame i are firstKvp[i] to firstKvp[i] + numParameters[i] - 1. */
+struct infoBatch
+{
+    size_t numFrames;
+    size_t numKvps;
+    size_t frameCapacity;
+    size_t kvpCapacity;
+    uint8_t* status;
+    uint8_t* sequence;
+    uint8_t* version;
+    uint8_t* flags;
+    uint64_t* mac;
+    uint8_t* deviceType;
+    uint8_t* numParameters;
+    uint32_t* firstKvp;
+    /** Per KVP */
+    uint32_t* kvpFrame;
+    uint8_t* oid;
+    int16_t* value;
+};
+
+int infoBatchInit(struct infoBatch* batch, size_t frameCapacity, size_t kvpCapacity);
+void infoBatchFree(struct infoBatch* batch);
+size_t infoCountKvps(const struct infoFrames* frames, size_t first, size_t last);
+int infoDecodeBatch(const struct infoFrames* frames, struct infoBatch* batch, int numThreads);
+
+#endif
+
+/* @} */
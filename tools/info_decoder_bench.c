@@ -0,0 +1,427 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file info_decoder_bench.c
+*
+* @brief Benchmark of the batch info message decoder against a scalar port of
+* deserializeInfoMessage().
+*
+Decodes the same frames three ways and reports frames and KVPs per second for each:
+- Scalar: a port of deserializeInfoMessage(), one frame at a time into an array of struct infoMessage.
+- infoDecodeBatch() on one thread.
+- infoDecodeBatch() on -t threads.
+The outputs are compared, so this also tests the batch decoder, including frames with bad lengths. 
+Each is run -r times over the whole capture in batches of -b frames, and the best run is reported.
+
+Frames are either synthetic (-n frames, each with 1 to -k KVPs, and one in BAD_FRAME_INTERVAL too short 
+for its number of parameters) or read from a capture (-f), which is a sequence of frames, each a length 
+byte followed by the payload. -w writes the synthetic frames as a capture.
+
+Build and run:
+    gcc -O3 -Wall -march=native -pthread -o info_decoder_bench tools/info_decoder_bench.c tools/info_decoder.c
+    ./info_decoder_bench [-n frames] [-k max KVPs] [-t threads] [-b batch frames] [-r repeats] [-f capture | -w capture]
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "info_decoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Most KVPs in a synthetic frame, and in the scalar port's struct infoMessage */
+#define MAX_PARAMETERS_IN_INFO_MESSAGE  16
+
+/** One synthetic frame in this many claims more KVPs than it holds */
+#define BAD_FRAME_INTERVAL              1000
+
+//
+//  Scalar port of deserializeInfoMessage(), the reference
+//
+
+struct header
+{
+    uint8_t sequence;
+    uint8_t version;
+    uint8_t flags;
+    uint8_t mac[8];
+    uint8_t type;
+};
+
+struct kvp
+{
+    uint8_t oid;
+    int16_t value;
+};
+
+struct infoMessage
+{
+    struct header header;
+    uint8_t numParameters;
+    struct kvp kvps[MAX_PARAMETERS_IN_INFO_MESSAGE];
+};
+
+static void deserializeInfoMessage(const uint8_t* source, struct infoMessage* im)
+{
+    im->header.sequence = *source++;
+    im->header.version = *source++;
+    im->header.flags = *source++;
+    int i;
+    for (i = 0; i < 8; i++)
+        im->header.mac[i] = *source++;
+    im->header.type = *source++;
+    im->numParameters = *source++;
+    for (i = 0; i < im->numParameters; i++)
+    {
+        im->kvps[i].oid = *source++;
+        im->kvps[i].value = *source++;
+        im->kvps[i].value |= (*source++) << 8;
+    }
+}
+
+/** As infoDecodeBatch() checks; the original trusts the frame. @return 1 if the frame can be deserialized */
+static int scalarFrameIsValid(const uint8_t* frame, uint8_t length)
+{
+    return (length >= INFO_HEADER_SIZE) && (frame[INFO_NUM_PARAMETERS_FIELD] <= MAX_PARAMETERS_IN_INFO_MESSAGE) &&
+        (INFO_HEADER_SIZE + frame[INFO_NUM_PARAMETERS_FIELD] * INFO_KVP_SIZE <= length);
+}
+
+//
+//  Frames
+//
+
+static double nowSeconds()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/** Frames stored back to back, each after its length byte, as in a capture file */
+struct capture
+{
+    uint8_t* bytes;
+    size_t size;
+    struct infoFrames frames;
+};
+
+/** Finds the frames in capture->bytes. @return 0 if success */
+static int indexCapture(struct capture* capture)
+{
+    size_t n = 0, i = 0;
+    while (i < capture->size)
+    {
+        i += 1 + capture->bytes[i];
+        n++;
+    }
+    if (i != capture->size)
+    {
+        fprintf(stderr, "Capture truncated\n");
+        return -1;
+    }
+    uint32_t* offsets = malloc(n * sizeof(uint32_t));
+    uint8_t* lengths = malloc(n);
+    if (!offsets || !lengths || (capture->size > UINT32_MAX))
+        return -1;
+    for (i = 0, n = 0; i < capture->size; n++)
+    {
+        lengths[n] = capture->bytes[i];
+        offsets[n] = (uint32_t) (i + 1);
+        i += 1 + lengths[n];
+    }
+    capture->frames.data = capture->bytes;
+    capture->frames.offsets = offsets;
+    capture->frames.lengths = lengths;
+    capture->frames.numFrames = n;
+    return 0;
+}
+
+static int readCapture(struct capture* capture, const char* fileName)
+{
+    FILE* f = fopen(fileName, "rb");
+    if (!f)
+    {
+        perror(fileName);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    capture->size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    capture->bytes = calloc(capture->size + INFO_DECODER_PADDING, 1);
+    if (!capture->bytes || (fread(capture->bytes, 1, capture->size, f) != capture->size))
+    {
+        perror(fileName);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return indexCapture(capture);
+}
+
+static void synthesize(struct capture* capture, size_t numFrames, int maxKvps)
+{
+    capture->size = 0;
+    capture->bytes = malloc(numFrames * (1 + INFO_HEADER_SIZE + maxKvps * INFO_KVP_SIZE) + INFO_DECODER_PADDING);
+    if (!capture->bytes)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    uint64_t rng = 1;
+    size_t i;
+    for (i = 0; i < numFrames; i++)
+    {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint32_t r = (uint32_t) (rng >> 32);
+        int n = 1 + r % maxKvps;
+        uint8_t* f = capture->bytes + capture->size;
+        f[0] = (uint8_t) (INFO_HEADER_SIZE + n * INFO_KVP_SIZE);
+        f++;
+        f[0] = (uint8_t) i;                     // Sequence, version, flags
+        f[1] = 1;
+        f[2] = 0;
+        uint64_t mac = 0x00124B0000000000ULL | (r & 0xFFFF);
+        int j;
+        for (j = 0; j < 8; j++)
+            f[3 + j] = (uint8_t) (mac >> (8 * j));
+        f[11] = (uint8_t) (r >> 16) & 3;        // Device type
+        f[12] = (uint8_t) n;
+        for (j = 0; j < n; j++)
+        {
+            f[INFO_HEADER_SIZE + INFO_KVP_SIZE * j] = (uint8_t) (j + 1);
+            f[INFO_HEADER_SIZE + INFO_KVP_SIZE * j + 1] = (uint8_t) (r >> j);
+            f[INFO_HEADER_SIZE + INFO_KVP_SIZE * j + 2] = (uint8_t) (i >> (j & 7));
+        }
+        if (i % BAD_FRAME_INTERVAL == BAD_FRAME_INTERVAL - 1)
+            f[12] = (uint8_t) (n + 1);          // Claims one KVP more than it has
+        capture->size += 1 + f[-1];
+    }
+    memset(capture->bytes + capture->size, 0, INFO_DECODER_PADDING);
+    indexCapture(capture);
+}
+
+/** Frames first to first + n - 1 of a capture */
+static struct infoFrames slice(const struct infoFrames* all, size_t first, size_t n)
+{
+    struct infoFrames s = *all;
+    s.offsets += first;
+    s.lengths += first;
+    s.numFrames = n;
+    return s;
+}
+
+//
+//  Benchmark
+//
+
+/** @return number of differences between the scalar port's output and a batch */
+static size_t compare(const struct infoFrames* frames, const struct infoMessage* messages, 
+                      const uint8_t* valid, const struct infoBatch* b)
+{
+    size_t errors = 0, i;
+    for (i = 0; i < frames->numFrames; i++)
+    {
+        if (valid[i] != (b->status[i] == INFO_STATUS_OK))
+        {
+            errors++;
+            continue;
+        }
+        if (!valid[i])
+            continue;
+        const struct infoMessage* im = &messages[i];
+        uint64_t mac = 0;
+        int j;
+        for (j = 7; j >= 0; j--)
+            mac = (mac << 8) | im->header.mac[j];
+        if ((b->sequence[i] != im->header.sequence) || (b->version[i] != im->header.version) || 
+            (b->flags[i] != im->header.flags) || (b->mac[i] != mac) || (b->deviceType[i] != im->header.type) || 
+            (b->numParameters[i] != im->numParameters))
+        {
+            errors++;
+            continue;
+        }
+        for (j = 0; j < im->numParameters; j++)
+        {
+            uint32_t k = b->firstKvp[i] + j;
+            if ((b->oid[k] != im->kvps[j].oid) || (b->value[k] != im->kvps[j].value) || (b->kvpFrame[k] != i))
+            {
+                errors++;
+                break;
+            }
+        }
+    }
+    return errors;
+}
+
+static void report(const char* name, double seconds, size_t frames, size_t kvps, double baseline)
+{
+    printf("%-24s %8.1fms %8.1fM frames/s %8.1fM KVPs/s", name, seconds * 1000.0, frames / seconds / 1e6, 
+           kvps / seconds / 1e6);
+    if (baseline > 0.0)
+        printf("  x%.1f", baseline / seconds);
+    putchar('\n');
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-n frames] [-k max KVPs] [-t threads] [-b batch frames] [-r repeats] "
+            "[-f capture | -w capture]\n", name);
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t numFrames = 4000000, batchFrames = 1 << 20;
+    int maxKvps = 8, numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN), repeats = 5;
+    const char* readFile = 0;
+    const char* writeFile = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:t:b:r:f:w:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': numFrames = strtoull(optarg, 0, 0); break;
+        case 'k': maxKvps = atoi(optarg); break;
+        case 't': numThreads = atoi(optarg); break;
+        case 'b': batchFrames = strtoull(optarg, 0, 0); break;
+        case 'r': repeats = atoi(optarg); break;
+        case 'f': readFile = optarg; break;
+        case 'w': writeFile = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((maxKvps < 1) || (maxKvps > MAX_PARAMETERS_IN_INFO_MESSAGE) || (numThreads < 1) || (batchFrames < 1) || 
+        (repeats < 1) || (readFile && writeFile))
+        usage(argv[0]);
+    
+    struct capture capture;
+    if (readFile)
+    {
+        if (readCapture(&capture, readFile) != 0)
+            return 1;
+    } else {
+        synthesize(&capture, numFrames, maxKvps);
+    }
+    if (writeFile)
+    {
+        FILE* f = fopen(writeFile, "wb");
+        if (!f || (fwrite(capture.bytes, 1, capture.size, f) != capture.size) || (fclose(f) != 0))
+        {
+            perror(writeFile);
+            return 1;
+        }
+    }
+    const struct infoFrames* all = &capture.frames;
+    numFrames = all->numFrames;
+    if (batchFrames > numFrames)
+        batchFrames = numFrames ? numFrames : 1;
+    size_t numKvps = infoCountKvps(all, 0, numFrames);
+    printf("%zu frames, %zu KVPs, %.1f MB, batches of %zu frames\n", numFrames, numKvps, capture.size / 1e6, 
+           batchFrames);
+    
+    // Output for one batch; the largest number of KVPs in any batch
+    size_t maxBatchKvps = 0, first;
+    for (first = 0; first < numFrames; first += batchFrames)
+    {
+        size_t n = (numFrames - first < batchFrames) ? (numFrames - first) : batchFrames;
+        size_t k = infoCountKvps(all, first, first + n);
+        if (k > maxBatchKvps)
+            maxBatchKvps = k;
+    }
+    struct infoMessage* messages = malloc(batchFrames * sizeof(struct infoMessage));
+    uint8_t* valid = malloc(batchFrames);
+    struct infoBatch batch;
+    if (!messages || !valid || (infoBatchInit(&batch, batchFrames, maxBatchKvps) != 0))
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    double scalar = 1e300, one = 1e300, many = 1e300;
+    size_t errors = 0;
+    volatile uint8_t sink = 0;
+    int r;
+    for (r = 0; r < repeats; r++)
+    {
+        double t = 0.0, t1 = 0.0, tn = 0.0;
+        for (first = 0; first < numFrames; first += batchFrames)
+        {
+            size_t n = (numFrames - first < batchFrames) ? (numFrames - first) : batchFrames;
+            struct infoFrames frames = slice(all, first, n);
+            
+            double start = nowSeconds();
+            size_t i;
+            for (i = 0; i < n; i++)
+            {
+                const uint8_t* f = frames.data + frames.offsets[i];
+                valid[i] = (uint8_t) scalarFrameIsValid(f, frames.lengths[i]);
+                if (valid[i])
+                    deserializeInfoMessage(f, &messages[i]);
+            }
+            t += nowSeconds() - start;
+            sink += messages[n - 1].numParameters;
+            
+            start = nowSeconds();
+            infoDecodeBatch(&frames, &batch, 1);
+            t1 += nowSeconds() - start;
+            if (r == 0)
+                errors += compare(&frames, messages, valid, &batch);
+            
+            if (numThreads > 1)
+            {
+                start = nowSeconds();
+                infoDecodeBatch(&frames, &batch, numThreads);
+                tn += nowSeconds() - start;
+                if (r == 0)
+                    errors += compare(&frames, messages, valid, &batch);
+            }
+        }
+        scalar = (t < scalar) ? t : scalar;
+        one = (t1 < one) ? t1 : one;
+        many = (tn < many) ? tn : many;
+    }
+    
+    report("scalar", scalar, numFrames, numKvps, 0.0);
+    report("batch, 1 thread", one, numFrames, numKvps, scalar);
+    if (numThreads > 1)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "batch, %d threads", numThreads);
+        report(name, many, numFrames, numKvps, scalar);
+    }
+#ifndef __SSSE3__
+    printf("Built without SSSE3: KVP blocks decoded by the portable loop\n");
+#endif
+    if (errors)
+        printf("%zu frames decoded differently by the scalar port and the batch decoder\n", errors);
+    else
+        printf("Outputs match\n");
+    infoBatchFree(&batch);
+    return errors ? 1 : 0;
+}
+
+/* @} */
@@ -0,0 +1,919 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file location_fusion.c
+*
+* @brief Host-side location engine that fuses the link quality reported by many coordinators into a
+* position and zone per item.
+*
+Each coordinator only knows how well it hears each item. This engine takes the observations of all of 
+them, i.e. the "From:<MAC>, LQI=<lqi>, T=<ms>" lines that parseMessages() prints, and keeps per item:
+- Per coordinator, the LQI filtered with an exponential moving average (-a), and when it was last 
+  heard. Links not heard for the stale time (-s) are left out.
+- A position: the centroid of the coordinators' positions, weighted by 1/d^2 where d is the distance 
+  estimated from the filtered LQI with the same log-distance model as tools/tracking_sim.c (-e).
+- A zone: the zone whose coordinators have the greatest total weight. The zone only changes once 
+  another has been ahead by ZONE_HYSTERESIS for the dwell time (-d), so that fading doesn't make items 
+  flap between neighboring zones. Zone changes are printed as they happen.
+Each observation updates only its item, in time proportional to the number of coordinators, so the 
+estimates are always current without ever recomputing everything.
+
+Items are sharded by MAC over a pool of worker threads (-w), each owning its items, so updates need no 
+locks. Observations are passed to the workers through bounded queues, in batches.
+
+Coordinators are described in a CSV file (-m), one per line: name,x,y,zone (x and y in meters). Each 
+coordinator's log is given as name=file:
+- Replay (default): the logs are merged in timestamp order. T is the coordinator's halMillis() at 
+  reception, which starts at 0 when it boots; logs are assumed to start together, unless an offset 
+  is given as name=file@ms. Wrapping and restarts of T are handled.
+- Live (-l): each log (e.g. a serial port or a pipe from one) is read as it is written, and 
+  observations are timestamped with the host's clock. Ctrl-C stops.
+At the end the position and zone of every item is printed, sorted by MAC, with throughput statistics.
+
+Synthetic load (-g items,seconds): instead of logs, items wander around the coordinators and are heard 
+by those in range once a second, with LQI from the path loss, shadowing and fading models. Reports 
+throughput, and how often the zone estimate matched the zone of the nearest coordinator.
+
+Build and run:
+    gcc -O2 -Wall -pthread -o location_fusion tools/location_fusion.c -lm
+    ./location_fusion -m coordinators.csv [-w workers] [-a alpha] [-s stale ms] [-d dwell ms] [-e exponent] 
+                      [-q] [-l] name=log[@offset ms] ...
+    ./location_fusion -m coordinators.csv -g 10000,600 -q
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define MAX_COORDINATORS                64
+#define MAX_ZONES                       64
+#define NAME_LENGTH                     32
+#define NO_ZONE                         0xFFFF
+
+/** Radio model, as in tracking_sim.c */
+#define TX_POWER_DBM                    4.0
+#define PL_1M_DB                        40.0
+#define RX_SENSITIVITY_DBM              (-97.0)
+#define RX_SATURATION_DBM               10.0
+#define SHADOWING_SIGMA_DB              4.0
+#define SHADOWING_CORRELATION           0.9
+
+/** Fraction by which another zone's weight must exceed the current zone's to replace it */
+#define ZONE_HYSTERESIS                 0.25
+
+/** Observations per queue, and per batch passed to a worker */
+#define QUEUE_SIZE                      8192
+#define BATCH_SIZE                      256
+
+/** A backward jump in a coordinator's T larger than this, and not a wrap, is a restart */
+#define RESTART_JUMP_MS                 60000
+
+struct coordinator
+{
+    char name[NAME_LENGTH];
+    double x;
+    double y;
+    uint16_t zone;
+};
+
+struct parameters
+{
+    int workers;
+    double alpha;
+    int64_t staleMs;
+    int64_t dwellMs;
+    double pathLossExponent;
+    int quiet;
+    int live;
+};
+
+struct observation
+{
+    uint64_t mac;
+    /** Milliseconds, on the engine's time line */
+    int64_t timeMs;
+    uint16_t coordinator;
+    uint8_t lqi;
+};
+
+struct link
+{
+    float lqi;
+    /** When last heard, valid if lqi != 0 */
+    int64_t lastMs;
+};
+
+struct item
+{
+    uint64_t mac;
+    struct item* next;
+    uint32_t observations;
+    uint32_t zoneChanges;
+    uint16_t zone;
+    uint16_t candidateZone;
+    int64_t candidateSince;
+    int64_t lastMs;
+    float x;
+    float y;
+    uint8_t heard;
+    /** One per coordinator */
+    struct link links[];
+};
+
+struct queue
+{
+    struct observation ring[QUEUE_SIZE];
+    int head;
+    int count;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+};
+
+struct worker
+{
+    pthread_t thread;
+    struct queue queue;
+    struct item** buckets;
+    size_t numBuckets;
+    size_t numItems;
+    uint64_t processed;
+    /** Synthetic load: zone estimate compared with the true zone */
+    uint64_t zoneChecks;
+    uint64_t zoneMatches;
+    /** Filled in by the dispatcher, flushed to queue when full */
+    struct observation batch[BATCH_SIZE];
+    int batchCount;
+};
+
+static struct coordinator coordinators[MAX_COORDINATORS];
+static int numCoordinators = 0;
+static char zoneNames[MAX_ZONES][NAME_LENGTH];
+static int numZones = 0;
+static struct parameters p = {4, 0.25, 30000, 3000, 2.0, 0, 0};
+static struct worker* workers;
+static pthread_mutex_t outputLock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t stop = 0;
+/** Host time at which live mode started, its time line's origin */
+static int64_t liveStart;
+
+/** For the synthetic load: true zone of each item, indexed by MAC */
+static uint16_t* trueZones = 0;
+
+static int64_t hostMillis()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t) t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/** @return index of the zone called name, added if new */
+static int findZone(const char* name)
+{
+    int i;
+    for (i = 0; i < numZones; i++)
+        if (strcmp(zoneNames[i], name) == 0)
+            return i;
+    if (numZones == MAX_ZONES)
+        return -1;
+    snprintf(zoneNames[numZones], NAME_LENGTH, "%s", name);
+    return numZones++;
+}
+
+static int findCoordinator(const char* name)
+{
+    int i;
+    for (i = 0; i < numCoordinators; i++)
+        if (strcmp(coordinators[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+/** Reads the coordinators file. @return 0 if success */
+static int readCoordinators(const char* fileName)
+{
+    FILE* f = fopen(fileName, "r");
+    if (!f)
+    {
+        perror(fileName);
+        return -1;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        char name[NAME_LENGTH], zone[NAME_LENGTH];
+        double x, y;
+        if ((line[0] == '#') || (sscanf(line, " %31[^,],%lf,%lf,%31[^,\r\n]", name, &x, &y, zone) != 4))
+            continue;                           // Comment, header or blank
+        int z = findZone(zone);
+        if ((numCoordinators == MAX_COORDINATORS) || (z < 0) || (findCoordinator(name) >= 0))
+        {
+            fprintf(stderr, "%s: too many coordinators or zones, or %s repeated\n", fileName, name);
+            fclose(f);
+            return -1;
+        }
+        struct coordinator* c = &coordinators[numCoordinators++];
+        snprintf(c->name, NAME_LENGTH, "%s", name);
+        c->x = x;
+        c->y = y;
+        c->zone = (uint16_t) z;
+    }
+    fclose(f);
+    if (numCoordinators == 0)
+    {
+        fprintf(stderr, "%s: no coordinators\n", fileName);
+        return -1;
+    }
+    return 0;
+}
+
+//
+//  Estimation, run by the workers
+//
+
+/** @return weight of a link: 1/d^2 for the distance estimated from its filtered LQI */
+static double linkWeight(double lqi)
+{
+    double rssi = RX_SENSITIVITY_DBM + lqi * (RX_SATURATION_DBM - RX_SENSITIVITY_DBM) / 255.0;
+    double d = pow(10.0, (TX_POWER_DBM - PL_1M_DB - rssi) / (10.0 * p.pathLossExponent));
+    if (d < 1.0)
+        d = 1.0;
+    return 1.0 / (d * d);
+}
+
+static struct item* findItem(struct worker* w, uint64_t mac)
+{
+    size_t b = mix(mac) & (w->numBuckets - 1);
+    struct item* i;
+    for (i = w->buckets[b]; i; i = i->next)
+        if (i->mac == mac)
+            return i;
+    
+    if (w->numItems >= 2 * w->numBuckets)   // Grow, keeping chains short
+    {
+        size_t n = w->numBuckets * 4;
+        struct item** buckets = calloc(n, sizeof(struct item*));
+        if (buckets)
+        {
+            size_t k;
+            for (k = 0; k < w->numBuckets; k++)
+            {
+                while (w->buckets[k])
+                {
+                    struct item* moved = w->buckets[k];
+                    w->buckets[k] = moved->next;
+                    size_t nb = mix(moved->mac) & (n - 1);
+                    moved->next = buckets[nb];
+                    buckets[nb] = moved;
+                }
+            }
+            free(w->buckets);
+            w->buckets = buckets;
+            w->numBuckets = n;
+            b = mix(mac) & (n - 1);
+        }
+    }
+    i = calloc(1, sizeof(struct item) + numCoordinators * sizeof(struct link));
+    if (!i)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    i->mac = mac;
+    i->zone = NO_ZONE;
+    i->candidateZone = NO_ZONE;
+    i->next = w->buckets[b];
+    w->buckets[b] = i;
+    w->numItems++;
+    return i;
+}
+
+static void printZoneChange(const struct item* i, uint16_t from, int64_t timeMs)
+{
+    if (p.quiet)
+        return;
+    pthread_mutex_lock(&outputLock);
+    printf("%lld.%03lld %016llX %s -> %s (%.1f, %.1f)\n", (long long) (timeMs / 1000), (long long) (timeMs % 1000),
+           (unsigned long long) i->mac, (from == NO_ZONE) ? "-" : zoneNames[from], zoneNames[i->zone], i->x, i->y);
+    if (p.live)
+        fflush(stdout);
+    pthread_mutex_unlock(&outputLock);
+}
+
+/** Updates an item's estimates from its links */
+static void estimate(struct item* i, int64_t now)
+{
+    double zoneWeights[MAX_ZONES] = {0};
+    double sumWeight = 0.0, sumX = 0.0, sumY = 0.0;
+    int c;
+    uint8_t heard = 0;
+    for (c = 0; c < numCoordinators; c++)
+    {
+        const struct link* l = &i->links[c];
+        if ((l->lqi == 0.0f) || ((now - l->lastMs) > p.staleMs))
+            continue;
+        double w = linkWeight(l->lqi);
+        sumWeight += w;
+        sumX += w * coordinators[c].x;
+        sumY += w * coordinators[c].y;
+        zoneWeights[coordinators[c].zone] += w;
+        heard++;
+    }
+    i->heard = heard;
+    if (heard == 0)
+        return;                             // Keep the last estimate
+    i->x = (float) (sumX / sumWeight);
+    i->y = (float) (sumY / sumWeight);
+    
+    uint16_t best = 0;
+    int z;
+    for (z = 1; z < numZones; z++)
+        if (zoneWeights[z] > zoneWeights[best])
+            best = (uint16_t) z;
+    if ((i->zone == NO_ZONE) || (best == i->zone))
+    {
+        if (i->zone == NO_ZONE)
+        {
+            i->zone = best;
+            printZoneChange(i, NO_ZONE, now);
+        }
+        i->candidateZone = NO_ZONE;
+        return;
+    }
+    if (zoneWeights[best] <= zoneWeights[i->zone] * (1.0 + ZONE_HYSTERESIS))
+    {
+        i->candidateZone = NO_ZONE;         // Not clearly ahead
+        return;
+    }
+    if (i->candidateZone != best)
+    {
+        i->candidateZone = best;
+        i->candidateSince = now;
+    }
+    if ((now - i->candidateSince) >= p.dwellMs)
+    {
+        uint16_t from = i->zone;
+        i->zone = best;
+        i->candidateZone = NO_ZONE;
+        i->zoneChanges++;
+        printZoneChange(i, from, now);
+    }
+}
+
+static void update(struct worker* w, const struct observation* o)
+{
+    struct item* i = findItem(w, o->mac);
+    struct link* l = &i->links[o->coordinator];
+    if ((l->lqi == 0.0f) || ((o->timeMs - l->lastMs) > p.staleMs))
+        l->lqi = o->lqi;                    // New or stale: start the filter afresh
+    else
+        l->lqi += (float) (p.alpha * (o->lqi - l->lqi));
+    l->lastMs = o->timeMs;
+    i->lastMs = o->timeMs;
+    i->observations++;
+    w->processed++;
+    estimate(i, o->timeMs);
+    if (trueZones)
+    {
+        w->zoneChecks++;
+        if (i->zone == trueZones[o->mac])
+            w->zoneMatches++;
+    }
+}
+
+static void* runWorker(void* arg)
+{
+    struct worker* w = arg;
+    struct observation batch[BATCH_SIZE];
+    while (1)
+    {
+        pthread_mutex_lock(&w->queue.lock);
+        while ((w->queue.count == 0) && !w->queue.closed)
+            pthread_cond_wait(&w->queue.notEmpty, &w->queue.lock);
+        int n = 0;
+        while ((n < BATCH_SIZE) && (w->queue.count > 0))
+        {
+            batch[n++] = w->queue.ring[w->queue.head];
+            w->queue.head = (w->queue.head + 1) % QUEUE_SIZE;
+            w->queue.count--;
+        }
+        int done = (n == 0) && w->queue.closed;
+        pthread_cond_signal(&w->queue.notFull);
+        pthread_mutex_unlock(&w->queue.lock);
+        if (done)
+            break;
+        int k;
+        for (k = 0; k < n; k++)
+            update(w, &batch[k]);
+    }
+    return 0;
+}
+
+//
+//  Dispatch
+//
+
+static void queuePush(struct queue* q, const struct observation* o, int n)
+{
+    pthread_mutex_lock(&q->lock);
+    while (n > 0)
+    {
+        while (q->count == QUEUE_SIZE)
+            pthread_cond_wait(&q->notFull, &q->lock);
+        while ((n > 0) && (q->count < QUEUE_SIZE))
+        {
+            q->ring[(q->head + q->count) % QUEUE_SIZE] = *o++;
+            q->count++;
+            n--;
+        }
+        pthread_cond_signal(&q->notEmpty);
+    }
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void flushBatch(struct worker* w)
+{
+    if (w->batchCount > 0)
+        queuePush(&w->queue, w->batch, w->batchCount);
+    w->batchCount = 0;
+}
+
+/** Passes an observation to the worker that owns its item. Batched; see flushBatches(). */
+static void dispatch(const struct observation* o)
+{
+    struct worker* w = &workers[mix(o->mac) % p.workers];
+    w->batch[w->batchCount++] = *o;
+    if (w->batchCount == BATCH_SIZE)
+        flushBatch(w);
+}
+
+static void flushBatches()
+{
+    int k;
+    for (k = 0; k < p.workers; k++)
+        flushBatch(&workers[k]);
+}
+
+/** Passes an observation straight to its worker, from any thread */
+static void dispatchNow(const struct observation* o)
+{
+    queuePush(&workers[mix(o->mac) % p.workers].queue, o, 1);
+}
+
+//
+//  Coordinator logs
+//
+
+struct source
+{
+    FILE* f;
+    const char* fileName;
+    uint16_t coordinator;
+    /** Added to T to put it on the engine's time line */
+    int64_t offset;
+    int64_t lastTime;
+    int started;
+    uint64_t lines;
+    uint64_t observations;
+    /** Next observation, for the merge */
+    struct observation next;
+    int hasNext;
+    pthread_t thread;
+};
+
+/**
+Parses a parseMessages() line. 
+@return 1 if it was an observation, with mac, lqi and t (the coordinator's halMillis()) filled in
+*/
+static int parseLine(const char* line, uint64_t* mac, uint8_t* lqi, uint32_t* t)
+{
+    const char* from = strstr(line, "From:");
+    unsigned long long m;
+    unsigned l;
+    unsigned long ms;
+    if (!from || (sscanf(from, "From:%16llx, LQI=%2x, T=%lu", &m, &l, &ms) != 3) || (l == 0))
+        return 0;
+    *mac = m;
+    *lqi = (uint8_t) l;
+    *t = (uint32_t) ms;
+    return 1;
+}
+
+/** Reads the source's next observation into next, for replay. @return 1 if there was one */
+static int readNext(struct source* s)
+{
+    char line[512];
+    while (fgets(line, sizeof(line), s->f))
+    {
+        uint64_t mac;
+        uint8_t lqi;
+        uint32_t t;
+        s->lines++;
+        if (!parseLine(line, &mac, &lqi, &t))
+            continue;
+        int64_t time = s->offset + t;
+        if (!s->started)
+        {
+            s->started = 1;
+            s->offset -= t;                 // First observation at the given offset
+            time = s->offset + t;
+        } 
+        else if (time < s->lastTime)
+        {
+            if (s->lastTime - time > 0x80000000LL)
+                s->offset += 0x100000000LL; // T wrapped after 49.7 days
+            else if (s->lastTime - time > RESTART_JUMP_MS)
+                s->offset = s->lastTime - t;    // Coordinator restarted: carry on from where it was
+            time = s->offset + t;
+            if (time < s->lastTime)
+                time = s->lastTime;         // Small reordering, e.g. batched messages
+        }
+        s->lastTime = time;
+        s->next.mac = mac;
+        s->next.lqi = lqi;
+        s->next.coordinator = s->coordinator;
+        s->next.timeMs = time;
+        s->observations++;
+        return 1;
+    }
+    return 0;
+}
+
+/** Merges the logs in timestamp order */
+static void replay(struct source* sources, int numSources)
+{
+    int k;
+    for (k = 0; k < numSources; k++)
+        sources[k].hasNext = readNext(&sources[k]);
+    while (!stop)
+    {
+        int earliest = -1;
+        for (k = 0; k < numSources; k++)
+            if (sources[k].hasNext && ((earliest < 0) || (sources[k].next.timeMs < sources[earliest].next.timeMs)))
+                earliest = k;
+        if (earliest < 0)
+            break;
+        dispatch(&sources[earliest].next);
+        sources[earliest].hasNext = readNext(&sources[earliest]);
+    }
+    flushBatches();
+}
+
+/** Reads one log as it is written, timestamping with the host's clock */
+static void* followSource(void* arg)
+{
+    struct source* s = arg;
+    char line[512];
+    while (!stop && fgets(line, sizeof(line), s->f))
+    {
+        struct observation o;
+        uint32_t t;
+        s->lines++;
+        if (!parseLine(line, &o.mac, &o.lqi, &t))
+            continue;
+        o.coordinator = s->coordinator;
+        o.timeMs = hostMillis() - liveStart;
+        s->observations++;
+        dispatchNow(&o);
+    }
+    return 0;
+}
+
+//
+//  Synthetic load
+//
+
+static double uniform(uint64_t* rng)
+{
+    *rng = *rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    return ((*rng >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double gaussian(uint64_t* rng)
+{
+    return sqrt(-2.0 * log(uniform(rng))) * cos(2.0 * M_PI * uniform(rng));
+}
+
+struct syntheticItem
+{
+    double x, y;
+    double targetX, targetY;
+    double shadowing[MAX_COORDINATORS];
+};
+
+/** Items wander between random points in the coordinators' bounding box, 1m/s */
+static void synthesize(int numItems, int seconds, uint64_t seed)
+{
+    double minX = coordinators[0].x, maxX = minX, minY = coordinators[0].y, maxY = minY;
+    int c;
+    for (c = 1; c < numCoordinators; c++)
+    {
+        minX = fmin(minX, coordinators[c].x);
+        maxX = fmax(maxX, coordinators[c].x);
+        minY = fmin(minY, coordinators[c].y);
+        maxY = fmax(maxY, coordinators[c].y);
+    }
+    struct syntheticItem* items = calloc(numItems, sizeof(struct syntheticItem));
+    trueZones = calloc(numItems, sizeof(uint16_t));
+    if (!items || !trueZones)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    uint64_t rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+    int i;
+    for (i = 0; i < numItems; i++)
+    {
+        items[i].x = items[i].targetX = minX + uniform(&rng) * (maxX - minX);
+        items[i].y = items[i].targetY = minY + uniform(&rng) * (maxY - minY);
+    }
+    int s;
+    for (s = 0; (s < seconds) && !stop; s++)
+    {
+        for (i = 0; i < numItems; i++)
+        {
+            struct syntheticItem* it = &items[i];
+            double dx = it->targetX - it->x, dy = it->targetY - it->y;
+            double d = sqrt(dx * dx + dy * dy);
+            if (d < 1.0)
+            {
+                it->targetX = minX + uniform(&rng) * (maxX - minX);
+                it->targetY = minY + uniform(&rng) * (maxY - minY);
+            } else {
+                it->x += dx / d;
+                it->y += dy / d;
+            }
+            double nearest = 1e300;
+            uint16_t zone = 0;
+            for (c = 0; c < numCoordinators; c++)
+            {
+                dx = coordinators[c].x - it->x;
+                dy = coordinators[c].y - it->y;
+                d = sqrt(dx * dx + dy * dy);
+                if (d < nearest)
+                {
+                    nearest = d;
+                    zone = coordinators[c].zone;
+                }
+                it->shadowing[c] = SHADOWING_CORRELATION * it->shadowing[c] + 
+                    sqrt(1.0 - SHADOWING_CORRELATION * SHADOWING_CORRELATION) * SHADOWING_SIGMA_DB * gaussian(&rng);
+                double u = uniform(&rng);
+                double rssi = TX_POWER_DBM - PL_1M_DB - 10.0 * p.pathLossExponent * log10(fmax(d, 1.0)) + 
+                    it->shadowing[c] + 10.0 * log10(-log(u));
+                double lqi = (rssi - RX_SENSITIVITY_DBM) * 255.0 / (RX_SATURATION_DBM - RX_SENSITIVITY_DBM);
+                if (lqi < 1.0)
+                    continue;                   // Not heard
+                struct observation o = {(uint64_t) i, (int64_t) s * 1000 + (i % 1000), (uint16_t) c, 
+                                        (uint8_t) fmin(lqi, 255.0)};
+                dispatch(&o);
+            }
+            trueZones[i] = zone;                // Read by workers only after this second's observations
+        }
+    }
+    flushBatches();
+    free(items);
+}
+
+//
+//  Results
+//
+
+static int compareItems(const void* a, const void* b)
+{
+    uint64_t x = (*(struct item* const*) a)->mac, y = (*(struct item* const*) b)->mac;
+    return (x > y) - (x < y);
+}
+
+static void printItems()
+{
+    size_t total = 0, n = 0;
+    int k;
+    for (k = 0; k < p.workers; k++)
+        total += workers[k].numItems;
+    struct item** all = malloc((total ? total : 1) * sizeof(struct item*));
+    if (!all)
+        return;
+    for (k = 0; k < p.workers; k++)
+    {
+        size_t b;
+        for (b = 0; b < workers[k].numBuckets; b++)
+        {
+            struct item* i;
+            for (i = workers[k].buckets[b]; i; i = i->next)
+                all[n++] = i;
+        }
+    }
+    qsort(all, n, sizeof(struct item*), compareItems);
+    printf("%-16s  %-12s %8s %8s  %5s %10s %7s\n", "MAC", "Zone", "X", "Y", "Heard", "Obs", "Changes");
+    size_t j;
+    for (j = 0; j < n; j++)
+        printf("%016llX  %-12s %8.1f %8.1f  %5u %10u %7u\n", (unsigned long long) all[j]->mac, 
+               (all[j]->zone == NO_ZONE) ? "-" : zoneNames[all[j]->zone], all[j]->x, all[j]->y, 
+               all[j]->heard, all[j]->observations, all[j]->zoneChanges);
+    free(all);
+}
+
+static void handleSignal(int sig)
+{
+    (void) sig;
+    stop = 1;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s -m coordinators.csv [-w workers] [-a alpha] [-s stale ms] [-d dwell ms] "
+            "[-e exponent] [-q] [-l] name=log[@offset ms] ...\n"
+            "       %s -m coordinators.csv -g items,seconds [-r seed] [options]\n", name, name);
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* coordinatorsFile = 0;
+    int syntheticItems = 0, syntheticSeconds = 0;
+    uint64_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:w:a:s:d:e:qlg:r:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm': coordinatorsFile = optarg; break;
+        case 'w': p.workers = atoi(optarg); break;
+        case 'a': p.alpha = atof(optarg); break;
+        case 's': p.staleMs = atoll(optarg); break;
+        case 'd': p.dwellMs = atoll(optarg); break;
+        case 'e': p.pathLossExponent = atof(optarg); break;
+        case 'q': p.quiet = 1; break;
+        case 'l': p.live = 1; break;
+        case 'g':
+            if (sscanf(optarg, "%d,%d", &syntheticItems, &syntheticSeconds) != 2)
+                usage(argv[0]);
+            break;
+        case 'r': seed = strtoull(optarg, 0, 0); break;
+        default: usage(argv[0]);
+        }
+    }
+    int numSources = argc - optind;
+    if (!coordinatorsFile || (p.workers < 1) || (p.alpha <= 0.0) || (p.alpha > 1.0) || 
+        (syntheticItems ? ((numSources != 0) || (syntheticSeconds < 1) || p.live) : (numSources == 0)))
+        usage(argv[0]);
+    if (readCoordinators(coordinatorsFile) != 0)
+        return 1;
+    
+    struct source* sources = calloc(numSources ? numSources : 1, sizeof(struct source));
+    int k;
+    for (k = 0; k < numSources; k++)
+    {
+        char* arg = argv[optind + k];
+        char* equals = strchr(arg, '=');
+        if (!equals)
+            usage(argv[0]);
+        *equals = '\0';
+        char* at = strchr(equals + 1, '@');
+        if (at)
+        {
+            *at = '\0';
+            sources[k].offset = atoll(at + 1);
+        }
+        int c = findCoordinator(arg);
+        if (c < 0)
+        {
+            fprintf(stderr, "%s: not in %s\n", arg, coordinatorsFile);
+            return 1;
+        }
+        sources[k].coordinator = (uint16_t) c;
+        sources[k].fileName = equals + 1;
+        sources[k].f = (strcmp(equals + 1, "-") == 0) ? stdin : fopen(equals + 1, "r");
+        if (!sources[k].f)
+        {
+            perror(equals + 1);
+            return 1;
+        }
+    }
+    
+    workers = calloc(p.workers, sizeof(struct worker));
+    if (!workers)
+        return 1;
+    for (k = 0; k < p.workers; k++)
+    {
+        struct worker* w = &workers[k];
+        w->numBuckets = 1024;
+        w->buckets = calloc(w->numBuckets, sizeof(struct item*));
+        pthread_mutex_init(&w->queue.lock, 0);
+        pthread_cond_init(&w->queue.notEmpty, 0);
+        pthread_cond_init(&w->queue.notFull, 0);
+        if (!w->buckets || (pthread_create(&w->thread, 0, runWorker, w) != 0))
+        {
+            fprintf(stderr, "Can't start worker\n");
+            return 1;
+        }
+    }
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handleSignal;
+    sigaction(SIGINT, &sa, 0);
+    sigaction(SIGTERM, &sa, 0);
+    
+    int64_t start = hostMillis();
+    if (syntheticItems)
+    {
+        synthesize(syntheticItems, syntheticSeconds, seed);
+    }
+    else if (p.live)
+    {
+        liveStart = start;
+        for (k = 0; k < numSources; k++)
+            pthread_create(&sources[k].thread, 0, followSource, &sources[k]);
+        while (!stop)
+        {
+            int running = 0;
+            for (k = 0; k < numSources; k++)
+                running |= !feof(sources[k].f);
+            if (!running)
+                break;
+            usleep(100000);
+        }
+        for (k = 0; k < numSources; k++)
+        {
+            pthread_cancel(sources[k].thread);  // May be blocked reading
+            pthread_join(sources[k].thread, 0);
+        }
+    } else {
+        replay(sources, numSources);
+    }
+    
+    for (k = 0; k < p.workers; k++)
+    {
+        pthread_mutex_lock(&workers[k].queue.lock);
+        workers[k].queue.closed = 1;
+        pthread_cond_signal(&workers[k].queue.notEmpty);
+        pthread_mutex_unlock(&workers[k].queue.lock);
+    }
+    uint64_t processed = 0, checks = 0, matches = 0;
+    size_t items = 0;
+    for (k = 0; k < p.workers; k++)
+    {
+        pthread_join(workers[k].thread, 0);
+        processed += workers[k].processed;
+        items += workers[k].numItems;
+        checks += workers[k].zoneChecks;
+        matches += workers[k].zoneMatches;
+    }
+    int64_t elapsed = hostMillis() - start;
+    
+    if (!p.quiet)
+        printItems();
+    for (k = 0; k < numSources; k++)
+        fprintf(stderr, "%s (%s): %llu lines, %llu observations\n", coordinators[sources[k].coordinator].name, 
+                sources[k].fileName, (unsigned long long) sources[k].lines, (unsigned long long) sources[k].observations);
+    fprintf(stderr, "%llu observations of %zu items from %d coordinators in %lldms, %.0f per second, %d workers\n",
+            (unsigned long long) processed, items, numCoordinators, (long long) elapsed, 
+            elapsed ? processed * 1000.0 / elapsed : 0.0, p.workers);
+    if (checks)
+        fprintf(stderr, "Zone matched the nearest coordinator's %.1f%% of the time\n", 100.0 * matches / checks);
+    return 0;
+}
+
+/* @} */
@@ -0,0 +1,923 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file lqi_store.c
+*
+* @brief Host-side store for coordinator logs in append-only, memory-mapped columnar segments indexed
+* by device, with an importer for the console output.
+*
+Grepping months of console logs for one device's history means reading all of them. This keeps the 
+same information in columns, so that a query only touches the rows of the device asked for.
+
+Rows. One per line of interest in a coordinator's console output:
+- "From:<MAC>, LQI=<lqi>, T=<ms>, <n> KVPs received:" from parseMessages(), with the KVP lines that 
+  follow it ("    NAME (0x<oid>) = <value> ..."). Average and state are not known.
+- "DEVICE <index> <MAC> <state> AVG=<avg> LQI=<lqi> T=<ms>" from reportChanges() and reportSnapshot(), 
+  i.e. the decisions of trackingStateMachine(). No KVPs.
+Each row has: time (ms), coordinator, device, LQI, average, track_state, and its KVPs.
+
+Layout. A store is a directory:
+- catalog.lqs: names of the coordinators and MACs of the devices; rows refer to them by index.
+- segment-NNNNNN.lqs: SEGMENT_ROWS rows, one column after the other at fixed offsets, then the KVPs 
+  as two more columns (OID and value) referred to by each row's first KVP and count. Files are created 
+  at full size, sparse, and memory-mapped; rows are appended and then made visible by updating the 
+  count in the header, so a reader never sees a partly written row.
+- When a segment is full it is sealed: its time range is recorded and a per-device index is appended, 
+  listing each device's rows. A scan skips segments outside the time range or without the device, 
+  and reads only the device's rows of the others. The last, unsealed segment is scanned whole.
+Only one importer may run at a time (it takes a lock); any number of scans can run alongside it.
+
+Time. T is halMillis() of the coordinator, which starts at 0 when it boots. The importer adds a base 
+(-b, e.g. the epoch ms at which the coordinator was started), and handles wrapping and restarts of T as 
+tools/location_fusion.c does. DEVICE records carry the time of the device's last message, which may be 
+older than the line, so they don't move the importer's idea of the clock.
+
+Build and run:
+    gcc -O2 -Wall -o lqi_store tools/lqi_store.c
+    ./lqi_store -d store import -c name [-b base ms] log ...     (- for stdin)
+    ./lqi_store -d store scan -m MAC [-f from ms] [-t to ms] [-n]
+    ./lqi_store -d store devices
+    ./lqi_store -d store stats
+A scan prints one row per line, or with -n only the count, and how long it took on stderr.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CATALOG_MAGIC                   0x3143514C      // "LQC1"
+#define SEGMENT_MAGIC                   0x3153514C      // "LQS1"
+#define MAX_COORDINATORS                1024
+#define MAX_DEVICES                     (1UL << 20)
+#define NAME_LENGTH                     32
+
+/** Rows, and KVPs, per segment */
+#define SEGMENT_ROWS                    (1UL << 20)
+#define SEGMENT_KVPS                    (4 * SEGMENT_ROWS)
+#define MAX_KVPS_PER_ROW                255
+
+/** Value of the state and average columns when not known, i.e. in message rows */
+#define STATE_NONE                      0xFF
+
+/** A backward jump in a coordinator's T larger than this, and not a wrap, is a restart */
+#define RESTART_JUMP_MS                 60000
+
+/** As in tracking.h */
+static const char* stateNames[] = {"CONNECTED", "SUSPECTED", "LOST", "SILENCED"};
+#define NUM_STATES                      (sizeof(stateNames) / sizeof(stateNames[0]))
+
+struct catalog
+{
+    uint32_t magic;
+    uint32_t numCoordinators;
+    uint32_t numDevices;
+    uint32_t reserved;
+    char coordinators[MAX_COORDINATORS][NAME_LENGTH];
+    uint64_t macs[MAX_DEVICES];
+};
+
+struct segmentHeader
+{
+    uint32_t magic;
+    uint32_t sealed;
+    /** Rows and KVPs written. Updated last, so everything below the counts is complete. */
+    uint32_t rows;
+    uint32_t kvps;
+    int64_t minTime;
+    int64_t maxTime;
+    /** Of the index, once sealed */
+    uint64_t indexOffset;
+    uint32_t indexDevices;
+    uint32_t reserved;
+};
+
+/** Index of a sealed segment: entries sorted by device, then the rows they point into */
+struct indexEntry
+{
+    uint32_t device;
+    uint32_t first;
+    uint32_t count;
+};
+
+/** Columns, at fixed offsets */
+#define HEADER_SIZE                     4096
+#define TIME_OFFSET                     HEADER_SIZE
+#define DEVICE_OFFSET                   (TIME_OFFSET + 8 * SEGMENT_ROWS)
+#define KVP_FIRST_OFFSET                (DEVICE_OFFSET + 4 * SEGMENT_ROWS)
+#define COORDINATOR_OFFSET              (KVP_FIRST_OFFSET + 4 * SEGMENT_ROWS)
+#define LQI_OFFSET                      (COORDINATOR_OFFSET + 2 * SEGMENT_ROWS)
+#define AVERAGE_OFFSET                  (LQI_OFFSET + SEGMENT_ROWS)
+#define STATE_OFFSET                    (AVERAGE_OFFSET + SEGMENT_ROWS)
+#define KVP_COUNT_OFFSET                (STATE_OFFSET + SEGMENT_ROWS)
+#define KVP_VALUE_OFFSET                (KVP_COUNT_OFFSET + SEGMENT_ROWS)
+#define KVP_OID_OFFSET                  (KVP_VALUE_OFFSET + 4 * SEGMENT_KVPS)
+#define COLUMNS_SIZE                    (KVP_OID_OFFSET + SEGMENT_KVPS)
+
+struct segment
+{
+    int fd;
+    uint8_t* base;
+    size_t size;
+    struct segmentHeader* header;
+    int64_t* time;
+    uint32_t* device;
+    uint32_t* kvpFirst;
+    uint16_t* coordinator;
+    uint8_t* lqi;
+    uint8_t* average;
+    uint8_t* state;
+    uint8_t* kvpCount;
+    int32_t* kvpValue;
+    uint8_t* kvpOid;
+    const struct indexEntry* index;
+    const uint32_t* indexRows;
+};
+
+struct store
+{
+    const char* dir;
+    int writable;
+    int lockFd;
+    struct catalog* catalog;
+    /** MAC to device + 1, 0 if empty; importer only */
+    uint32_t* deviceHash;
+    size_t deviceHashSize;
+    struct segment* segments;
+    int numSegments;
+};
+
+/** One row being imported, written when complete */
+struct row
+{
+    int64_t time;
+    uint32_t device;
+    uint16_t coordinator;
+    uint8_t lqi;
+    uint8_t average;
+    uint8_t state;
+    uint8_t kvpCount;
+    uint8_t kvpOid[MAX_KVPS_PER_ROW];
+    int32_t kvpValue[MAX_KVPS_PER_ROW];
+};
+
+static double elapsedMs(const struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static uint64_t mix(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static void* mapFile(int fd, size_t size, int writable)
+{
+    void* p = mmap(0, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    return (p == MAP_FAILED) ? 0 : p;
+}
+
+//
+//  Segments
+//
+
+static void segmentColumns(struct segment* s)
+{
+    s->header = (struct segmentHeader*) s->base;
+    s->time = (int64_t*) (s->base + TIME_OFFSET);
+    s->device = (uint32_t*) (s->base + DEVICE_OFFSET);
+    s->kvpFirst = (uint32_t*) (s->base + KVP_FIRST_OFFSET);
+    s->coordinator = (uint16_t*) (s->base + COORDINATOR_OFFSET);
+    s->lqi = s->base + LQI_OFFSET;
+    s->average = s->base + AVERAGE_OFFSET;
+    s->state = s->base + STATE_OFFSET;
+    s->kvpCount = s->base + KVP_COUNT_OFFSET;
+    s->kvpValue = (int32_t*) (s->base + KVP_VALUE_OFFSET);
+    s->kvpOid = s->base + KVP_OID_OFFSET;
+    s->index = 0;
+    s->indexRows = 0;
+    if (s->header->sealed && (s->size > s->header->indexOffset))
+    {
+        s->index = (const struct indexEntry*) (s->base + s->header->indexOffset);
+        s->indexRows = (const uint32_t*) (s->index + s->header->indexDevices);
+    }
+}
+
+static void segmentName(const struct store* st, int number, char* name)
+{
+    snprintf(name, PATH_MAX, "%s/segment-%06d.lqs", st->dir, number);
+}
+
+/**
+Maps segment number, creating it if create is set.
+@return 0 if success, 1 if it doesn't exist, -1 if error
+*/
+static int openSegment(struct store* st, int number, int create, struct segment* s)
+{
+    char name[PATH_MAX];
+    segmentName(st, number, name);
+    int writable = st->writable && create;
+    s->fd = open(name, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if (s->fd < 0)
+    {
+        if (errno == ENOENT)
+            return 1;
+        perror(name);
+        return -1;
+    }
+    struct stat info;
+    fstat(s->fd, &info);
+    if ((size_t) info.st_size < COLUMNS_SIZE)
+    {
+        if (!writable || (ftruncate(s->fd, COLUMNS_SIZE) != 0))    // New: sparse until written
+        {
+            fprintf(stderr, "%s: truncated\n", name);
+            close(s->fd);
+            return -1;
+        }
+        info.st_size = COLUMNS_SIZE;
+    }
+    s->size = info.st_size;
+    s->base = mapFile(s->fd, s->size, writable);
+    if (!s->base)
+    {
+        perror(name);
+        close(s->fd);
+        return -1;
+    }
+    struct segmentHeader* h = (struct segmentHeader*) s->base;
+    if (h->magic == 0 && writable)
+    {
+        h->magic = SEGMENT_MAGIC;
+        h->minTime = INT64_MAX;
+        h->maxTime = INT64_MIN;
+    }
+    if (h->magic != SEGMENT_MAGIC)
+    {
+        fprintf(stderr, "%s: not a segment\n", name);
+        munmap(s->base, s->size);
+        close(s->fd);
+        return -1;
+    }
+    segmentColumns(s);
+    return 0;
+}
+
+static void closeSegment(struct segment* s)
+{
+    munmap(s->base, s->size);
+    close(s->fd);
+}
+
+static int compareRowDevices(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+    return (x > y) - (x < y);
+}
+
+/** Appends the per-device index to a full segment and marks it sealed. @return 0 if success */
+static int sealSegment(struct segment* s)
+{
+    struct segmentHeader* h = s->header;
+    uint32_t rows = h->rows, r;
+    uint64_t* pairs = malloc(rows * sizeof(uint64_t));
+    if (!pairs)
+        return -1;
+    for (r = 0; r < rows; r++)
+        pairs[r] = ((uint64_t) s->device[r] << 32) | r;
+    qsort(pairs, rows, sizeof(uint64_t), compareRowDevices);
+    uint32_t devices = 0;
+    for (r = 0; r < rows; r++)
+        if ((r == 0) || ((pairs[r] >> 32) != (pairs[r - 1] >> 32)))
+            devices++;
+    
+    uint64_t offset = (COLUMNS_SIZE + 4095) & ~4095ULL;
+    size_t size = offset + devices * sizeof(struct indexEntry) + rows * sizeof(uint32_t);
+    if (ftruncate(s->fd, size) != 0)
+    {
+        free(pairs);
+        return -1;
+    }
+    uint8_t* base = mapFile(s->fd, size, 1);
+    if (!base)
+    {
+        free(pairs);
+        return -1;
+    }
+    munmap(s->base, s->size);
+    s->base = base;
+    s->size = size;
+    struct indexEntry* entries = (struct indexEntry*) (base + offset);
+    uint32_t* indexRows = (uint32_t*) (entries + devices);
+    uint32_t e = 0;
+    for (r = 0; r < rows; r++)
+    {
+        uint32_t device = (uint32_t) (pairs[r] >> 32);
+        if ((r == 0) || (device != entries[e - 1].device))
+        {
+            entries[e].device = device;
+            entries[e].first = r;
+            entries[e].count = 0;
+            e++;
+        }
+        entries[e - 1].count++;
+        indexRows[r] = (uint32_t) pairs[r];
+    }
+    free(pairs);
+    h = (struct segmentHeader*) base;
+    h->indexOffset = offset;
+    h->indexDevices = devices;
+    msync(base, size, MS_SYNC);
+    h->sealed = 1;                              // Only now will readers use the index
+    segmentColumns(s);
+    return 0;
+}
+
+//
+//  Store
+//
+
+/** @return device index of mac, added if new; -1 if the catalog is full */
+static int64_t findDevice(struct store* st, uint64_t mac, int add)
+{
+    struct catalog* c = st->catalog;
+    size_t mask = st->deviceHashSize - 1;
+    size_t b = mix(mac) & mask;
+    while (st->deviceHash[b])
+    {
+        if (c->macs[st->deviceHash[b] - 1] == mac)
+            return st->deviceHash[b] - 1;
+        b = (b + 1) & mask;
+    }
+    if (!add)
+        return -1;
+    if (c->numDevices == MAX_DEVICES)
+        return -1;
+    c->macs[c->numDevices] = mac;
+    st->deviceHash[b] = ++c->numDevices;
+    return c->numDevices - 1;
+}
+
+/** @return device index of mac, by search; for readers, which don't build the hash */
+static int64_t lookupDevice(const struct store* st, uint64_t mac)
+{
+    uint32_t d;
+    for (d = 0; d < st->catalog->numDevices; d++)
+        if (st->catalog->macs[d] == mac)
+            return d;
+    return -1;
+}
+
+static int64_t findCoordinator(struct store* st, const char* name, int add)
+{
+    struct catalog* c = st->catalog;
+    uint32_t i;
+    for (i = 0; i < c->numCoordinators; i++)
+        if (strncmp(c->coordinators[i], name, NAME_LENGTH) == 0)
+            return i;
+    if (!add || (c->numCoordinators == MAX_COORDINATORS))
+        return -1;
+    snprintf(c->coordinators[c->numCoordinators], NAME_LENGTH, "%s", name);
+    return c->numCoordinators++;
+}
+
+/** @return 0 if success */
+static int openStore(struct store* st, const char* dir, int writable)
+{
+    memset(st, 0, sizeof(*st));
+    st->dir = dir;
+    st->writable = writable;
+    char name[PATH_MAX];
+    if (writable)
+    {
+        mkdir(dir, 0755);
+        snprintf(name, PATH_MAX, "%s/lock", dir);
+        st->lockFd = open(name, O_RDWR | O_CREAT, 0644);
+        if ((st->lockFd < 0) || (flock(st->lockFd, LOCK_EX | LOCK_NB) != 0))
+        {
+            fprintf(stderr, "%s: in use by another importer\n", dir);
+            return -1;
+        }
+    }
+    snprintf(name, PATH_MAX, "%s/catalog.lqs", dir);
+    int fd = open(name, writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+    if ((fd < 0) || (writable && (ftruncate(fd, sizeof(struct catalog)) != 0)))
+    {
+        perror(name);
+        return -1;
+    }
+    struct stat info;
+    fstat(fd, &info);
+    if ((size_t) info.st_size < sizeof(struct catalog))
+    {
+        fprintf(stderr, "%s: truncated\n", name);
+        return -1;
+    }
+    st->catalog = mapFile(fd, sizeof(struct catalog), writable);
+    close(fd);
+    if (!st->catalog)
+    {
+        perror(name);
+        return -1;
+    }
+    if (writable && (st->catalog->magic == 0))
+        st->catalog->magic = CATALOG_MAGIC;
+    if (st->catalog->magic != CATALOG_MAGIC)
+    {
+        fprintf(stderr, "%s: not a catalog\n", name);
+        return -1;
+    }
+    
+    if (writable)
+    {
+        st->deviceHashSize = 2 * MAX_DEVICES;
+        st->deviceHash = calloc(st->deviceHashSize, sizeof(uint32_t));
+        if (!st->deviceHash)
+            return -1;
+        uint32_t d, n = st->catalog->numDevices;
+        st->catalog->numDevices = 0;            // Re-added in the same order
+        for (d = 0; d < n; d++)
+            findDevice(st, st->catalog->macs[d], 1);
+    }
+    
+    int capacity = 16;
+    st->segments = malloc(capacity * sizeof(struct segment));
+    while (1)
+    {
+        if (st->numSegments == capacity)
+        {
+            capacity *= 2;
+            st->segments = realloc(st->segments, capacity * sizeof(struct segment));
+        }
+        if (!st->segments)
+            return -1;
+        int result = openSegment(st, st->numSegments, 0, &st->segments[st->numSegments]);
+        if (result < 0)
+            return -1;
+        if (result > 0)
+            break;
+        st->numSegments++;
+    }
+    st->segments = realloc(st->segments, (st->numSegments + 1) * sizeof(struct segment));
+    if (!st->segments)
+        return -1;
+    if (writable)
+    {
+        // Only the last segment is written to, the others stay read-only
+        if ((st->numSegments == 0) || st->segments[st->numSegments - 1].header->sealed)
+            st->numSegments++;
+        else
+            closeSegment(&st->segments[st->numSegments - 1]);
+        if (openSegment(st, st->numSegments - 1, 1, &st->segments[st->numSegments - 1]) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+static void closeStore(struct store* st)
+{
+    int k;
+    for (k = 0; k < st->numSegments; k++)
+    {
+        if (st->writable)
+            msync(st->segments[k].base, st->segments[k].size, MS_SYNC);
+        closeSegment(&st->segments[k]);
+    }
+    free(st->segments);
+    free(st->deviceHash);
+    if (st->writable)
+        msync(st->catalog, sizeof(struct catalog), MS_SYNC);
+    munmap(st->catalog, sizeof(struct catalog));
+    if (st->lockFd > 0)
+        close(st->lockFd);
+}
+
+/** Appends a row, starting a new segment if the last is full. @return 0 if success */
+static int appendRow(struct store* st, const struct row* row)
+{
+    struct segment* s = &st->segments[st->numSegments - 1];
+    struct segmentHeader* h = s->header;
+    if ((h->rows == SEGMENT_ROWS) || (h->kvps + row->kvpCount > SEGMENT_KVPS))
+    {
+        if (sealSegment(s) != 0)
+        {
+            fprintf(stderr, "Can't seal segment %d\n", st->numSegments - 1);
+            return -1;
+        }
+        struct segment* segments = realloc(st->segments, (st->numSegments + 1) * sizeof(struct segment));
+        if (!segments)
+            return -1;
+        st->segments = segments;
+        if (openSegment(st, st->numSegments, 1, &st->segments[st->numSegments]) != 0)
+            return -1;
+        s = &st->segments[st->numSegments++];
+        h = s->header;
+    }
+    uint32_t r = h->rows, k = h->kvps, j;
+    s->time[r] = row->time;
+    s->device[r] = row->device;
+    s->kvpFirst[r] = k;
+    s->coordinator[r] = row->coordinator;
+    s->lqi[r] = row->lqi;
+    s->average[r] = row->average;
+    s->state[r] = row->state;
+    s->kvpCount[r] = row->kvpCount;
+    for (j = 0; j < row->kvpCount; j++)
+    {
+        s->kvpOid[k + j] = row->kvpOid[j];
+        s->kvpValue[k + j] = row->kvpValue[j];
+    }
+    if (row->time < h->minTime)
+        h->minTime = row->time;
+    if (row->time > h->maxTime)
+        h->maxTime = row->time;
+    __atomic_store_n(&h->kvps, k + row->kvpCount, __ATOMIC_RELEASE);
+    __atomic_store_n(&h->rows, r + 1, __ATOMIC_RELEASE);    // Publishes the row
+    return 0;
+}
+
+//
+//  Import
+//
+
+struct coordinatorClock
+{
+    int64_t offset;
+    int64_t last;
+    int started;
+};
+
+/** @return time of a message received at T=t by the coordinator */
+static int64_t messageTime(struct coordinatorClock* c, uint32_t t)
+{
+    int64_t time = c->offset + t;
+    if (c->started && (time < c->last))
+    {
+        if (c->last - time > 0x80000000LL)
+            c->offset += 0x100000000LL;         // T wrapped after 49.7 days
+        else if (c->last - time > RESTART_JUMP_MS)
+            c->offset = c->last - t;            // Coordinator restarted: carry on from where it was
+        time = c->offset + t;
+    }
+    if (!c->started || (time > c->last))
+        c->last = time;
+    c->started = 1;
+    return time;
+}
+
+static int stateFromName(const char* name)
+{
+    unsigned i;
+    for (i = 0; i < NUM_STATES; i++)
+        if (strcmp(stateNames[i], name) == 0)
+            return i;
+    return STATE_NONE;
+}
+
+struct importCounts
+{
+    uint64_t lines;
+    uint64_t messages;
+    uint64_t records;
+    uint64_t kvps;
+};
+
+/** Imports one coordinator log. @return 0 if success */
+static int importLog(struct store* st, FILE* f, uint16_t coordinator, struct coordinatorClock* clk, struct importCounts* n)
+{
+    static struct row row;
+    int pending = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f))
+    {
+        n->lines++;
+        unsigned long long mac;
+        unsigned lqi, average, index;
+        unsigned long t;
+        long value;
+        unsigned oid;
+        char state[16];
+        const char* p;
+        
+        if (pending && (line[0] == ' ') && (p = strstr(line, "(0x")) && 
+            (sscanf(p, "(0x%x) = %ld", &oid, &value) == 2))
+        {
+            if (row.kvpCount < MAX_KVPS_PER_ROW)
+            {
+                row.kvpOid[row.kvpCount] = (uint8_t) oid;
+                row.kvpValue[row.kvpCount++] = (int32_t) value;
+                n->kvps++;
+            }
+            continue;
+        }
+        if (pending)
+        {
+            pending = 0;
+            if (appendRow(st, &row) != 0)
+                return -1;
+        }
+        int64_t device;
+        if ((p = strstr(line, "From:")) && (sscanf(p, "From:%16llx, LQI=%2x, T=%lu", &mac, &lqi, &t) == 3))
+        {
+            if ((device = findDevice(st, mac, 1)) < 0)
+                goto full;
+            row.time = messageTime(clk, (uint32_t) t);
+            row.device = (uint32_t) device;
+            row.coordinator = coordinator;
+            row.lqi = (uint8_t) lqi;
+            row.average = STATE_NONE;
+            row.state = STATE_NONE;
+            row.kvpCount = 0;
+            pending = 1;                        // Complete once the KVPs have been read
+            n->messages++;
+        }
+        else if ((p = strstr(line, "DEVICE ")) && 
+                 (sscanf(p, "DEVICE %u %16llx %15s AVG=%2x LQI=%2x T=%lu", &index, &mac, state, &average, &lqi, &t) == 6))
+        {
+            if ((device = findDevice(st, mac, 1)) < 0)
+                goto full;
+            row.time = clk->offset + (uint32_t) t;
+            row.device = (uint32_t) device;
+            row.coordinator = coordinator;
+            row.lqi = (uint8_t) lqi;
+            row.average = (uint8_t) average;
+            row.state = (uint8_t) stateFromName(state);
+            row.kvpCount = 0;
+            if (appendRow(st, &row) != 0)
+                return -1;
+            n->records++;
+        }
+    }
+    if (pending && (appendRow(st, &row) != 0))
+        return -1;
+    return 0;
+full:
+    fprintf(stderr, "Catalog full: %lu devices\n", MAX_DEVICES);
+    return -1;
+}
+
+static int import(struct store* st, int argc, char* argv[])
+{
+    const char* coordinatorName = 0;
+    struct coordinatorClock clk = {0, 0, 0};
+    int opt;
+    while ((opt = getopt(argc, argv, "c:b:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': coordinatorName = optarg; break;
+        case 'b': clk.offset = atoll(optarg); break;
+        default: return 2;
+        }
+    }
+    if (!coordinatorName || (optind == argc))
+        return 2;
+    int64_t coordinator = findCoordinator(st, coordinatorName, 1);
+    if (coordinator < 0)
+    {
+        fprintf(stderr, "Catalog full: %d coordinators\n", MAX_COORDINATORS);
+        return 1;
+    }
+    struct importCounts n = {0, 0, 0, 0};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int k;
+    for (k = optind; k < argc; k++)
+    {
+        FILE* f = (strcmp(argv[k], "-") == 0) ? stdin : fopen(argv[k], "r");
+        if (!f)
+        {
+            perror(argv[k]);
+            return 1;
+        }
+        int result = importLog(st, f, (uint16_t) coordinator, &clk, &n);
+        if (f != stdin)
+            fclose(f);
+        if (result != 0)
+            return 1;
+    }
+    fprintf(stderr, "%llu lines: %llu messages with %llu KVPs, %llu device records in %.0fms\n", 
+            (unsigned long long) n.lines, (unsigned long long) n.messages, (unsigned long long) n.kvps, 
+            (unsigned long long) n.records, elapsedMs(&start));
+    return 0;
+}
+
+//
+//  Queries
+//
+
+static void printRow(const struct store* st, const struct segment* s, uint32_t r)
+{
+    printf("%lld %s %016llX LQI=%02X", (long long) s->time[r], st->catalog->coordinators[s->coordinator[r]],
+           (unsigned long long) st->catalog->macs[s->device[r]], s->lqi[r]);
+    if (s->state[r] != STATE_NONE)
+        printf(" AVG=%02X %s", s->average[r], (s->state[r] < NUM_STATES) ? stateNames[s->state[r]] : "UNKNOWN");
+    uint32_t j, k = s->kvpFirst[r];
+    for (j = 0; j < s->kvpCount[r]; j++)
+        printf(" 0x%02X=%d", s->kvpOid[k + j], s->kvpValue[k + j]);
+    putchar('\n');
+}
+
+/** @return the device's entry in a sealed segment's index, 0 if it has no rows there */
+static const struct indexEntry* findIndexEntry(const struct segment* s, uint32_t device)
+{
+    uint32_t low = 0, high = s->header->indexDevices;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (s->index[middle].device < device)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return ((low < s->header->indexDevices) && (s->index[low].device == device)) ? &s->index[low] : 0;
+}
+
+static int scan(struct store* st, int argc, char* argv[])
+{
+    unsigned long long mac = 0;
+    int haveMac = 0, countOnly = 0;
+    int64_t from = INT64_MIN, to = INT64_MAX;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:f:t:n")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm': mac = strtoull(optarg, 0, 16); haveMac = 1; break;
+        case 'f': from = atoll(optarg); break;
+        case 't': to = atoll(optarg); break;
+        case 'n': countOnly = 1; break;
+        default: return 2;
+        }
+    }
+    if (!haveMac)
+        return 2;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int64_t device = lookupDevice(st, mac);
+    uint64_t matches = 0, rowsRead = 0;
+    int segmentsRead = 0, k;
+    for (k = 0; (k < st->numSegments) && (device >= 0); k++)
+    {
+        const struct segment* s = &st->segments[k];
+        const struct segmentHeader* h = s->header;
+        uint32_t rows = __atomic_load_n(&h->rows, __ATOMIC_ACQUIRE);
+        if ((rows == 0) || (h->minTime > to) || (h->maxTime < from))
+            continue;
+        if (h->sealed && s->index)
+        {
+            const struct indexEntry* e = findIndexEntry(s, (uint32_t) device);
+            if (!e)
+                continue;
+            segmentsRead++;
+            uint32_t j;
+            for (j = 0; j < e->count; j++)
+            {
+                uint32_t r = s->indexRows[e->first + j];
+                if ((s->time[r] < from) || (s->time[r] > to))
+                    continue;
+                matches++;
+                if (!countOnly)
+                    printRow(st, s, r);
+            }
+            rowsRead += e->count;
+        } else {
+            segmentsRead++;                     // Being written: no index yet
+            uint32_t r;
+            for (r = 0; r < rows; r++)
+            {
+                if ((s->device[r] != device) || (s->time[r] < from) || (s->time[r] > to))
+                    continue;
+                matches++;
+                if (!countOnly)
+                    printRow(st, s, r);
+            }
+            rowsRead += rows;
+        }
+    }
+    if (countOnly)
+        printf("%llu\n", (unsigned long long) matches);
+    fprintf(stderr, "%llu rows of %016llX in %.3fms, %d of %d segments read, %llu rows examined\n",
+            (unsigned long long) matches, mac, elapsedMs(&start), segmentsRead, st->numSegments, 
+            (unsigned long long) rowsRead);
+    return 0;
+}
+
+static int listDevices(const struct store* st)
+{
+    uint32_t d;
+    for (d = 0; d < st->catalog->numDevices; d++)
+        printf("%016llX\n", (unsigned long long) st->catalog->macs[d]);
+    return 0;
+}
+
+static int stats(const struct store* st)
+{
+    uint64_t rows = 0, kvps = 0, disk = 0;
+    int k;
+    for (k = 0; k < st->numSegments; k++)
+    {
+        const struct segment* s = &st->segments[k];
+        struct stat info;
+        fstat(s->fd, &info);
+        rows += s->header->rows;
+        kvps += s->header->kvps;
+        disk += info.st_blocks * 512ULL;
+        printf("segment %d: %u rows, %u KVPs, T %lld..%lld, %s\n", k, s->header->rows, s->header->kvps, 
+               (long long) s->header->minTime, (long long) s->header->maxTime, 
+               s->header->sealed ? "sealed" : "open");
+    }
+    printf("%llu rows, %llu KVPs in %d segments, %llu MB on disk; %u coordinators, %u devices\n", 
+           (unsigned long long) rows, (unsigned long long) kvps, st->numSegments, 
+           (unsigned long long) (disk >> 20), st->catalog->numCoordinators, st->catalog->numDevices);
+    return 0;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s -d store import -c coordinator [-b base ms] log ...\n"
+            "       %s -d store scan -m MAC [-f from ms] [-t to ms] [-n]\n"
+            "       %s -d store devices | stats\n", name, name, name);
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* dir = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "+d:")) != -1)
+    {
+        if (opt == 'd')
+            dir = optarg;
+        else
+            usage(argv[0]);
+    }
+    if (!dir || (optind == argc))
+        usage(argv[0]);
+    const char* command = argv[optind];
+    int writable = (strcmp(command, "import") == 0);
+    if (!writable && (strcmp(command, "scan") != 0) && (strcmp(command, "devices") != 0) && 
+        (strcmp(command, "stats") != 0))
+        usage(argv[0]);
+    
+    struct store st;
+    if (openStore(&st, dir, writable) != 0)
+        return 1;
+    int subArgc = argc - optind;
+    char** subArgv = argv + optind;
+    optind = 1;
+    int result;
+    if (writable)
+        result = import(&st, subArgc, subArgv);
+    else if (strcmp(command, "scan") == 0)
+        result = scan(&st, subArgc, subArgv);
+    else if (strcmp(command, "devices") == 0)
+        result = listDevices(&st);
+    else
+        result = stats(&st);
+    closeStore(&st);
+    if (result == 2)
+        usage(argv[0]);
+    return result;
+}
+
+/* @} */
@@ -0,0 +1,49 @@
+#!/bin/sh
+#
+# Builds the coordinator application as a Linux process with the POSIX HAL. See hal_posix.h.
+#
+# The ZM, Common and Messages sources and HAL/hal.h, HAL/hal_version.h come from the module SDK, which
+# is not part of this tree. Point ZM_SDK at a copy of it:
+#   ZM_SDK/HAL/hal.h, ZM_SDK/HAL/hal_version.h
+#   ZM_SDK/ZM/*.c, *.h
+#   ZM_SDK/Common/*.c, *.h
+#   ZM_SDK_EXAMPLES/Messages/*.c, *.h and ZM_SDK_EXAMPLES/module_example_utils.c, .h
+#                               (ZM_SDK_EXAMPLES defaults to ZM_SDK/Examples)
+# The tree is staged in the SDK's layout, with hal_launchpad.h and <intrinsics.h> from this directory,
+# and built without touching either source tree.
+#
+# Usage, from the directory containing hal_posix.c:
+#   ZM_SDK=/path/to/sdk tools/posix/build.sh [output]       (default output: ./coordinator)
+# Run against the emulated module (see tools/zm_emulator.c):
+#   gcc -O2 -Wall -o zm_emulator tools/zm_emulator.c && ./zm_emulator -s /tmp/zm.sock &
+#   HAL_POSIX_MODULE=/tmp/zm.sock HAL_POSIX_CONSOLE=stdio ./coordinator
+# Extra compiler options, e.g. -DLATENCY_INSTRUMENTATION or -g -fsanitize=address, go in CFLAGS.
+#
+set -e
+
+: "${ZM_SDK:?set ZM_SDK to the module SDK directory}"
+ZM_SDK_EXAMPLES="${ZM_SDK_EXAMPLES:-$ZM_SDK/Examples}"
+APP="$(cd "$(dirname "$0")/../.." && pwd)"
+OUTPUT="$(cd "$(dirname "${1:-coordinator}")" && pwd)/$(basename "${1:-coordinator}")"
+STAGE="$(mktemp -d)"
+trap 'rm -rf "$STAGE"' EXIT
+
+mkdir "$STAGE/HAL" "$STAGE/app"
+ln -s "$ZM_SDK/HAL/hal.h" "$ZM_SDK/HAL/hal_version.h" "$STAGE/HAL/"
+cp -rs "$ZM_SDK/ZM" "$ZM_SDK/Common" "$STAGE/"       # Linked file by file, so that "../HAL" resolves
+cp -rs "$ZM_SDK_EXAMPLES/Messages" "$STAGE/app/"
+ln -s "$ZM_SDK_EXAMPLES"/module_example_utils.* "$STAGE/app/"
+for f in "$APP"/*.c "$APP"/*.h; do
+    case "$(basename "$f")" in
+        hal_*) ln -s "$f" "$STAGE/HAL/" ;;
+        *)     ln -s "$f" "$STAGE/app/" ;;
+    esac
+done
+
+# hal_posix.c stands in for hal_launchpad.c, hal_clock.c, hal_vlo.c, hal_adc.c, hal_flash.c and
+# hal_stack.c; hal_energy.c and hal_profiler.c are left out.
+cd "$STAGE/app"
+gcc -std=gnu99 -O2 -Wall -DHAL_POSIX -I"$APP/tools/posix" -I"$STAGE/HAL" -pthread $CFLAGS -o "$OUTPUT" \
+    *.c Messages/*.c ../ZM/*.c $(ls ../Common/*.c 2>/dev/null) \
+    ../HAL/hal_posix.c ../HAL/hal_rgb.c ../HAL/hal_output.c
+echo "Built $OUTPUT"
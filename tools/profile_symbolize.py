@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""
+Symbolizes a PC sampling profile from hal_profiler.c against the linker map.
+
+Capture the console output of the 'P' command (e.g. with a terminal program's log) after profiling
+for a while with 'p'. The histogram looks like:
+
+    PROFILE start=C000 shift=8 bins=64 divider=13 samples=51234 scale=7 outside=0 invalid=3
+    P C200 41
+    P C300 255
+    PROFILE END
+
+Each bin covers 2^shift bytes of code. Its samples are shared between the functions that overlap it,
+in proportion to the bytes of each in the bin, since where within the bin they fell isn't known;
+functions that only got samples this way are marked '~'. Zoom in ('z') to narrow the range to the
+hottest bin and get exact attribution.
+
+Symbols are read from:
+- An IAR XLINK map (.map, "ENTRY LIST" with hex addresses), or an IAR ILINK map ("Entry Address Size
+  Type" table). Only code entries are used: ILINK "Code" entries, and XLINK entries except those in
+  data segments (DATA16_*, DATA20_*, CONST, CSTACK, INFO*). Entries outside the range profiled are
+  dropped.
+- The output of "nm -n" or "objdump -t", e.g. for a GCC build.
+Functions without a size extend to the next symbol.
+
+Usage:
+    tools/profile_symbolize.py [--top N] map_file profile.txt
+e.g.
+    tools/profile_symbolize.py Debug/List/coordinator.map console.log
+
+If the log holds several profiles, the last one is used. A large "invalid" count means that
+HAL_PROFILER_ISR_FRAME is wrong for this compiler; see hal_profiler.h.
+"""
+
+import argparse
+import re
+import sys
+
+PROFILE_HEADER = re.compile(r"PROFILE start=([0-9A-Fa-f]+) shift=(\d+) bins=(\d+) divider=(\d+) samples=(\d+) "
+                            r"scale=(\d+) outside=(\d+) invalid=(\d+)")
+PROFILE_BIN = re.compile(r"^P ([0-9A-Fa-f]+) (\d+)\s*$")
+
+# IAR ILINK: "main    0xc11e   0x4a  Code  Gb  app.o [1]"
+ILINK_ENTRY = re.compile(r"^\s*([A-Za-z_?][\w?]*)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+Code\b")
+# IAR XLINK: "main                    C2F0   ..." within an ENTRY LIST
+XLINK_ENTRY = re.compile(r"^\s*([A-Za-z_?][\w?]*)\s+([0-9A-Fa-f]{4})\b")
+# XLINK entries in these segments are variables or constants, not code
+XLINK_DATA = re.compile(r"\b(DATA(16|20)_\w+|CONST|CSTACK|INFO\w*)\b")
+# nm -n: "0000c2f0 T main"
+NM_ENTRY = re.compile(r"^([0-9a-fA-F]+)\s+[TtWw]\s+([A-Za-z_.?][\w.?]*)\s*$")
+# objdump -t: "0000c2f0 g     F .text  0000004a main"
+OBJDUMP_ENTRY = re.compile(r"^([0-9a-fA-F]+)\s+\w*\s+F\s+\S+\s+([0-9a-fA-F]+)\s+([A-Za-z_.?][\w.?]*)\s*$")
+
+
+def readSymbols(fileName):
+    """@return [(address, size, name)] of code symbols, sorted by address"""
+    symbols = {}
+    inEntryList = False
+    with open(fileName, errors="replace") as f:
+        for line in f:
+            if "ENTRY LIST" in line:
+                inEntryList = True
+                continue
+            m = ILINK_ENTRY.match(line)
+            if m:
+                symbols[int(m.group(2), 16)] = (int(m.group(3), 16), m.group(1))
+                continue
+            m = OBJDUMP_ENTRY.match(line)
+            if m:
+                symbols[int(m.group(1), 16)] = (int(m.group(2), 16) or None, m.group(3))
+                continue
+            m = NM_ENTRY.match(line)
+            if m:
+                symbols.setdefault(int(m.group(1), 16), (None, m.group(2)))
+                continue
+            if inEntryList:
+                m = XLINK_ENTRY.match(line)
+                if m and m.group(1) not in ("ENTRY", "ADDRESS", "MODULE") and not XLINK_DATA.search(line):
+                    symbols.setdefault(int(m.group(2), 16), (None, m.group(1)))
+    result = sorted((address, size, name) for address, (size, name) in symbols.items())
+    # Sizeless symbols run to the next one
+    for i, (address, size, name) in enumerate(result):
+        if size is None:
+            end = result[i + 1][0] if i + 1 < len(result) else address + 2
+            result[i] = (address, end - address, name)
+    return result
+
+
+def readProfile(fileName):
+    """@return header dict and {address: count} of the last profile in the file"""
+    header = None
+    bins = {}
+    with open(fileName, errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            m = PROFILE_HEADER.search(line)
+            if m:
+                header = {"start": int(m.group(1), 16), "shift": int(m.group(2)), "bins": int(m.group(3)),
+                          "divider": int(m.group(4)), "samples": int(m.group(5)), "scale": int(m.group(6)),
+                          "outside": int(m.group(7)), "invalid": int(m.group(8))}
+                bins = {}
+                continue
+            m = PROFILE_BIN.match(line)
+            if m and header is not None:
+                bins[int(m.group(1), 16)] = int(m.group(2)) << header["scale"]
+    if header is None:
+        raise SystemExit("%s: no PROFILE found" % fileName)
+    return header, bins
+
+
+def attribute(symbols, binAddress, binSize, count, totals, exact):
+    """Shares one bin's count between the symbols overlapping it"""
+    overlaps = []
+    for address, size, name in symbols:
+        if address >= binAddress + binSize:
+            break
+        overlap = min(address + size, binAddress + binSize) - max(address, binAddress)
+        if overlap > 0:
+            overlaps.append((overlap, name))
+    covered = sum(o for o, _ in overlaps)
+    if covered < binSize:
+        overlaps.append((binSize - covered, "(unknown)"))
+    for overlap, name in overlaps:
+        totals[name] = totals.get(name, 0.0) + count * overlap / binSize
+        if len(overlaps) == 1:
+            exact.add(name)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Symbolize a hal_profiler.c PC sampling profile")
+    parser.add_argument("map", help="linker map, or nm/objdump output")
+    parser.add_argument("profile", help="console log containing the output of the 'P' command")
+    parser.add_argument("--top", type=int, default=30, help="number of functions to show")
+    args = parser.parse_args()
+
+    symbols = readSymbols(args.map)
+    if not symbols:
+        raise SystemExit("%s: no code symbols found" % args.map)
+    header, bins = readProfile(args.profile)
+    binSize = 1 << header["shift"]
+    end = header["start"] + header["bins"] * binSize
+    symbols = [(address, size, name) for address, size, name in symbols
+               if address < end and address + size > header["start"]]
+
+    totals = {}
+    exact = set()
+    for binAddress, count in sorted(bins.items()):
+        attribute(symbols, binAddress, binSize, count, totals, exact)
+    total = sum(totals.values())
+
+    print("Range %04X-%04X, %d bytes per bin, sampled every %d periods" %
+          (header["start"], end - 1, binSize, header["divider"]))
+    print("%d samples: %d in range, %d outside, %d invalid" %
+          (header["samples"], header["samples"] - header["outside"] - header["invalid"], header["outside"],
+           header["invalid"]))
+    if header["samples"] and header["invalid"] * 2 > header["samples"]:
+        print("warning: most samples invalid, check HAL_PROFILER_ISR_FRAME", file=sys.stderr)
+    if total == 0:
+        return 0
+    print()
+    print("%6s  %8s  %s" % ("%", "Samples", "Function"))
+    for name, count in sorted(totals.items(), key=lambda t: -t[1])[:args.top]:
+        print("%6.2f  %8.0f  %s%s" % (100.0 * count / total, count, name, "" if name in exact else " ~"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""
+Worst-case stack usage per function, from the IAR compiler's list files.
+
+Enable list files with "Include stack usage" (--lst with stack usage, e.g. Project > Options >
+C/C++ Compiler > List > Output list file) and build. Each .lst file then ends with a table like:
+
+       Maximum stack usage in bytes:
+
+       CSTACK Function
+       ------ --------
+           6  parseMessages
+             6   -> outStr
+            30   -> printInfoMessage
+
+The first number is the function's own frame, including its return address; the number before
+each call is the stack in use at that call. This script joins the tables of all list files into
+one call graph, adds the calls made through function pointers (which the compiler can't see; see
+INDIRECT_CALLS below, and --call to add more), and prints the worst case for each function, deepest
+first. The total for the application is the worst case from main() plus the worst single interrupt,
+since interrupts don't nest. Library functions without a list file (e.g. printf) are reported as
+unknown unless given with --frame.
+
+Usage:
+    tools/stack_report.py [--stack-size N] [--frame name=bytes ...] [--call caller=callee,...] file.lst ...
+e.g.
+    tools/stack_report.py --stack-size 80 --frame printf=60 Debug/List/*.lst
+
+Compare the total with the stack size set in the linker options (see RAM budget below), and with the
+high-water mark printed at boot by displayRamUsage(), which is what actually happened.
+"""
+
+import argparse
+import re
+import sys
+
+# Calls through function pointers, caller -> callees. Keep in step with the task table and the ISR
+# hooks set up in main(), see hal_launchpad.c.
+INDIRECT_CALLS = {
+    "schedulerRun": ["alarmOutputTask", "trackingTask", "messageReceptionTask", "buttonTask",
+                     "eventTask", "maintenanceTask", "moduleCommandTask", "journalTask", "idleTask"],
+    "complete": ["moduleGpioDone", "mgmtLqiRequestDone"],
+    "watchdog_timer": ["handleSysTick"],
+    "USCIAB0RX_ISR": ["handleConsoleByte"],
+    "PORT1_ISR": ["handleButtonPress"],
+    "PORT2_ISR": ["handleSrdy"],
+    "Timer_A0": ["doNothingVoid"],
+    "ADC10_ISR": ["energyBlockIsr"],
+}
+
+# RAM budget of the MSP430G2553 (512 bytes) for the default build: NUM_DEVICES 2, LATENCY_HISTOGRAMS
+# on, and LATENCY_INSTRUMENTATION, ENERGY_PROFILING and PC_PROFILING off. The static RAM of each
+# module is estimated from its declarations (16 and 32 bit variables 2-byte aligned, enums 1 byte). It
+# has not been checked against an XLINK map yet: when one is available, compare the module map's
+# DATA16_I, DATA16_Z and DATA16_N sizes with this table, and with what displayRamUsage() prints at
+# boot. Keep it in step with the code. The opt-in builds only fit if something else is given up.
+#
+#   Module                 Bytes  What
+#   application              128  routers[] 30 per device, the rest about 68
+#   report                     4  last reported state, 2 per device
+#   event_queue               16  EVENT_QUEUE_SIZE events of 6 bytes
+#   module_async              32  MODULE_ASYNC_QUEUE_SIZE commands of 8 bytes
+#   journal                   26  JOURNAL_QUEUE_SIZE records of 4 bytes
+#   latency                   24  LATENCY_HISTOGRAMS, 4 stages of 6 buckets
+#   scheduler                  6  task table and ready bitmap
+#   hal_adc                   30  DTC block and filtered values
+#   hal_clock                 14
+#   hal_rgb                   14
+#   hal_vlo                   18
+#   hal_launchpad             18  ISR hooks, SRDY timestamp
+#   zm_phy_spi               100  zmBuf, ZIGBEE_MODULE_BUFFER_SIZE
+#   (any other)                2  e.g. the C library
+#   CSTACK                    80  give this as --stack-size
+#                            ---
+#                            512
+#
+# Each device beyond NUM_DEVICES 2 costs 32 bytes, which has to come out of something above.
+
+# Interrupt service routines: roots of the call graph besides main()
+ISRS = ["watchdog_timer", "USCIAB0RX_ISR", "PORT1_ISR", "PORT2_ISR", "Timer_A0", "Timer_A1", "Timer1_A0",
+        "ADC10_ISR"]
+
+FUNCTION_LINE = re.compile(r"^\s*(\d+)\s+([A-Za-z_?][\w?]*)\s*$")
+CALL_LINE = re.compile(r"^\s*(\d+)\s+->\s+([A-Za-z_?][\w?]*)\s*$")
+
+
+def parse(fileName, frames, calls):
+    """Adds the functions and calls in one list file's stack usage table to frames and calls."""
+    inTable = False
+    current = None
+    with open(fileName, errors="replace") as f:
+        for line in f:
+            if "Maximum stack usage in bytes" in line:
+                inTable = True
+                continue
+            if not inTable:
+                continue
+            if line.strip().startswith("Segment part sizes") or line.strip().startswith("Section sizes"):
+                break
+            m = CALL_LINE.match(line)
+            if m and current:
+                calls.setdefault(current, []).append((int(m.group(1)), m.group(2)))
+                continue
+            m = FUNCTION_LINE.match(line)
+            if m:
+                current = m.group(2)
+                frames[current] = max(frames.get(current, 0), int(m.group(1)))
+
+
+def worstCase(name, frames, calls, memo, path):
+    """@return (worst case stack of name including its callees, deepest path), None if unknown"""
+    if name in memo:
+        return memo[name]
+    if name in path:
+        print("warning: recursion through %s, not bounded" % " -> ".join(path + [name]), file=sys.stderr)
+        return (frames.get(name, 0), [name])
+    if name not in frames:
+        return (None, [name])
+    path.append(name)
+    best = (frames[name], [name])
+    unknown = False
+    for atCall, callee in calls.get(name, []):
+        depth, deepest = worstCase(callee, frames, calls, memo, path)
+        if depth is None:
+            unknown = True
+            continue
+        if atCall + depth > best[0]:
+            best = (atCall + depth, [name] + deepest)
+    path.pop()
+    if unknown:
+        best = (best[0], best[1] + ["(+unknown)"])
+    memo[name] = best
+    return best
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Worst-case stack usage from IAR list files")
+    parser.add_argument("files", nargs="+", help="list files (.lst)")
+    parser.add_argument("--stack-size", type=int, default=0, help="stack size from the linker options")
+    parser.add_argument("--frame", action="append", default=[], metavar="NAME=BYTES",
+                        help="worst case of a function with no list file, e.g. printf=60")
+    parser.add_argument("--call", action="append", default=[], metavar="CALLER=CALLEE,...",
+                        help="extra calls through function pointers")
+    args = parser.parse_args()
+
+    frames = {}
+    calls = {}
+    for fileName in args.files:
+        parse(fileName, frames, calls)
+    for frame in args.frame:
+        name, size = frame.split("=")
+        frames[name] = int(size)
+    indirect = dict(INDIRECT_CALLS)
+    for call in args.call:
+        caller, callees = call.split("=")
+        indirect.setdefault(caller, []).extend(callees.split(","))
+    for caller, callees in indirect.items():
+        if caller in frames:
+            # The stack at an indirect call is at least the caller's frame; it can't be read from the table
+            calls.setdefault(caller, []).extend((frames[caller], c) for c in callees if c in frames)
+
+    memo = {}
+    results = []
+    for name in frames:
+        depth, deepest = worstCase(name, frames, calls, memo, [])
+        results.append((depth, name, deepest))
+    results.sort(key=lambda r: -r[0])
+
+    print("%6s  %-28s %s" % ("Worst", "Function", "Deepest path"))
+    for depth, name, deepest in results:
+        print("%6d  %-28s %s" % (depth, name, " -> ".join(deepest[1:])))
+
+    mainDepth = memo.get("main", (0, []))[0]
+    isrDepths = [(memo[i][0], i) for i in ISRS if i in memo]
+    isrDepth, isrName = max(isrDepths) if isrDepths else (0, "none")
+    total = mainDepth + isrDepth
+    print()
+    print("main: %d, worst interrupt: %d (%s), total: %d bytes" % (mainDepth, isrDepth, isrName, total))
+    if args.stack_size:
+        print("Stack size %d bytes: %d bytes %s" % (args.stack_size, abs(args.stack_size - total),
+                                                    "spare" if total <= args.stack_size else "OVER"))
+        return 0 if total <= args.stack_size else 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,562 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file tracking_sim.c
+*
+* @brief Host-side stress simulator for the tracking algorithm, with RF path loss, fading and movement
+* models.
+*
+Compiles tracking.c unchanged and drives it with synthetic devices ("tags") moving around a 
+coordinator. Each worker thread runs one virtual coordinator with its own tags, so that thousands of 
+tags can be simulated in parallel.
+
+Models, per tag, once per simulated second:
+- Movement: random waypoint. Tags mostly wander within HOME_RADIUS_M of the coordinator but sometimes 
+  head out as far as MAX_RADIUS_M. A tag further than the loss radius (-l) is lost, which is the ground 
+  truth that the algorithm's decisions are scored against.
+- Path loss: log-distance, PL(d) = PL_1M_DB + 10 * n * log10(d), with exponent n (-e).
+- Shadowing: log-normal with standard deviation sigma (-f), correlated from one second to the next.
+- Fading: Rayleigh, i.e. exponentially distributed received power.
+- Radio: frames below RX_SENSITIVITY_DBM are not received. LQI is derived from RSSI as by the CC2530.
+
+Reported:
+- Throughput: frames fed through trackingUpdate() and trackingEvaluate(), per second of wall-clock time.
+- False alarm rate: fraction of the time that present tags were in ITEM_LOST_ALARM.
+- Missed alarm rate: fraction of the time that lost tags were not in ITEM_LOST_ALARM.
+- Loss episodes that never raised an alarm, and alarms raised for tags that were present.
+- Time to alarm: from a tag becoming lost to its alarm, mean and worst case.
+
+Replay: -w writes every sample to a CSV trace (second, coordinator, tag, LQI or 0 if no frame, lost), 
+and -p replays a trace instead of running the models. A trace can also come from a real coordinator's 
+log. To compare changes to tracking.c on identical input, record a trace once and replay it through 
+each build.
+
+Build, from the directory containing tracking.c:
+    gcc -O2 -Wall -pthread -I. -o tracking_sim tools/tracking_sim.c tracking.c -lm
+Run:
+    ./tracking_sim [-c coordinators] [-n tags per coordinator] [-s seconds] [-e exponent] 
+                   [-f shadowing sigma dB] [-l loss radius m] [-r seed] [-w trace.csv | -p trace.csv]
+e.g.
+    ./tracking_sim -w trace.csv && ./tracking_sim -p trace.csv
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "tracking.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/** Transmit power of the tags, dBm */
+#define TX_POWER_DBM                    4.0
+/** Path loss at 1m, 2.4GHz */
+#define PL_1M_DB                        40.0
+/** CC2530 LQI scaling: RSSI at LQI 0 and at LQI 255 */
+#define RX_SENSITIVITY_DBM              (-97.0)
+#define RX_SATURATION_DBM               10.0
+/** Correlation of the shadowing from one second to the next */
+#define SHADOWING_CORRELATION           0.9
+/** Tags mostly stay within this distance of the coordinator */
+#define HOME_RADIUS_M                   10.0
+/** ...but sometimes wander up to this far */
+#define MAX_RADIUS_M                    40.0
+/** Probability that a tag's next waypoint is outside HOME_RADIUS_M */
+#define WANDER_PROBABILITY              0.05
+/** Walking speed range, m/s */
+#define MIN_SPEED_MPS                   0.3
+#define MAX_SPEED_MPS                   1.5
+
+/** Coordinators, and tags per coordinator, that a replayed trace may hold */
+#define REPLAY_MAX_COORDINATORS         0x10000
+#define REPLAY_MAX_TAGS                 0xFFFF
+
+/** Simulation parameters, set from the command line */
+struct simParameters
+{
+    int coordinators;
+    int tags;
+    int seconds;
+    double pathLossExponent;
+    double shadowingSigma;
+    double lossRadius;
+    unsigned long seed;
+    /** Trace written by the models, or 0 */
+    FILE* traceOut;
+};
+
+/** A simulated tag: position, movement and channel state, and how it is being scored */
+struct tag
+{
+    double x, y;
+    double targetX, targetY;
+    double speed;
+    double shadowing;
+    int lost;
+    int lossStart;
+    int alarmedThisEpisode;
+};
+
+/** Results of one virtual coordinator */
+struct simResults
+{
+    uint64_t frames;
+    uint64_t framesMissed;
+    uint64_t presentSeconds;
+    uint64_t falseAlarmSeconds;
+    uint64_t lostSeconds;
+    uint64_t missedAlarmSeconds;
+    uint64_t lossEpisodes;
+    uint64_t lossEpisodesMissed;
+    uint64_t falseAlarms;
+    uint64_t alarmDelaySum;
+    uint64_t alarmDelayCount;
+    uint64_t alarmDelayMax;
+};
+
+/** One virtual coordinator, with its tags */
+struct coordinator
+{
+    struct trackingContext ctx;
+    struct tag* tags;
+    struct simResults results;
+};
+
+/** A worker thread, running one coordinator */
+struct worker
+{
+    pthread_t thread;
+    int index;
+    const struct simParameters* p;
+    uint64_t rng;
+    struct coordinator c;
+};
+
+static pthread_mutex_t traceLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** xorshift64*: fast, and independent per thread */
+static double uniform(uint64_t* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return ((*state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/** Standard normal, Box-Muller */
+static double gaussian(uint64_t* state)
+{
+    double u1 = uniform(state);
+    double u2 = uniform(state);
+    if (u1 < 1e-300)
+        u1 = 1e-300;
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/** Picks a random point within radius of the coordinator */
+static void randomPoint(uint64_t* rng, double radius, double* x, double* y)
+{
+    double r = radius * sqrt(uniform(rng));
+    double a = 2.0 * M_PI * uniform(rng);
+    *x = r * cos(a);
+    *y = r * sin(a);
+}
+
+/** Picks the tag's next waypoint and speed */
+static void newWaypoint(struct tag* t, uint64_t* rng)
+{
+    double radius = (uniform(rng) < WANDER_PROBABILITY) ? MAX_RADIUS_M : HOME_RADIUS_M;
+    randomPoint(rng, radius, &t->targetX, &t->targetY);
+    t->speed = MIN_SPEED_MPS + (MAX_SPEED_MPS - MIN_SPEED_MPS) * uniform(rng);
+}
+
+/** Moves the tag one second towards its waypoint */
+static void move(struct tag* t, uint64_t* rng)
+{
+    double dx = t->targetX - t->x;
+    double dy = t->targetY - t->y;
+    double d = sqrt(dx * dx + dy * dy);
+    if (d <= t->speed)
+    {
+        t->x = t->targetX;
+        t->y = t->targetY;
+        newWaypoint(t, rng);
+    } else {
+        t->x += dx * t->speed / d;
+        t->y += dy * t->speed / d;
+    }
+}
+
+/** 
+Received signal strength of one frame from the tag. Updates the tag's shadowing.
+@return RSSI in dBm
+*/
+static double rssi(struct tag* t, const struct simParameters* p, uint64_t* rng)
+{
+    double d = sqrt(t->x * t->x + t->y * t->y);
+    if (d < 1.0)
+        d = 1.0;
+    double pathLoss = PL_1M_DB + 10.0 * p->pathLossExponent * log10(d);
+    t->shadowing = SHADOWING_CORRELATION * t->shadowing + 
+        sqrt(1.0 - SHADOWING_CORRELATION * SHADOWING_CORRELATION) * p->shadowingSigma * gaussian(rng);
+    double u = uniform(rng);
+    double fading = 10.0 * log10(-log(u < 1e-300 ? 1e-300 : u));  // Rayleigh: power is exponential
+    return TX_POWER_DBM - pathLoss + t->shadowing + fading;
+}
+
+/** @return LQI as computed by the CC2530 from rssi, 1 to 255. 0 is reserved for "no sample". */
+static uint8_t lqiFromRssi(double rssi)
+{
+    double lqi = (rssi - RX_SENSITIVITY_DBM) * 255.0 / (RX_SATURATION_DBM - RX_SENSITIVITY_DBM);
+    if (lqi < 1.0)
+        return 1;
+    if (lqi > 255.0)
+        return 255;
+    return (uint8_t) lqi;
+}
+
+/** Allocates a coordinator with tags, all connected */
+static void coordinatorInit(struct coordinator* c, int tags)
+{
+    c->ctx.routers = calloc(tags, sizeof(struct router_device));
+    c->ctx.numDevices = (uint16_t) tags;
+    c->tags = calloc(tags, sizeof(struct tag));
+    if (!c->ctx.routers || !c->tags)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    int i;
+    for (i = 0; i < tags; i++)
+        trackingInitDevice(&c->ctx.routers[i]);
+}
+
+static void coordinatorFree(struct coordinator* c)
+{
+    free(c->ctx.routers);
+    free(c->tags);
+}
+
+/** 
+Feeds one second of one tag to the coordinator's tracking algorithm, and scores its decision.
+@param c the coordinator
+@param i which tag
+@param second simulated time
+@param lqi LQI of the tag's frame, or 0 if the coordinator didn't hear it
+@param lost ground truth: 1 if the tag is lost
+*/
+static void feedSample(struct coordinator* c, int i, int second, uint8_t lqi, int lost)
+{
+    struct simResults* res = &c->results;
+    struct tag* t = &c->tags[i];
+    struct router_device* r = &c->ctx.routers[i];
+    
+    if (lost && !t->lost)
+    {
+        res->lossEpisodes++;
+        t->lossStart = second;
+        t->alarmedThisEpisode = 0;
+    } else if (!lost && t->lost && !t->alarmedThisEpisode) {
+        res->lossEpisodesMissed++;
+    }
+    t->lost = lost;
+    
+    if (lqi == 0)
+    {
+        res->framesMissed++;                    // The coordinator hears nothing
+    } else {
+        enum TRACK_STATE before = r->track_state;
+        r->LQI = lqi;
+        if (trackingUpdate(&c->ctx, (uint16_t) i))
+            trackingEvaluate(&c->ctx, (uint16_t) i);
+        res->frames++;
+        if ((r->track_state == ITEM_LOST_ALARM) && (before != ITEM_LOST_ALARM) && !lost)
+            res->falseAlarms++;
+    }
+    
+    int alarmed = (r->track_state == ITEM_LOST_ALARM);
+    if (lost)
+    {
+        res->lostSeconds++;
+        if (alarmed)
+        {
+            if (!t->alarmedThisEpisode)
+            {
+                uint64_t delay = second - t->lossStart;
+                res->alarmDelaySum += delay;
+                res->alarmDelayCount++;
+                if (delay > res->alarmDelayMax)
+                    res->alarmDelayMax = delay;
+            }
+            t->alarmedThisEpisode = 1;
+        } else {
+            res->missedAlarmSeconds++;
+        }
+    } else {
+        res->presentSeconds++;
+        if (alarmed)
+            res->falseAlarmSeconds++;
+    }
+}
+
+/** Counts loss episodes still running at the end as missed if they never alarmed */
+static void coordinatorFinish(struct coordinator* c)
+{
+    uint16_t i;
+    for (i = 0; i < c->ctx.numDevices; i++)
+        if (c->tags[i].lost && !c->tags[i].alarmedThisEpisode)
+            c->results.lossEpisodesMissed++;
+}
+
+/** Runs one virtual coordinator, driven by the models, for the whole simulation */
+static void* runCoordinator(void* arg)
+{
+    struct worker* w = (struct worker*) arg;
+    const struct simParameters* p = w->p;
+    struct coordinator* c = &w->c;
+    uint64_t* rng = &w->rng;
+    
+    coordinatorInit(c, p->tags);
+    int i;
+    for (i = 0; i < p->tags; i++)
+    {
+        randomPoint(rng, HOME_RADIUS_M, &c->tags[i].x, &c->tags[i].y);
+        newWaypoint(&c->tags[i], rng);
+    }
+    
+    int second;
+    for (second = 0; second < p->seconds; second++)
+    {
+        if (p->traceOut)
+            pthread_mutex_lock(&traceLock);     // Keep each coordinator's seconds in order
+        for (i = 0; i < p->tags; i++)
+        {
+            struct tag* t = &c->tags[i];
+            move(t, rng);
+            int lost = (sqrt(t->x * t->x + t->y * t->y) > p->lossRadius);
+            double r = rssi(t, p, rng);
+            uint8_t lqi = (r < RX_SENSITIVITY_DBM) ? 0 : lqiFromRssi(r);
+            if (p->traceOut)
+                fprintf(p->traceOut, "%d,%d,%d,%u,%d\n", second, w->index, i, lqi, lost);
+            feedSample(c, i, second, lqi, lost);
+        }
+        if (p->traceOut)
+            pthread_mutex_unlock(&traceLock);
+    }
+    coordinatorFinish(c);
+    return 0;
+}
+
+/** 
+Replays a trace written with -w, or in the same format from elsewhere. Single threaded.
+@return 0 if success, -1 if the trace couldn't be read
+*/
+static int replay(const char* fileName, struct simParameters* p, struct simResults* total)
+{
+    FILE* f = fopen(fileName, "r");
+    if (!f)
+    {
+        perror(fileName);
+        return -1;
+    }
+    int second, coord, tag, lost;
+    unsigned lqi;
+    int maxCoord = -1, maxTag = -1, maxSecond = -1;
+    while (fscanf(f, "%d,%d,%d,%u,%d", &second, &coord, &tag, &lqi, &lost) == 5)
+    {
+        if ((second < 0) || (coord < 0) || (coord >= REPLAY_MAX_COORDINATORS) || (tag < 0) || 
+            (tag >= REPLAY_MAX_TAGS) || (lqi > 255))
+        {
+            fprintf(stderr, "%s: bad record\n", fileName);
+            fclose(f);
+            return -1;
+        }
+        if (coord > maxCoord) maxCoord = coord;
+        if (tag > maxTag) maxTag = tag;
+        if (second > maxSecond) maxSecond = second;
+    }
+    if (maxCoord < 0)
+    {
+        fprintf(stderr, "%s: empty\n", fileName);
+        fclose(f);
+        return -1;
+    }
+    p->coordinators = maxCoord + 1;
+    p->tags = maxTag + 1;
+    p->seconds = maxSecond + 1;
+    
+    struct coordinator* c = calloc(p->coordinators, sizeof(struct coordinator));
+    if (!c)
+    {
+        fclose(f);
+        return -1;
+    }
+    int i;
+    for (i = 0; i < p->coordinators; i++)
+        coordinatorInit(&c[i], p->tags);
+    rewind(f);
+    while (fscanf(f, "%d,%d,%d,%u,%d", &second, &coord, &tag, &lqi, &lost) == 5)
+        feedSample(&c[coord], tag, second, (uint8_t) lqi, lost != 0);
+    fclose(f);
+    for (i = 0; i < p->coordinators; i++)
+    {
+        coordinatorFinish(&c[i]);
+        *total = c[i].results;                  // Summed by the caller, one at a time
+        total++;
+        coordinatorFree(&c[i]);
+    }
+    free(c);
+    return 0;
+}
+
+static double percent(uint64_t n, uint64_t d)
+{
+    return (d == 0) ? 0.0 : (100.0 * (double) n / (double) d);
+}
+
+static void addResults(struct simResults* total, const struct simResults* r)
+{
+    total->frames += r->frames;
+    total->framesMissed += r->framesMissed;
+    total->presentSeconds += r->presentSeconds;
+    total->falseAlarmSeconds += r->falseAlarmSeconds;
+    total->lostSeconds += r->lostSeconds;
+    total->missedAlarmSeconds += r->missedAlarmSeconds;
+    total->lossEpisodes += r->lossEpisodes;
+    total->lossEpisodesMissed += r->lossEpisodesMissed;
+    total->falseAlarms += r->falseAlarms;
+    total->alarmDelaySum += r->alarmDelaySum;
+    total->alarmDelayCount += r->alarmDelayCount;
+    if (r->alarmDelayMax > total->alarmDelayMax)
+        total->alarmDelayMax = r->alarmDelayMax;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-c coordinators] [-n tags per coordinator] [-s seconds] [-e exponent] "
+            "[-f shadowing sigma dB] [-l loss radius m] [-r seed] [-w trace.csv | -p trace.csv]\n", name);
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    struct simParameters p = {8, 256, 3600, 2.0, 4.0, 20.0, 1, 0};
+    const char* traceIn = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:n:s:e:f:l:r:w:p:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': p.coordinators = atoi(optarg); break;
+        case 'n': p.tags = atoi(optarg); break;
+        case 's': p.seconds = atoi(optarg); break;
+        case 'e': p.pathLossExponent = atof(optarg); break;
+        case 'f': p.shadowingSigma = atof(optarg); break;
+        case 'l': p.lossRadius = atof(optarg); break;
+        case 'r': p.seed = strtoul(optarg, 0, 0); break;
+        case 'w':
+            p.traceOut = fopen(optarg, "w");
+            if (!p.traceOut)
+            {
+                perror(optarg);
+                return 1;
+            }
+            break;
+        case 'p': traceIn = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((p.coordinators < 1) || (p.tags < 1) || (p.tags > 0xFFFF) || (p.seconds < 1) || 
+        (traceIn && p.traceOut))
+        usage(argv[0]);
+    
+    struct simResults total = {0};
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int i;
+    if (traceIn)
+    {
+        struct simResults* results = calloc(REPLAY_MAX_COORDINATORS, sizeof(struct simResults));
+        if (!results || (replay(traceIn, &p, results) != 0))
+        {
+            free(results);
+            return 1;
+        }
+        for (i = 0; i < p.coordinators; i++)
+            addResults(&total, &results[i]);
+        free(results);
+    } else {
+        struct worker* workers = calloc(p.coordinators, sizeof(struct worker));
+        if (!workers)
+            return 1;
+        for (i = 0; i < p.coordinators; i++)
+        {
+            workers[i].index = i;
+            workers[i].p = &p;
+            workers[i].rng = (p.seed + 1) * 0x9E3779B97F4A7C15ULL + i;
+            if (pthread_create(&workers[i].thread, 0, runCoordinator, &workers[i]) != 0)
+            {
+                fprintf(stderr, "pthread_create failed\n");
+                return 1;
+            }
+        }
+        for (i = 0; i < p.coordinators; i++)
+        {
+            pthread_join(workers[i].thread, 0);
+            addResults(&total, &workers[i].c.results);
+            coordinatorFree(&workers[i].c);
+        }
+        free(workers);
+        if (p.traceOut)
+            fclose(p.traceOut);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    
+    if (traceIn)
+        printf("Replay of %s: %d coordinators x %d tags, %d s\n", 
+               traceIn, p.coordinators, p.tags, p.seconds);
+    else
+        printf("%d coordinators x %d tags, %d s simulated; n=%.1f, sigma=%.1fdB, loss radius %.1fm\n", 
+               p.coordinators, p.tags, p.seconds, p.pathLossExponent, p.shadowingSigma, p.lossRadius);
+    printf("Frames:        %llu received, %llu below sensitivity (%.2f%%)\n", 
+           (unsigned long long) total.frames, (unsigned long long) total.framesMissed,
+           percent(total.framesMissed, total.frames + total.framesMissed));
+    printf("Throughput:    %.0f frames/s over %.2fs wall clock\n", total.frames / wall, wall);
+    printf("False alarms:  %.3f%% of present tag-seconds; %llu alarms raised for present tags\n",
+           percent(total.falseAlarmSeconds, total.presentSeconds), (unsigned long long) total.falseAlarms);
+    printf("Missed alarms: %.3f%% of lost tag-seconds; %llu of %llu loss episodes never alarmed\n",
+           percent(total.missedAlarmSeconds, total.lostSeconds), 
+           (unsigned long long) total.lossEpisodesMissed, (unsigned long long) total.lossEpisodes);
+    printf("Time to alarm: %.2fs mean, %llus worst, over %llu alarmed episodes\n",
+           (total.alarmDelayCount == 0) ? 0.0 : ((double) total.alarmDelaySum / total.alarmDelayCount),
+           (unsigned long long) total.alarmDelayMax, (unsigned long long) total.alarmDelayCount);
+    return 0;
+}
+
+/* @} */
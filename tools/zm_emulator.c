@@ -0,0 +1,592 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file zm_emulator.c
+*
+* @brief Emulated Zigbee module for the POSIX HAL: answers the coordinator's MT commands and
+* generates, or replays, messages from tags.
+*
+Listens on a Unix domain socket for the POSIX HAL (hal_posix.c), which sends it every MT frame that 
+the coordinator writes over SPI, and answers as the Anaren module would, well enough for the 
+application to start a network and process messages:
+- SREQs get their SRSP, status success, with data where the application reads it: ZB_GET_DEVICE_INFO, 
+  SYS_VERSION. Anything not known gets a success status too.
+- SYS_RESET_REQ, sent by the HAL when the module is taken out of reset, is answered with SYS_RESET_IND.
+- ZDO_STARTUP_FROM_APP and ZB_START_REQUEST are followed by ZDO_STATE_CHANGE_IND (coordinator), and 
+  ZB_START_CONFIRM for the latter. Tags start sending once the network is up.
+- AF_DATA_REQUEST is followed by AF_DATA_CONFIRM, ZDO_MGMT_LQI_REQ by an empty ZDO_MGMT_LQI_RSP.
+- POLL frames tell the emulator that the coordinator has read an AREQ. At most WINDOW AREQs are 
+  outstanding, so that the HAL's queue never fills and "as fast as possible" is as fast as the 
+  coordinator can keep up with.
+
+Messages from tags are AF_INCOMING_MSG on the info message cluster (-c), one per tag per interval (-i), 
+or back to back with -i 0. Tag 0 and 1 have the MACs that the coordinator tracks; the others are 
+unknown to it. LQI varies randomly around -l. Alternatively -p replays a trace written by 
+tools/tracking_sim.c (-w) or taken from a real coordinator: each line "second,coordinator,tag,lqi,lost" 
+of coordinator 0 with a nonzero LQI becomes a message, at -x times real time.
+
+The payload is an info message as serialized by Messages/infoMessage.c, assumed to be: sequence, 
+version, flags, MAC (8, LSB first), device type, number of parameters, then per parameter the OID and 
+a 16-bit value, LSB first. One parameter is sent, OID -k, with the tag's message count as its value.
+
+Build and run, from the directory containing hal_posix.c:
+    gcc -O2 -Wall -o zm_emulator tools/zm_emulator.c
+    ./zm_emulator [-s socket] [-n tags] [-i interval ms] [-l lqi] [-c cluster] [-k oid] [-p trace.csv] [-x speed]
+Statistics are printed every STATS_INTERVAL_MS and on exit (Ctrl-C).
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define DEFAULT_SOCKET                  "/tmp/zm_emulator.sock"
+#define DEFAULT_TAGS                    2
+#define DEFAULT_INTERVAL_MS             1000
+#define DEFAULT_LQI                     0xA0
+#define DEFAULT_CLUSTER                 7
+#define DEFAULT_OID                     0x01
+#define LQI_SPREAD                      16
+
+/** Most AREQs sent and not yet read by the coordinator; must be less than AREQ_QUEUE_SIZE in hal_posix.c */
+#define WINDOW                          8
+/** AREQs waiting for the window to open */
+#define PENDING_SIZE                    16
+#define MAX_TAGS                        1024
+#define STATS_INTERVAL_MS               10000
+
+#define MT_FRAME_MAX                    253
+#define MT_HEADER_SIZE                  3
+#define MT_TYPE_MASK                    0xE0
+#define MT_TYPE_POLL                    0x00
+#define MT_TYPE_SREQ                    0x20
+#define MT_TYPE_SRSP                    0x60
+#define MT_SUBSYSTEM_MASK               0x1F
+
+/** MT commands, cmd0 << 8 | cmd1 */
+#define SYS_RESET_REQ                   0x4100
+#define SYS_RESET_IND                   0x4180
+#define SYS_VERSION                     0x2102
+#define AF_DATA_REQUEST                 0x2401
+#define AF_DATA_CONFIRM                 0x4480
+#define AF_INCOMING_MSG                 0x4481
+#define ZDO_MGMT_LQI_REQ                0x2531
+#define ZDO_MGMT_LQI_RSP                0x45B1
+#define ZDO_STARTUP_FROM_APP            0x2540
+#define ZDO_STATE_CHANGE_IND            0x45C0
+#define ZB_START_REQUEST                0x2600
+#define ZB_START_CONFIRM                0x4680
+#define ZB_GET_DEVICE_INFO              0x2606
+
+#define DEV_ZB_COORD                    9
+#define COORDINATOR_SHORT_ADDRESS       0x0000
+#define COORDINATOR_MAC                 {0x01, 0x00, 0x00, 0x00, 0x00, 0x4B, 0x12, 0x00}
+#define PAN_ID                          0x1234
+#define ENDPOINT                        0xD7
+
+struct tag
+{
+    uint8_t mac[8];
+    uint16_t shortAddress;
+    uint8_t afSequence;
+    uint16_t count;
+    /** Next message due, ms */
+    uint64_t due;
+};
+
+struct emulator
+{
+    int fd;
+    uint8_t started;
+    uint16_t outstanding;
+    uint8_t pending[PENDING_SIZE][MT_FRAME_MAX];
+    uint8_t pendingHead;
+    uint8_t pendingCount;
+    struct tag tags[MAX_TAGS];
+    uint16_t numTags;
+    uint8_t nextTag;
+    /** Replay */
+    FILE* trace;
+    uint64_t replayStart;
+    double replaySecond;
+    uint16_t replayTag;
+    uint8_t replayLqi;
+    uint8_t replayValid;
+    /** Statistics */
+    uint64_t messages;
+    uint64_t polls;
+    uint64_t requests;
+    uint64_t lastStats;
+    uint64_t lastMessages;
+};
+
+static const char* socketPath = DEFAULT_SOCKET;
+static uint32_t interval = DEFAULT_INTERVAL_MS;
+static uint8_t lqi = DEFAULT_LQI;
+static uint16_t cluster = DEFAULT_CLUSTER;
+static uint8_t oid = DEFAULT_OID;
+static double speed = 1.0;
+static volatile sig_atomic_t stop = 0;
+
+static const uint8_t defaultMacs[2][8] =
+{
+    {0x5E, 0xD2, 0x5D, 0x02, 0x00, 0x4B, 0x12, 0x00},
+    {0xD3, 0xD3, 0x5D, 0x02, 0x00, 0x4B, 0x12, 0x00},
+};
+
+static uint64_t millis()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+static void handleSignal(int sig)
+{
+    (void) sig;
+    stop = 1;
+}
+
+static void initTags(struct emulator* e, uint16_t numTags)
+{
+    uint16_t i;
+    uint64_t now = millis();
+    e->numTags = numTags;
+    for (i = 0; i < numTags; i++)
+    {
+        struct tag* t = &e->tags[i];
+        if (i < 2)
+        {
+            memcpy(t->mac, defaultMacs[i], 8);
+        } else {
+            uint8_t mac[8] = {i & 0xFF, i >> 8, 0x00, 0x03, 0x00, 0x4B, 0x12, 0x00};
+            memcpy(t->mac, mac, 8);
+        }
+        t->shortAddress = 0x1000 + i;
+        t->afSequence = 0;
+        t->count = 0;
+        t->due = now + (interval * i) / numTags;    // Spread over the interval
+    }
+}
+
+/** Queues an AREQ, sent when the window allows. @return 0 if success, -1 if the queue is full */
+static int queueFrame(struct emulator* e, uint16_t command, const uint8_t* data, uint8_t length)
+{
+    if (e->pendingCount == PENDING_SIZE)
+        return -1;
+    uint8_t* frame = e->pending[(e->pendingHead + e->pendingCount) % PENDING_SIZE];
+    frame[0] = length;
+    frame[1] = command >> 8;
+    frame[2] = command & 0xFF;
+    memcpy(frame + MT_HEADER_SIZE, data, length);
+    e->pendingCount++;
+    return 0;
+}
+
+static int writeFrame(int fd, const uint8_t* frame)
+{
+    size_t length = frame[0] + MT_HEADER_SIZE;
+    while (length > 0)
+    {
+        ssize_t n = write(fd, frame, length);
+        if (n <= 0)
+            return -1;
+        frame += n;
+        length -= n;
+    }
+    return 0;
+}
+
+static int readFully(int fd, uint8_t* bytes, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t n = read(fd, bytes, length);
+        if (n <= 0)
+            return -1;
+        bytes += n;
+        length -= n;
+    }
+    return 0;
+}
+
+/** Sends queued AREQs while the window is open. @return 0 if success */
+static int sendPending(struct emulator* e)
+{
+    while ((e->pendingCount > 0) && (e->outstanding < WINDOW))
+    {
+        if (writeFrame(e->fd, e->pending[e->pendingHead]) != 0)
+            return -1;
+        e->pendingHead = (e->pendingHead + 1) % PENDING_SIZE;
+        e->pendingCount--;
+        e->outstanding++;
+    }
+    return 0;
+}
+
+/** Queues an AF_INCOMING_MSG from a tag. @return 0 if success */
+static int queueTagMessage(struct emulator* e, struct tag* t, uint8_t linkQuality)
+{
+    uint8_t d[MT_FRAME_MAX];
+    uint8_t i = 0;
+    uint32_t now = (uint32_t) millis();
+    d[i++] = 0;                                 // Group
+    d[i++] = 0;
+    d[i++] = cluster & 0xFF;
+    d[i++] = cluster >> 8;
+    d[i++] = t->shortAddress & 0xFF;
+    d[i++] = t->shortAddress >> 8;
+    d[i++] = ENDPOINT;                          // Source and destination endpoint
+    d[i++] = ENDPOINT;
+    d[i++] = 0;                                 // Not broadcast
+    d[i++] = linkQuality;
+    d[i++] = 0;                                 // Not secure
+    d[i++] = now & 0xFF;                        // Timestamp
+    d[i++] = (now >> 8) & 0xFF;
+    d[i++] = (now >> 16) & 0xFF;
+    d[i++] = now >> 24;
+    d[i++] = t->afSequence++;
+    uint8_t lengthField = i++;
+    uint8_t payload = i;
+    d[i++] = t->count & 0xFF;                   // Info message: sequence, version, flags
+    d[i++] = 1;
+    d[i++] = 0;
+    memcpy(d + i, t->mac, 8);
+    i += 8;
+    d[i++] = 0;                                 // Device type
+    d[i++] = 1;                                 // Number of parameters
+    d[i++] = oid;
+    d[i++] = t->count & 0xFF;
+    d[i++] = t->count >> 8;
+    d[lengthField] = i - payload;
+    if (queueFrame(e, AF_INCOMING_MSG, d, i) != 0)
+        return -1;
+    t->count++;
+    e->messages++;
+    return 0;
+}
+
+/** Reads the next line of the trace for coordinator 0 with a frame. @return 0 if one was read */
+static int readTraceLine(struct emulator* e)
+{
+    char line[128];
+    while (fgets(line, sizeof(line), e->trace))
+    {
+        double second;
+        unsigned coordinator, tag, linkQuality, lost;
+        if (sscanf(line, "%lf,%u,%u,%u,%u", &second, &coordinator, &tag, &linkQuality, &lost) != 5)
+            continue;                           // Header or comment
+        if ((coordinator != 0) || (linkQuality == 0) || (tag >= MAX_TAGS))
+            continue;
+        if (tag >= e->numTags)
+            initTags(e, tag + 1);
+        e->replaySecond = second;
+        e->replayTag = tag;
+        e->replayLqi = linkQuality;
+        return 0;
+    }
+    return -1;
+}
+
+/** Queues the messages that are due. @return ms until the next one, or -1 if none */
+static int generate(struct emulator* e)
+{
+    uint64_t now = millis();
+    if (!e->started)
+        return -1;
+    if (e->trace)
+    {
+        while (e->replayValid && (e->pendingCount < PENDING_SIZE))
+        {
+            uint64_t due = e->replayStart + (uint64_t) (e->replaySecond * 1000.0 / speed);
+            if (due > now)
+                return due - now;
+            queueTagMessage(e, &e->tags[e->replayTag], e->replayLqi);
+            e->replayValid = (readTraceLine(e) == 0);
+        }
+        return e->replayValid ? 0 : -1;
+    }
+    int wait = -1;
+    uint16_t n;
+    for (n = 0; (n < e->numTags) && (e->pendingCount < PENDING_SIZE); n++)
+    {
+        struct tag* t = &e->tags[e->nextTag];
+        e->nextTag = (e->nextTag + 1) % e->numTags;     // Round robin, so that all tags get a turn
+        if (t->due <= now)
+        {
+            int spread = (rand() % (2 * LQI_SPREAD + 1)) - LQI_SPREAD;
+            int l = lqi + spread;
+            queueTagMessage(e, t, (l < 1) ? 1 : ((l > 255) ? 255 : l));
+            t->due = interval ? (t->due + interval) : now;
+            if (t->due < now)
+                t->due = now;                   // Fell behind: don't catch up with a burst
+        }
+    }
+    for (n = 0; n < e->numTags; n++)
+    {
+        int untilDue = (e->tags[n].due > now) ? (int) (e->tags[n].due - now) : 0;
+        if ((wait < 0) || (untilDue < wait))
+            wait = untilDue;
+    }
+    return wait;
+}
+
+static void startNetwork(struct emulator* e)
+{
+    uint8_t state = DEV_ZB_COORD;
+    queueFrame(e, ZDO_STATE_CHANGE_IND, &state, 1);
+    if (!e->started)
+    {
+        e->started = 1;
+        e->replayStart = millis();
+        initTags(e, e->numTags);
+    }
+}
+
+/** Answers one frame from the coordinator. @return 0 if success */
+static int handleFrame(struct emulator* e, const uint8_t* frame)
+{
+    uint16_t command = (frame[1] << 8) | frame[2];
+    uint8_t response[MT_FRAME_MAX];
+    uint8_t length = 1;
+    memset(response, 0, sizeof(response));
+    response[MT_HEADER_SIZE] = 0;               // Status: success
+    
+    if ((frame[1] & MT_TYPE_MASK) == MT_TYPE_POLL)
+    {
+        e->polls++;
+        if (e->outstanding > 0)
+            e->outstanding--;
+        return 0;
+    }
+    e->requests++;
+    switch (command)
+    {
+    case SYS_RESET_REQ:
+        {
+            uint8_t ind[6] = {0, 2, 0, 2, 2, 0};    // Reason, transport, product, version
+            e->started = 0;
+            e->outstanding = 0;                 // The HAL drops its queue on reset
+            e->pendingCount = 0;
+            queueFrame(e, SYS_RESET_IND, ind, sizeof(ind));
+            return 0;
+        }
+    case SYS_VERSION:
+        {
+            uint8_t v[5] = {2, 0, 2, 2, 0};
+            memcpy(response + MT_HEADER_SIZE, v, sizeof(v));
+            length = sizeof(v);
+            break;
+        }
+    case ZB_GET_DEVICE_INFO:
+        {
+            uint8_t mac[8] = COORDINATOR_MAC;
+            uint8_t parameter = frame[MT_HEADER_SIZE];
+            response[MT_HEADER_SIZE] = parameter;
+            switch (parameter)
+            {
+            case 0:                             // State
+                response[MT_HEADER_SIZE + 1] = e->started ? DEV_ZB_COORD : 0;
+                break;
+            case 1:                             // MAC
+                memcpy(response + MT_HEADER_SIZE + 1, mac, 8);
+                break;
+            case 2:                             // Short address
+                response[MT_HEADER_SIZE + 1] = COORDINATOR_SHORT_ADDRESS & 0xFF;
+                response[MT_HEADER_SIZE + 2] = COORDINATOR_SHORT_ADDRESS >> 8;
+                break;
+            case 5:                             // PAN ID
+                response[MT_HEADER_SIZE + 1] = PAN_ID & 0xFF;
+                response[MT_HEADER_SIZE + 2] = PAN_ID >> 8;
+                break;
+            case 6:                             // Extended PAN ID
+                memcpy(response + MT_HEADER_SIZE + 1, mac, 8);
+                break;
+            }
+            length = 9;
+            break;
+        }
+    case ZDO_STARTUP_FROM_APP:
+        startNetwork(e);
+        break;
+    case ZB_START_REQUEST:
+        length = 0;
+        queueFrame(e, ZB_START_CONFIRM, response + MT_HEADER_SIZE, 1);
+        startNetwork(e);
+        break;
+    case AF_DATA_REQUEST:
+        {
+            uint8_t confirm[3] = {0, frame[MT_HEADER_SIZE + 3], frame[MT_HEADER_SIZE + 6]};  // Status, endpoint, transaction
+            queueFrame(e, AF_DATA_CONFIRM, confirm, sizeof(confirm));
+            break;
+        }
+    case ZDO_MGMT_LQI_REQ:
+        {
+            uint8_t rsp[6] = {frame[MT_HEADER_SIZE], frame[MT_HEADER_SIZE + 1], 0, 0, frame[MT_HEADER_SIZE + 2], 0};
+            queueFrame(e, ZDO_MGMT_LQI_RSP, rsp, sizeof(rsp));  // Source, status, no neighbors
+            break;
+        }
+    }
+    if ((frame[1] & MT_TYPE_MASK) != MT_TYPE_SREQ)
+        return 0;                               // AREQ: no response
+    response[0] = length;
+    response[1] = MT_TYPE_SRSP | (frame[1] & MT_SUBSYSTEM_MASK);
+    response[2] = frame[2];
+    return writeFrame(e->fd, response);
+}
+
+static void printStatistics(struct emulator* e, uint64_t now)
+{
+    uint64_t elapsed = now - e->lastStats;
+    fprintf(stderr, "%llu messages (%.0f/s), %llu polls, %llu requests, %u outstanding\n", 
+            (unsigned long long) e->messages, 
+            elapsed ? (e->messages - e->lastMessages) * 1000.0 / elapsed : 0.0,
+            (unsigned long long) e->polls, (unsigned long long) e->requests, e->outstanding);
+    e->lastStats = now;
+    e->lastMessages = e->messages;
+}
+
+/** Serves one coordinator until it disconnects */
+static void serve(struct emulator* e, const char* traceName)
+{
+    uint8_t frame[MT_FRAME_MAX];
+    e->started = 0;
+    e->outstanding = 0;
+    e->pendingCount = 0;
+    e->lastStats = millis();
+    if (traceName)
+    {
+        if (!(e->trace = fopen(traceName, "r")))
+        {
+            perror(traceName);
+            exit(1);
+        }
+        e->replayValid = (readTraceLine(e) == 0);
+    }
+    while (!stop)
+    {
+        int wait = generate(e);
+        if (sendPending(e) != 0)
+            break;
+        if ((e->outstanding >= WINDOW) || (wait < 0) || (wait > STATS_INTERVAL_MS))
+            wait = STATS_INTERVAL_MS;           // Nothing to send until polled, or nothing at all
+        struct pollfd p = {e->fd, POLLIN, 0};
+        int r = poll(&p, 1, wait);
+        if ((r < 0) && (errno != EINTR))
+            break;
+        if (r > 0)
+        {
+            if ((readFully(e->fd, frame, MT_HEADER_SIZE) != 0) || 
+                (frame[0] > MT_FRAME_MAX - MT_HEADER_SIZE) ||
+                (readFully(e->fd, frame + MT_HEADER_SIZE, frame[0]) != 0) ||
+                (handleFrame(e, frame) != 0))
+                break;
+        }
+        uint64_t now = millis();
+        if (now - e->lastStats >= STATS_INTERVAL_MS)
+            printStatistics(e, now);
+    }
+    printStatistics(e, millis());
+    if (e->trace)
+        fclose(e->trace);
+    e->trace = 0;
+    close(e->fd);
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-s socket] [-n tags] [-i interval ms] [-l lqi] [-c cluster] [-k oid] "
+            "[-p trace.csv] [-x speed]\n", name);
+    exit(1);
+}
+
+int main(int argc, char** argv)
+{
+    static struct emulator e;
+    const char* traceName = 0;
+    uint16_t numTags = DEFAULT_TAGS;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:i:l:c:k:p:x:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': socketPath = optarg; break;
+        case 'n': numTags = atoi(optarg); break;
+        case 'i': interval = atoi(optarg); break;
+        case 'l': lqi = atoi(optarg); break;
+        case 'c': cluster = strtol(optarg, 0, 0); break;
+        case 'k': oid = strtol(optarg, 0, 0); break;
+        case 'p': traceName = optarg; break;
+        case 'x': speed = atof(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((numTags == 0) || (numTags > MAX_TAGS) || (speed <= 0))
+        usage(argv[0]);
+    e.numTags = numTags;
+    
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handleSignal;               // No SA_RESTART: Ctrl-C interrupts accept() and poll()
+    sigaction(SIGINT, &sa, 0);
+    sigaction(SIGTERM, &sa, 0);
+    signal(SIGPIPE, SIG_IGN);
+    
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socketPath);
+    if ((listenFd < 0) || (bind(listenFd, (struct sockaddr*) &address, sizeof(address)) != 0) || 
+        (listen(listenFd, 1) != 0))
+    {
+        perror(socketPath);
+        return 1;
+    }
+    fprintf(stderr, "Listening on %s, %u tags\n", socketPath, numTags);
+    while (!stop)
+    {
+        if ((e.fd = accept(listenFd, 0, 0)) < 0)
+            continue;
+        fprintf(stderr, "Coordinator connected\n");
+        serve(&e, traceName);
+        fprintf(stderr, "Coordinator disconnected\n");
+    }
+    close(listenFd);
+    unlink(socketPath);
+    return 0;
+}
+
+/* @} */
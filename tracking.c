@@ -0,0 +1,177 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file tracking.c
+*
+* @brief LQI tracking algorithm. See tracking.h.
+*
+The algorithm keeps a running average of the last LQI_NUM_SAMPLES LQI values of each device. Once the 
+average is valid, a device whose average drops below LQI_THRESHOLD is lost, and it is found again once 
+the average rises above it.
+This file has no hardware dependencies so that it can also be built on a host, e.g. by 
+tools/tracking_sim.c.
+*
+Change detectors (CUSUM, and a slope-based extrapolation of the average) were tried in 
+tools/tracking_sim.c and left out: none of the settings swept alarmed sooner than the average without 
+also raising more false alarms.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#include "tracking.h"
+#include <stdint.h>
+
+/** Empties a device's running average */
+static void trackingResetFilter(struct router_device* r)
+{
+  int k;
+  for (k = 0; k < LQI_NUM_SAMPLES; k++) {
+    r->LQI_running_average[k] = 0;
+  }
+  r->LQI = 0;
+  r->LQI_iter = 0;
+  r->LQI_total = 0;
+  r->LQI_average = 0;
+  r->LQI_initialized = 0;
+}
+
+/** Resets a device's filter and state, and clears its MAC address and rx_timestamp. */
+void trackingInitDevice(struct router_device* r)
+{
+  trackingResetFilter(r);
+  r->rx_timestamp = 0;
+
+  int j;
+  for (j = 0; j < 8; j++) {
+    r->MAC_address[j] = 0;
+  }
+    
+  r->track_state = ALL_ITEMS_CONNECTED;
+}
+
+/**
+Adds the device's latest LQI sample to its running average.
+@param ctx the devices
+@param router_index which device
+@return 1 if the average was updated, 0 if the device has no LQI sample yet
+*/
+uint8_t trackingUpdate(struct trackingContext* ctx, uint16_t router_index)
+{
+  struct router_device* r = &ctx->routers[router_index];
+  if (r->LQI == 0)
+    return 0;
+    
+  if (r->LQI_iter == LQI_NUM_SAMPLES) {
+    r->LQI_iter = 0;
+    r->LQI_initialized = 1;
+  }
+  
+  uint8_t oldest_LQI = r->LQI_running_average[r->LQI_iter];
+  r->LQI_running_average[r->LQI_iter] = r->LQI;
+  
+  if (r->LQI_initialized == 1)
+    r->LQI_total -= oldest_LQI;
+  r->LQI_total += r->LQI;
+
+  r->LQI_average = r->LQI_total / LQI_NUM_SAMPLES;
+  r->LQI_iter++;
+  return 1;
+}
+
+/**
+Puts a device straight into ITEM_LOST_ALARM, e.g. because the network reported that it left, and 
+empties its filter. The device is found again once enough new samples have brought the average back 
+above LQI_THRESHOLD. Call trackingEvaluate() afterwards to update the fleet.
+@param ctx the devices
+@param router_index which device
+*/
+void trackingForceLost(struct trackingContext* ctx, uint16_t router_index)
+{
+  struct router_device* r = &ctx->routers[router_index];
+  trackingResetFilter(r);
+  r->track_state = ITEM_LOST_ALARM;
+}
+
+/**
+Updates the device's state from its average, then checks the whole fleet.
+@param ctx the devices
+@param router_index which device
+@return TRACKING_EVENT_DEVICE_LOST if the device is lost, TRACKING_EVENT_ALL_CONNECTED if no device is 
+lost, else 0
+*/
+uint8_t trackingEvaluate(struct trackingContext* ctx, uint16_t router_index)
+{
+  struct router_device* r = &ctx->routers[router_index];
+  switch(r->track_state) {
+    
+  case ALL_ITEMS_CONNECTED:
+    if (r->LQI_average < LQI_THRESHOLD && r->LQI_initialized == 1) {
+        r->track_state = ITEM_LOST_ALARM;
+    }
+    break;
+  /*
+  case SUSPECTED_ITEM_LOSS:
+    halRgbSetLeds(0, 0xFF, 0);
+    if (LQI_average < LQI_THRESHOLD && LQI_initialized == 1) {
+        track_state = ITEM_LOST_ALARM;
+    }
+    else {
+      track_state = ALL_ITEMS_CONNECTED;
+    }
+    break;
+  */
+  case ITEM_LOST_ALARM:
+    if (r->LQI_average > LQI_THRESHOLD) {
+      r->track_state = ALL_ITEMS_CONNECTED;
+    }
+    break;
+  
+    /*
+  case ITEM_LOST_SILENCED:
+    halRgbSetLeds(0, 0xFF, 0);
+    if (r->LQI_average > LQI_THRESHOLD) {
+      r->track_state = ALL_ITEMS_CONNECTED;
+    }
+    break;  
+    */
+  default:
+    break;
+  }
+  
+  uint8_t events = 0;
+  uint16_t devices_connected = 0;
+  uint16_t i;
+  for (i = 0; i < ctx->numDevices; i++) {
+    if (ctx->routers[i].track_state == ALL_ITEMS_CONNECTED)
+      devices_connected++;
+  }
+  if (r->track_state == ITEM_LOST_ALARM)
+    events |= TRACKING_EVENT_DEVICE_LOST;
+  if (devices_connected == ctx->numDevices)
+    events |= TRACKING_EVENT_ALL_CONNECTED;
+  return events;
+}
+
+/* @} */
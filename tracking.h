@@ -0,0 +1,108 @@
+/**
+* @ingroup apps
+* @{
+*
+* @file tracking.h
+*
+* @brief LQI tracking algorithm: per-device filter and lost-item decision, free of hardware
+* dependencies.
+*
+* @section support Support
+* Please refer to the wiki at www.anaren.com/air-wiki-zigbee for more information. Additional support
+* is available via email at the following addresses:
+* - Questions on how to use the product: AIR@anaren.com
+* - Feature requests, comments, and improvements:  featurerequests@teslacontrols.com
+* - Consulting engagements: sales@teslacontrols.com
+*
+* @section license License
+* Copyright (c) 2012 Tesla Controls. All rights reserved. This Software may only be used with an 
+* Anaren A2530E24AZ1, A2530E24CZ1, A2530R24AZ1, or A2530R24CZ1 module. Redistribution and use in 
+* source and binary forms, with or without modification, are subject to the Software License 
+* Agreement in the file "anaren_eula.txt"
+* 
+* YOU FURTHER ACKNOWLEDGE AND AGREE THAT THE SOFTWARE AND DOCUMENTATION ARE PROVIDED “AS IS” 
+* WITHOUT WARRANTY OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING WITHOUT LIMITATION, ANY 
+* WARRANTY OF MERCHANTABILITY, TITLE, NON-INFRINGEMENT AND FITNESS FOR A PARTICULAR PURPOSE. IN NO 
+* EVENT SHALL ANAREN MICROWAVE OR TESLA CONTROLS BE LIABLE OR OBLIGATED UNDER CONTRACT, NEGLIGENCE, 
+* STRICT LIABILITY, CONTRIBUTION, BREACH OF WARRANTY, OR OTHER LEGAL EQUITABLE THEORY ANY DIRECT OR 
+* INDIRECT DAMAGES OR EXPENSE INCLUDING BUT NOT LIMITED TO ANY INCIDENTAL, SPECIAL, INDIRECT, 
+* PUNITIVE OR CONSEQUENTIAL DAMAGES, LOST PROFITS OR LOST DATA, COST OF PROCUREMENT OF SUBSTITUTE 
+* GOODS, TECHNOLOGY, SERVICES, OR ANY CLAIMS BY THIRD PARTIES (INCLUDING BUT NOT LIMITED TO ANY 
+* DEFENSE THEREOF), OR OTHER SIMILAR COSTS.
+*/
+
+#ifndef TRACKING_H
+#define TRACKING_H
+
+#include <stdint.h>
+
+/** 
+Number of devices tracked by the coordinator: the routers whose MAC addresses are set in main(). Each 
+one costs 32 bytes of RAM (30 in routers[], 2 in report.c). May be overridden on the command line.
+*/
+#ifndef NUM_DEVICES
+#define NUM_DEVICES                     2
+#endif
+
+/** A device whose average LQI falls below this is considered lost */
+#define LQI_THRESHOLD                   0x50
+
+/** Number of LQI samples averaged per device */
+#define LQI_NUM_SAMPLES                 6
+
+/** STATES for tracking algorithm */
+enum TRACK_STATE
+{
+   ALL_ITEMS_CONNECTED,
+   SUSPECTED_ITEM_LOSS,
+   ITEM_LOST_ALARM,
+   ITEM_LOST_SILENCED,
+};
+
+/** 
+One tracked device. The tracking algorithm uses track_state and the LQI_ fields; the rest are 
+maintained by the application. The 16 and 32 bit fields come first so that the 8 bit ones pack without 
+padding.
+*/
+struct router_device {
+  /** halMillis() at the SRDY edge of the last message received from this device */
+  uint32_t rx_timestamp;
+  uint16_t LQI_total;
+  /** Network (short) address the device last sent from, or SHORT_ADDRESS_UNKNOWN */
+  uint16_t short_address;
+  /** State of the tracking algorithm state machine */
+  enum TRACK_STATE track_state;
+  uint8_t MAC_address[8];
+  uint8_t LQI_running_average[LQI_NUM_SAMPLES];
+  /** Latest LQI sample, set by the application; 0 if none */
+  uint8_t LQI;
+  uint8_t LQI_iter;
+  uint8_t LQI_average;
+  uint8_t LQI_initialized;
+  /** Highest AF transaction sequence number received from this device */
+  uint8_t last_seq;
+  /** Bit n set if last_seq - (n + 1) has been received */
+  uint8_t seq_window;
+  /** Rate limiter: messages this device may still send before being dropped */
+  uint8_t tokens;
+};
+
+/** The devices tracked by one coordinator */
+struct trackingContext
+{
+  struct router_device* routers;
+  uint16_t numDevices;
+};
+
+/** Returned by trackingEvaluate() */
+#define TRACKING_EVENT_DEVICE_LOST      0x01
+#define TRACKING_EVENT_ALL_CONNECTED    0x02
+
+void trackingInitDevice(struct router_device* r);
+uint8_t trackingUpdate(struct trackingContext* ctx, uint16_t router_index);
+uint8_t trackingEvaluate(struct trackingContext* ctx, uint16_t router_index);
+void trackingForceLost(struct trackingContext* ctx, uint16_t router_index);
+
+#endif
+
+/* @} */